@@ -182,11 +182,15 @@ unsigned int ELFHash(const std::string& str) {
 /* End Of ELF Hash Function */
 
 unsigned int BKDRHash(const std::string& str) {
-  unsigned int seed = 131;  // 31 131 1313 13131 131313 etc..
-  unsigned int hash = 0;
+  return BKDRHash(str.data(), str.length());
+}
 
-  for (std::size_t i = 0; i < str.length(); i++) {
-    hash = (hash * seed) + str[i];
+unsigned int BKDRHash(const char* str, size_t length, unsigned int seed) {
+  unsigned int factor = 131;  // 31 131 1313 13131 131313 etc..
+  unsigned int hash = seed;
+
+  for (std::size_t i = 0; i < length; i++) {
+    hash = (hash * factor) + str[i];
   }
 
   return hash;
@@ -260,6 +264,109 @@ unsigned int APHash(const std::string& str) {
 }
 /* End Of AP Hash Function */
 
+/* -----------------------------------------------------------------------------
+ * Implementation of XXHash64                                                   *
+ * -----------------------------------------------------------------------------
+ */
+
+static const uint64 kPrime64_1 = 0x9E3779B185EBCA87ULL;
+static const uint64 kPrime64_2 = 0xC2B2AE3D27D4EB4FULL;
+static const uint64 kPrime64_3 = 0x165667B19E3779F9ULL;
+static const uint64 kPrime64_4 = 0x85EBCA77C2B2AE63ULL;
+static const uint64 kPrime64_5 = 0x27D4EB2F165667C5ULL;
+
+static inline uint64 RotateLeft64(uint64 x, int r) {
+  return (x << r) | (x >> (64 - r));
+}
+
+// memcpy() is the portable unaligned load, and is one mov on x86.
+static inline uint64 Read64(const char* p) {
+  uint64 x;
+  memcpy(&x, p, sizeof(x));
+  return x;
+}
+
+static inline uint32 Read32(const char* p) {
+  uint32 x;
+  memcpy(&x, p, sizeof(x));
+  return x;
+}
+
+static inline uint64 XXHashRound(uint64 acc, uint64 input) {
+  acc += input * kPrime64_2;
+  acc = RotateLeft64(acc, 31);
+  return acc * kPrime64_1;
+}
+
+static inline uint64 XXHashMergeRound(uint64 acc, uint64 val) {
+  acc ^= XXHashRound(0, val);
+  return acc * kPrime64_1 + kPrime64_4;
+}
+
+static inline uint64 XXHash64Inline(const char* p, size_t length,
+                                    uint64 seed) {
+  const char* end = p + length;
+  uint64 hash;
+  if (length >= 32) {
+    // Four lanes of 8 bytes for the long strings.
+    const char* limit = end - 32;
+    uint64 v1 = seed + kPrime64_1 + kPrime64_2;
+    uint64 v2 = seed + kPrime64_2;
+    uint64 v3 = seed;
+    uint64 v4 = seed - kPrime64_1;
+    do {
+      v1 = XXHashRound(v1, Read64(p));
+      v2 = XXHashRound(v2, Read64(p + 8));
+      v3 = XXHashRound(v3, Read64(p + 16));
+      v4 = XXHashRound(v4, Read64(p + 24));
+      p += 32;
+    } while (p <= limit);
+    hash = RotateLeft64(v1, 1) + RotateLeft64(v2, 7) +
+           RotateLeft64(v3, 12) + RotateLeft64(v4, 18);
+    hash = XXHashMergeRound(hash, v1);
+    hash = XXHashMergeRound(hash, v2);
+    hash = XXHashMergeRound(hash, v3);
+    hash = XXHashMergeRound(hash, v4);
+  } else {
+    hash = seed + kPrime64_5;
+  }
+  hash += length;
+  // The tail of less than 32 bytes.
+  for (; p + 8 <= end; p += 8) {
+    hash ^= XXHashRound(0, Read64(p));
+    hash = RotateLeft64(hash, 27) * kPrime64_1 + kPrime64_4;
+  }
+  if (p + 4 <= end) {
+    hash ^= Read32(p) * kPrime64_1;
+    hash = RotateLeft64(hash, 23) * kPrime64_2 + kPrime64_3;
+    p += 4;
+  }
+  for (; p < end; ++p) {
+    hash ^= static_cast<unsigned char>(*p) * kPrime64_5;
+    hash = RotateLeft64(hash, 11) * kPrime64_1;
+  }
+  // Avalanche, so every bit of the input changes all the bits.
+  hash ^= hash >> 33;
+  hash *= kPrime64_2;
+  hash ^= hash >> 29;
+  hash *= kPrime64_3;
+  hash ^= hash >> 32;
+  return hash;
+}
+
+uint64 XXHash64(const char* str, size_t length, uint64 seed) {
+  return XXHash64Inline(str, length, seed);
+}
+
+void XXHash64Batch(const StringPiece* tokens, size_t num_tokens,
+                   uint64 seed, uint64* hashes) {
+  // The loop is inlined, so the hashes of the short tokens, which have
+  // no dependency on each other, are computed at the same time.
+  for (size_t i = 0; i < num_tokens; ++i) {
+    hashes[i] = XXHash64Inline(tokens[i].data(), tokens[i].size(), seed);
+  }
+}
+
 /* -----------------------------------------------------------------------------
  * Implementation of the SplitString                                            *
  * -----------------------------------------------------------------------------
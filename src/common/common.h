@@ -367,6 +367,13 @@ unsigned int BPHash(const std::string& str);
 unsigned int FNVHash(const std::string& str);
 unsigned int APHash(const std::string& str);
 
+/* BKDRHash of the bytes [str, str + length), which needs no std::string
+   for a token inside a line. The hash starts from seed instead of 0, so
+   different seeds give different hashes for the same bytes. */
+
+unsigned int BKDRHash(const char* str, size_t length, 
+                      unsigned int seed = 0);
+
 /* -----------------------------------------------------------------------------
  * This is an implementation deisgned to match anticipated future TR2           *
  * implementation of the scoped_ptr class, and its closely-related brethren,    *
@@ -893,6 +900,76 @@ std::string JoinStrings(const Container& container,
   return JoinStrings(container.begin(), container.end(), delimiter);
 }
 
+/* -----------------------------------------------------------------------------
+ * StringPiece is a light-weight view (pointer + length) of a string owned by   *
+ * someone else, e.g., one line inside a memory-mapped file. It never copies    *
+ * nor frees the underlying memory, and the data is NOT '\0'-terminated.        *
+ *                                                                              *
+ *   std::string str = "apple orange";                                          *
+ *   StringPiece piece(str.data() + 6, 6);                                      *
+ *   EXPECT_EQ(piece.ToString(), std::string("orange"));                        *
+ *                                                                              *
+ * StringPiece also works with SplitStringToIteratorUsing() to split a string   *
+ * without copying its sub-strings.                                             *
+ * -----------------------------------------------------------------------------
+ */
+
+class StringPiece {
+ public:
+  StringPiece() : ptr_(NULL), length_(0) {}
+  StringPiece(const char* str, size_t len) : ptr_(str), length_(len) {}
+  StringPiece(const std::string& str)
+    : ptr_(str.data()), length_(str.size()) {}
+
+  const char* data() const { return ptr_; }
+  size_t size() const { return length_; }
+  bool empty() const { return length_ == 0; }
+
+  char operator[](size_t i) const {
+    assert(i < length_);
+    return ptr_[i];
+  }
+
+  void set(const char* str, size_t len) {
+    ptr_ = str;
+    length_ = len;
+  }
+
+  std::string ToString() const {
+    return std::string(ptr_, length_);
+  }
+
+ private:
+  const char* ptr_;
+  size_t length_;
+};
+
+/* -----------------------------------------------------------------------------
+ * XXHash64 is the 64-bit xxHash (https://github.com/Cyan4973/xxHash) of the    *
+ * bytes [str, str + length). The hash functions above are 32-bit and read one  *
+ * byte at a time from a std::string, while XXHash64 reads 8 bytes at a time    *
+ * from any view, e.g., a token inside a line, and its 64 bits make the         *
+ * collisions of billions of features rare:                                     *
+ *                                                                              *
+ *   uint64 hash = XXHash64(token.data(), token.size(), seed);                  *
+ *                                                                              *
+ * XXHash64Batch() hashes many tokens with the same seed in one call, and the   *
+ * independent hashes of the tokens overlap in the pipeline of the CPU:         *
+ *                                                                              *
+ *   std::vector<StringPiece> tokens;                                           *
+ *   std::vector<uint64> hashes(tokens.size());                                 *
+ *   XXHash64Batch(tokens.data(), tokens.size(), seed, hashes.data());          *
+ *                                                                              *
+ * The bytes are read as little-endian words, so the hashes are the same as     *
+ * the reference implementation on x86 and ARM.                                 *
+ * -----------------------------------------------------------------------------
+ */
+
+uint64 XXHash64(const char* str, size_t length, uint64 seed = 0);
+
+void XXHash64Batch(const StringPiece* tokens, size_t num_tokens,
+                   uint64 seed, uint64* hashes);
+
 /* -----------------------------------------------------------------------------
  * String printf utilities.                                                     *
  * This code comes from the re2 project host on Google Code                     *
@@ -0,0 +1,392 @@
+/*
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or (at
+your option) any later version.
+
+This program is distributed in the hope that it will be useful, but
+WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+02110-1301, USA.
+*/
+
+/* 
+Copyright (c) 2016 by contributors.
+Author: Chao Ma (mctt90@gmail.com)
+
+This file is the implementation of data_structure.h
+*/
+
+#include "src/common/data_structure.h"
+
+#include <string.h>
+
+namespace f2m {
+
+const uint64 kInitialNumSlots = 1024;
+const uint64 kNumBlocksPerSlab = 4096;
+
+const index_t SparseTable::kEmptyKey;
+
+/* The random latent vectors use splitmix64, so the model is the same 
+   on all platforms. The values of a feature come from its own state, 
+   which only depends on the seed and the feature, so the dense mode 
+   and the sparse mode (which allocates features on demand) give the 
+   same values. */
+
+static uint64 RandomBlockSeed(uint64 seed, index_t key) {
+  uint64 z = seed ^ ((key + 1) * 0xD1B54A32D192ED03ULL);
+  z = (z ^ (z >> 32)) * 0xBF58476D1CE4E5B9ULL;
+  return z ^ (z >> 29);
+}
+
+/* Return a random value in [-scale, scale). */
+
+static real_t RandomValue(uint64* state, real_t scale) {
+  uint64 z = (*state += 0x9E3779B97F4A7C15ULL);
+  z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+  z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+  z ^= z >> 31;
+  // the highest 24 bits to [0, 1)
+  real_t r = (z >> 40) / static_cast<real_t>(1 << 24);
+  return (2 * r - 1) * scale;
+}
+
+//------------------------------------------------------------------------------
+// GradIndex
+//------------------------------------------------------------------------------
+
+void GradIndex::Grow() {
+  std::vector<Slot> old;
+  old.swap(m_slots);
+  uint64 num_slots = old.empty() ? kInitialNumSlots : old.size() * 2;
+  Slot empty = { 0, 0, 0 };
+  m_slots.assign(num_slots, empty);
+  m_mask = num_slots - 1;
+  uint32 generation = m_generation;
+  // The new slots are all empty for generation 1.
+  m_generation = 1;
+  m_size = 0;
+  for (size_t i = 0; i < old.size(); ++i) {
+    if (old[i].stamp == generation) {
+      FindOrInsert(old[i].key, old[i].value);
+    }
+  }
+}
+
+//------------------------------------------------------------------------------
+// SparseTable
+//------------------------------------------------------------------------------
+
+SparseTable::SparseTable(const std::vector<real_t>& init_block)
+  : m_block_size(init_block.size()),
+    m_init_block(init_block),
+    m_slots(NewSlots(kInitialNumSlots)),
+    m_num_keys(0),
+    m_slab_begin(NULL),
+    m_slab_remain(0),
+    m_random_scale(0),
+    m_random_seed(0) {
+  CHECK_GT(m_block_size, 0);
+}
+
+SparseTable::~SparseTable() {
+  DeleteSlots(m_slots);
+  for (size_t i = 0; i < m_retired.size(); ++i) {
+    DeleteSlots(m_retired[i]);
+  }
+  for (size_t i = 0; i < m_slabs.size(); ++i) {
+    delete [] m_slabs[i];
+  }
+}
+
+SparseTable::Slots* SparseTable::NewSlots(uint64 num_slots) {
+  Slots* slots = new Slots;
+  slots->mask = num_slots - 1;
+  slots->keys = new index_t[num_slots];
+  slots->blocks = new real_t*[num_slots];
+  for (uint64 i = 0; i < num_slots; ++i) {
+    slots->keys[i] = kEmptyKey;
+    slots->blocks[i] = NULL;
+  }
+  return slots;
+}
+
+void SparseTable::DeleteSlots(Slots* slots) {
+  delete [] slots->keys;
+  delete [] slots->blocks;
+  delete slots;
+}
+
+/* The block is stored before the key, and the key is published 
+   with a release store. So a reader which sees the key also sees 
+   the block. */
+
+void SparseTable::InsertIntoSlots(Slots* slots, index_t key, 
+                                  real_t* block) {
+  uint64 i = Hash(key) & slots->mask;
+  while (slots->keys[i] != kEmptyKey) {
+    i = (i + 1) & slots->mask;
+  }
+  slots->blocks[i] = block;
+  __atomic_store_n(&slots->keys[i], key, __ATOMIC_RELEASE);
+}
+
+real_t* SparseTable::Find(index_t key) const {
+  const Slots* slots = __atomic_load_n(&m_slots, __ATOMIC_ACQUIRE);
+  uint64 i = Hash(key) & slots->mask;
+  for (;;) {
+    index_t k = __atomic_load_n(&slots->keys[i], __ATOMIC_ACQUIRE);
+    if (k == key) {
+      return slots->blocks[i];
+    }
+    if (k == kEmptyKey) {
+      return NULL;
+    }
+    i = (i + 1) & slots->mask;
+  }
+}
+
+real_t* SparseTable::FindOrInsert(index_t key) {
+  CHECK_NE(key, kEmptyKey);
+  real_t* block = Find(key);
+  if (block != NULL) {
+    return block;
+  }
+  MutexLocker locker(&m_mutex);
+  // Another thread may have inserted the key.
+  block = Find(key);
+  if (block != NULL) {
+    return block;
+  }
+  // Keep the load factor under 0.5.
+  if ((m_num_keys + 1) * 2 > m_slots->mask + 1) {
+    Grow();
+  }
+  block = NewBlock(key);
+  InsertIntoSlots(m_slots, key, block);
+  ++m_num_keys;
+  return block;
+}
+
+/* Double the slots. The new slots are filled before they are 
+   published, and the old slots are kept for the readers. */
+
+void SparseTable::Grow() {
+  Slots* slots = NewSlots((m_slots->mask + 1) * 2);
+  for (uint64 i = 0; i <= m_slots->mask; ++i) {
+    if (m_slots->keys[i] != kEmptyKey) {
+      InsertIntoSlots(slots, m_slots->keys[i], m_slots->blocks[i]);
+    }
+  }
+  m_retired.push_back(m_slots);
+  __atomic_store_n(&m_slots, slots, __ATOMIC_RELEASE);
+}
+
+void SparseTable::GetKeys(std::vector<index_t>* keys) const {
+  const Slots* slots = __atomic_load_n(&m_slots, __ATOMIC_ACQUIRE);
+  for (uint64 i = 0; i <= slots->mask; ++i) {
+    index_t key = __atomic_load_n(&slots->keys[i], __ATOMIC_ACQUIRE);
+    if (key != kEmptyKey) {
+      keys->push_back(key);
+    }
+  }
+}
+
+void SparseTable::SetRandomInit(const std::vector<uint64>& offsets,
+                                real_t scale, uint64 seed) {
+  for (size_t i = 0; i < offsets.size(); ++i) {
+    CHECK_LT(offsets[i], m_block_size);
+  }
+  MutexLocker locker(&m_mutex);
+  m_random_offsets = offsets;
+  m_random_scale = scale;
+  m_random_seed = seed;
+  for (uint64 i = 0; i <= m_slots->mask; ++i) {
+    if (m_slots->keys[i] != kEmptyKey) {
+      RandomizeBlock(m_slots->keys[i], m_slots->blocks[i]);
+    }
+  }
+}
+
+void SparseTable::RandomizeBlock(index_t key, real_t* block) const {
+  if (m_random_offsets.empty()) {
+    return;
+  }
+  uint64 state = RandomBlockSeed(m_random_seed, key);
+  for (size_t i = 0; i < m_random_offsets.size(); ++i) {
+    block[m_random_offsets[i]] = RandomValue(&state, m_random_scale);
+  }
+}
+
+/* Allocate a block from the last slab, and initialize it. */
+
+real_t* SparseTable::NewBlock(index_t key) {
+  if (m_slab_remain == 0) {
+    try {
+      // one more cache line for the alignment
+      m_slabs.push_back(new real_t[kNumBlocksPerSlab * m_block_size + 
+                                   kCacheLineSize / sizeof(real_t)]);
+    } catch (std::bad_alloc&) {
+      LOG(FATAL) << "Cannot allocate enough memory for SparseTable.";
+    }
+    m_slab_begin = AlignToCacheLine(m_slabs.back());
+    m_slab_remain = kNumBlocksPerSlab;
+  }
+  real_t* block = m_slab_begin + 
+                  (kNumBlocksPerSlab - m_slab_remain) * m_block_size;
+  --m_slab_remain;
+  memcpy(block, m_init_block.data(), m_block_size * sizeof(real_t));
+  RandomizeBlock(key, block);
+  return block;
+}
+
+//------------------------------------------------------------------------------
+// Model
+//------------------------------------------------------------------------------
+
+Model::Model(real_t init_value, ModelType type, 
+             index_t feature_num, int k, int field_num,
+             bool sparse, bool aligned, int num_state, bool has_step)
+  : m_parameters(NULL),
+    m_type(type),
+    m_feature_num(feature_num), 
+    m_k(k), 
+    m_field_num(field_num),
+    m_num_state(num_state),
+    m_has_step(has_step),
+    m_sparse(sparse),
+    m_aligned(aligned),
+    m_flat(!sparse && !aligned && num_state == 0 && !has_step) {
+  // check the input value
+  CHECK_GT(m_feature_num, 0);
+  // Note that, for LR, m_k and m_field_num should be set to 0.
+  // For FM, just m_field_num should be set to 0.
+  CHECK_GE(m_k, 0);          
+  CHECK_GE(m_field_num, 0);
+  CHECK_GE(m_num_state, 0);
+  // the number of latent vectors of one feature
+  if (type == LR) {
+    m_num_v = 0;
+  } else if (type == FM) {
+    m_num_v = 1;
+  } else if (type == FFM) {
+    m_num_v = m_field_num;
+  } else {
+    LOG(FATAL) << "Unknow model type: " << type;
+  }
+  m_padded_k = m_aligned ? RoundUp(m_k, kSIMDWidth) : m_k;
+  // Use 64 bits, or the size overflows for large FFM models.
+  uint64 size_v = static_cast<uint64>(m_num_v) * m_padded_k;
+  uint64 size_state_v = size_v * m_num_state;
+  if (m_flat) {
+    // [ w of all features | v of all features ]
+    m_size_block = size_v;
+    m_offset_w = 0;
+    m_offset_v = 0;
+    m_offset_state_w = 0;
+    m_offset_state_v = 0;
+    m_offset_step = 0;
+    m_size_parameters = static_cast<uint64>(m_feature_num) * (1 + size_v);
+  } else {
+    if (m_aligned) {
+      // [ v | w | state of w | step | state of v | padding ], 
+      // aligned to the cache line, and the state of v is aligned 
+      // for SIMD
+      m_offset_v = 0;
+      m_offset_w = size_v;
+      m_offset_state_w = size_v + 1;
+      m_offset_step = m_offset_state_w + m_num_state;
+      m_offset_state_v = RoundUp(m_offset_step + m_has_step, kSIMDWidth);
+      m_size_block = RoundUp(m_offset_state_v + size_state_v, 
+                             kCacheLineSize / sizeof(real_t));
+    } else {
+      // [ w | v | state of w | step | state of v ]
+      m_offset_w = 0;
+      m_offset_v = 1;
+      m_offset_state_w = 1 + size_v;
+      m_offset_step = m_offset_state_w + m_num_state;
+      m_offset_state_v = m_offset_step + m_has_step;
+      m_size_block = m_offset_state_v + size_state_v;
+    }
+    m_size_parameters = static_cast<uint64>(m_feature_num) * m_size_block;
+    // The padding, the state and the step of the block are zero.
+    m_init_block.assign(m_size_block, 0);
+    m_init_block[m_offset_w] = init_value;
+    for (int f = 0; f < m_num_v; ++f) {
+      for (int i = 0; i < m_k; ++i) {
+        m_init_block[m_offset_v + f * m_padded_k + i] = init_value;
+      }
+    }
+  }
+  if (m_sparse) {
+    m_table.reset(new SparseTable(m_init_block));
+    return;
+  }
+  // allocated memory and initial model parameters 
+  try {
+    // one more cache line for the alignment
+    m_memory.reset(new real_t[m_size_parameters + 
+                              kCacheLineSize / sizeof(real_t)]);
+  } catch (std::bad_alloc&) {
+    LOG(FATAL) << "Cannot not allocate enough memory for   \
+                   current model parameters.";
+  }
+  m_parameters = AlignToCacheLine(m_memory.get());
+  if (m_flat) {
+    for (uint64 i = 0; i < m_size_parameters; ++i) {
+      m_parameters[i] = init_value;
+    }
+  } else {
+    for (index_t i = 0; i < m_feature_num; ++i) {
+      memcpy(m_parameters + m_size_block * i, m_init_block.data(), 
+             m_size_block * sizeof(real_t));
+    }
+  }
+}
+
+void Model::GetFeatures(std::vector<index_t>* features) const {
+  features->clear();
+  if (m_sparse) {
+    m_table->GetKeys(features);
+    return;
+  }
+  features->reserve(m_feature_num);
+  for (index_t i = 0; i < m_feature_num; ++i) {
+    features->push_back(i);
+  }
+}
+
+void Model::GetVOffsets(std::vector<uint64>* offsets) const {
+  offsets->clear();
+  for (int f = 0; f < m_num_v; ++f) {
+    for (int j = 0; j < m_k; ++j) {
+      offsets->push_back(m_offset_v + f * m_padded_k + j);
+    }
+  }
+}
+
+void Model::RandomizeV(real_t scale, uint64 seed) {
+  if (m_sparse) {
+    std::vector<uint64> offsets;
+    GetVOffsets(&offsets);
+    m_table->SetRandomInit(offsets, scale, seed);
+    return;
+  }
+  for (index_t i = 0; i < m_feature_num; ++i) {
+    uint64 state = RandomBlockSeed(seed, i);
+    for (int f = 0; f < m_num_v; ++f) {
+      real_t* v = MutableV(i, f);
+      for (int j = 0; j < m_k; ++j) {
+        v[j] = RandomValue(&state, scale);
+      }
+    }
+  }
+}
+
+} // namespace f2m
@@ -25,6 +25,9 @@ This file defines the data structures used by f2m.
 #ifndef F2M_COMMON_DATA_STRUCTURE_H_
 #define F2M_COMMON_DATA_STRUCTURE_H_
 
+#include <string.h>
+
+#include <algorithm>
 #include <vector>
 
 #include "src/common/common.h" 
@@ -42,31 +45,32 @@ typedef float real_t;
 typedef uint32 index_t;
 
 /* -----------------------------------------------------------------------------
- * SparseRow can store the sparse value such as the input training data.        *
+ * SparseRow is a view of one row of the DataMatrix, which can be used to       *
+ * access the sparse value such as the input training data.                     *
  *                                                                              *
- * For SparseRow, the field of data_  stores the real data vector and           *
- * the field of position_ stores their index.                                   *
+ * For SparseRow, the field of x stores the real data vector and                *
+ * the field of position stores their index.                                    *
  *                                                                              *
  * Note that, we can not index any value in this data structure and just        *
  * can scan the whole value.                                                    *
  *                                                                              *
- * scoped_array<real_t> data is equal to real_t* data, the only difference is   *
- * that scoped_array<real_t> will delete the allocated memory automitically.    *
+ * SparseRow does not own any memory. All the pointers point to the arrays      *
+ * of DataMatrix, so they are invalid after the DataMatrix is changed.          *
  * -----------------------------------------------------------------------------
  */
 
 struct SparseRow {
   /* The real value vector */
 
-  scoped_array<real_t> x;
+  const real_t* x;
 
   /* The value postion (optional) */
 
-  scoped_array<index_t> position;
+  const index_t* position;
 
-  /* The field number. (optional, only for FFM) */
+  /* The field number. (optional, only for FFM, otherwise NULL) */
   
-  scoped_array<int> field;
+  const int* field;
 
   /* y can be either -1 or 0 (for negative examples), 
      and 1 (for positive examples) */
@@ -81,53 +85,445 @@ struct SparseRow {
 /* -----------------------------------------------------------------------------
  * DataMatrix is responsble for storing the input data matrix.                  *
  *                                                                              *
- * Each row of the matrix is a SparseRow structure, which stores                *
- * sparse input data.                                                           *
+ * DataMatrix stores a batch of sparse rows in CSR (Compressed Sparse Row)      *
+ * format, that is, the values, indices and fields of all rows are stored in    *
+ * three contiguous arrays one row after another, and row_offset[i] records     *
+ * where the i-th row starts. Here is an example:                               *
+ *                                                                              *
+ *    1 2 0 0 0               x = [1 2 1 1 1]                                   *
+ *    0 0 1 1 1   ------>     position = [0 1 2 3 4]                            *
+ *                            row_offset = [0 2 5]                              *
+ *                                                                              *
+ * A DataMatrix should be reused across mini-batches: Clear() keeps the         *
+ * allocated memory, so parsing a new batch does not allocate memory after      *
+ * the first few batches. We can build a DataMatrix like this:                  *
+ *                                                                              *
+ *   matrix.Clear();                                                            *
+ *   for each row {                                                             *
+ *     for each value {                                                         *
+ *       matrix.AddNode(index, value); // or AddNode(index, value, field)       *
+ *     }                                                                        *
+ *     matrix.EndRow(y);                                                        *
+ *   }                                                                          *
  * -----------------------------------------------------------------------------
  */
 
-typedef std::vector<SparseRow> DataMatrix;
+struct DataMatrix {
+  /* The values of all rows */
+
+  std::vector<real_t> x;
+
+  /* The position of every value */
+
+  std::vector<index_t> position;
+
+  /* The field of every value (optional, only for FFM) */
+
+  std::vector<int> field;
+
+  /* The start of every row in x, position and field. 
+     The size of row_offset is always size() + 1 */
+
+  std::vector<uint64> row_offset;
+
+  /* The label of every row */
+
+  std::vector<real_t> y;
+
+  /* Constructor. The num_rows is just a hint of 
+     how many rows will be stored in this matrix. */
+
+  explicit DataMatrix(size_t num_rows = 0) {
+    row_offset.reserve(num_rows + 1);
+    y.reserve(num_rows);
+    row_offset.push_back(0);
+  }
+
+  /* Return the number of rows */
+
+  size_t size() const { return y.size(); }
+
+  /* Return the number of values */
+
+  uint64 nnz() const { return x.size(); }
+
+  /* Remove all the rows but keep the allocated memory */
+
+  void Clear() {
+    x.clear();
+    position.clear();
+    field.clear();
+    y.clear();
+    row_offset.resize(1);
+  }
+
+  /* Add one value to the current row */
+
+  void AddNode(index_t index, real_t value) {
+    position.push_back(index);
+    x.push_back(value);
+  }
+
+  /* Add one value with its field to the current row (for FFM) */
 
+  void AddNode(index_t index, real_t value, int field_num) {
+    position.push_back(index);
+    x.push_back(value);
+    field.push_back(field_num);
+  }
+
+  /* Finish the current row with its label y */
+
+  void EndRow(real_t label) {
+    y.push_back(label);
+    row_offset.push_back(x.size());
+  }
+
+  /* Return a view of the i-th row */
+
+  SparseRow operator[] (size_t i) const {
+    SparseRow row;
+    uint64 start = row_offset[i];
+    row.x = x.data() + start;
+    row.position = position.data() + start;
+    row.field = field.empty() ? NULL : field.data() + start;
+    row.y = y[i];
+    row.size = row_offset[i+1] - start;
+    return row;
+  }
+};
+
+/* -----------------------------------------------------------------------------
+ * GradIndex maps the key of a gradient (a feature, or a feature and a field)   *
+ * to its index in SparseGrad, so the gradients of the same parameter in a      *
+ * mini-batch are merged into one entry without sorting.                        *
+ *                                                                              *
+ * It is an open-addressing hash table, and every slot has a generation         *
+ * stamp. A slot is used only if its stamp equals the current generation, so    *
+ * Clear() just increases the generation and costs O(1), no matter how many     *
+ * slots there are. The table grows (to keep the load factor <= 0.5) when a     *
+ * batch has more keys than ever before, and then keeps its size, so after      *
+ * the first few batches there is no allocation at all.                         *
+ * -----------------------------------------------------------------------------
+ */
+
+class GradIndex {
+ public:
+  GradIndex() : m_generation(1), m_mask(0), m_size(0) {}
+
+  /* Remove all the keys in O(1). */
+
+  void Clear() {
+    m_size = 0;
+    if (++m_generation == 0) {
+      // The stamps wrapped around, so reset all of them.
+      for (size_t i = 0; i < m_slots.size(); ++i) {
+        m_slots[i].stamp = 0;
+      }
+      m_generation = 1;
+    }
+  }
+
+  /* Return the index of key. If key is not found, insert it with
+     the index value and return value. */
+
+  uint32 FindOrInsert(uint64 key, uint32 value) {
+    if (2 * (m_size + 1) > m_slots.size()) {
+      Grow();
+    }
+    for (uint64 i = Hash(key) & m_mask; ; i = (i + 1) & m_mask) {
+      Slot& slot = m_slots[i];
+      if (slot.stamp != m_generation) {
+        slot.stamp = m_generation;
+        slot.key = key;
+        slot.value = value;
+        ++m_size;
+        return value;
+      }
+      if (slot.key == key) {
+        return slot.value;
+      }
+    }
+  }
+
+  uint64 size() const { return m_size; }
+
+ private:
+  struct Slot {
+    uint64 key;
+    uint32 stamp;   /* the slot is used iff stamp == m_generation */
+    uint32 value;
+  };
+
+  std::vector<Slot> m_slots;
+  uint32 m_generation;
+  uint64 m_mask;     /* number of slots - 1 */
+  uint64 m_size;     /* number of keys of the current generation */
+
+  static uint64 Hash(uint64 key) {
+    key *= 0x9E3779B97F4A7C15ULL;
+    return key ^ (key >> 29);
+  }
+
+  void Grow();
+};
 
 /* -----------------------------------------------------------------------------
  * SparseGrad is response for storing the calculated gradients.                 *
  *                                                                              *
- * Note that, for LR, we only need the grad_w, position_w, and size_w.          *
+ * Note that, for LR, we only need the grad_w and position_w.                   *
  * For FFM and FM, we need all the fields in this data structure.               *
+ *                                                                              *
+ * The gradient of a latent vector has size_k values, which are stored in       *
+ * grad_v[i * size_k, (i + 1) * size_k) for the latent vector of feature        *
+ * position_v[i] and field field_v[i] (the field is 0 for FM). Clear() keeps    *
+ * the memory, so a SparseGrad can be reused for every batch.                   *
+ *                                                                              *
+ * AddW() and AddV() merge the gradients of the same parameter: if the feature  *
+ * (and field) was added since the last Clear(), AddW() adds the gradient to    *
+ * the same entry, and AddV() returns the same index. So position_w and         *
+ * (position_v, field_v) are the lists of the unique parameters touched by      *
+ * the batch, and an updater costs O(unique features) instead of O(nonzeros).   *
  * -----------------------------------------------------------------------------
  */
 
 struct SparseGrad {
- /* The gradient of w */
+  SparseGrad() : size_k(0) {}
+
+  /* The gradient of w */
+
+  std::vector<real_t> grad_w;
+
+  /* The position of grad_w */
+
+  std::vector<index_t> position_w;
+
+  /* The gradient of v */
+
+  std::vector<real_t> grad_v;
+
+  /* The position and field of grad_v */
+
+  std::vector<index_t> position_v;
+  std::vector<int> field_v;
+
+  /* The size of the gradient of one latent vector */
+
+  int size_k;
+
+  /* Remove all the gradients, and keep the memory. */
+
+  void Clear(int k = 0) {
+    grad_w.clear();
+    position_w.clear();
+    grad_v.clear();
+    position_v.clear();
+    field_v.clear();
+    index_w.Clear();
+    index_v.Clear();
+    size_k = k;
+  }
+
+  size_t size_w() const { return position_w.size(); }
+  size_t size_v() const { return position_v.size(); }
+
+  /* Add the gradient of w to the entry of the position. */
+
+  void AddW(index_t position, real_t grad) {
+    uint32 n = position_w.size();
+    uint32 i = index_w.FindOrInsert(position, n);
+    if (i == n) {
+      position_w.push_back(position);
+      grad_w.push_back(grad);
+    } else {
+      grad_w[i] += grad;
+    }
+  }
+
+  /* Return the index of the gradient of a latent vector. A new
+     gradient is zero. */
+
+  size_t AddV(index_t position, int field = 0) {
+    uint32 n = position_v.size();
+    uint64 key = (static_cast<uint64>(position) << 32) | 
+                 static_cast<uint32>(field);
+    uint32 i = index_v.FindOrInsert(key, n);
+    if (i == n) {
+      position_v.push_back(position);
+      field_v.push_back(field);
+      grad_v.resize(grad_v.size() + size_k, 0);
+    }
+    return i;
+  }
+
+  /* The pointer is invalid after the next AddV(). */
+
+  real_t* GradV(size_t i) { return grad_v.data() + i * size_k; }
+  const real_t* GradV(size_t i) const { return grad_v.data() + i * size_k; }
+
+ private:
+  GradIndex index_w;   /* position -> index of grad_w */
+  GradIndex index_v;   /* (position, field) -> index of grad_v */
+};
+
+/* The size of a cache line in bytes, and the number of real_t in 
+   a SIMD register that the latent vectors are padded to. */
+
+const int kCacheLineSize = 64;
+const int kSIMDWidth = 8;
+
+/* Round n up to a multiple of m. */
+
+inline uint64 RoundUp(uint64 n, uint64 m) {
+  return (n + m - 1) / m * m;
+}
 
- scoped_array<real_t> grad_w;
+/* Return the first address in [p, p + kCacheLineSize) which is 
+   aligned to the cache line. p must point to an array of at least 
+   kCacheLineSize extra bytes. */
 
- /* The position of grad_w */
+inline real_t* AlignToCacheLine(real_t* p) {
+  uintptr_t address = reinterpret_cast<uintptr_t>(p);
+  return reinterpret_cast<real_t*>(RoundUp(address, kCacheLineSize));
+}
 
- scoped_array<index_t> postion_w;
+/* -----------------------------------------------------------------------------
+ * SparseTable is an open-addressing hash table, which maps a feature id to     *
+ * a block of block_size parameters. The block of a feature is allocated and    *
+ * set to the initial value on the first call of FindOrInsert(), so a model of  *
+ * billions of hashed features only pays memory for the features it has seen.   *
+ *                                                                              *
+ * The blocks are allocated from large slabs and never move, so the pointer     *
+ * to a block is valid until the table is destroyed. The slabs are aligned to   *
+ * kCacheLineSize, so the blocks are aligned too if the block size is a         *
+ * multiple of the cache line.                                                  *
+ *                                                                              *
+ * Find() does not take any lock and can run in many threads. FindOrInsert()    *
+ * takes a mutex only when it inserts a new feature. When the table grows, the  *
+ * old array of slots is kept until the table is destroyed, because other       *
+ * threads may still read it. This costs at most the memory of the current      *
+ * slots.                                                                       *
+ * -----------------------------------------------------------------------------
+ */
+
+class SparseTable {
+ public:
+  /* Every new block is a copy of init_block. */
+
+  explicit SparseTable(const std::vector<real_t>& init_block);
+  ~SparseTable();
+
+  /* Return the block of a feature, or NULL if the feature 
+     has not been inserted. */
+
+  real_t* Find(index_t key) const;
+
+  /* Return the block of a feature. Allocate and initialize
+     the block if the feature has not been inserted. */
 
- /* The size of grad_w */
+  real_t* FindOrInsert(index_t key);
 
- index_t size_w;
+  /* Append all the features in the table to keys. */
 
- /* The gradient of v */
+  void GetKeys(std::vector<index_t>* keys) const;
 
- scoped_array<real_t> grad_v;
+  /* Set the values at offsets of every block to a random value in 
+     [-scale, scale), both the blocks in the table and the new blocks
+     inserted later. The values of a feature only depend on seed and
+     the key (see RandomBlockValues()), so they are the same whichever
+     thread inserts the feature and whenever. Not thread-safe with 
+     FindOrInsert(). */
 
- /* The position of grad_v */
+  void SetRandomInit(const std::vector<uint64>& offsets, 
+                     real_t scale, uint64 seed);
 
- scoped_array<index_t> position_v;
+  /* The number of features in the table. */
 
- /* The size of grad_v */
+  uint64 size() const { return m_num_keys; }
 
- index_t size_v;
+  uint64 block_size() const { return m_block_size; }
+
+ private:
+  struct Slots {
+    uint64 mask;          /* number of slots - 1 */
+    index_t* keys;        /* kEmptyKey for an empty slot */
+    real_t** blocks;      /* block of each key */
+  };
+
+  static const index_t kEmptyKey = kUInt32Max;
+
+  uint64 m_block_size;           /* number of parameters in a block */
+  std::vector<real_t> m_init_block; /* initial value of new blocks */
+  Slots* m_slots;                /* current slots */
+  uint64 m_num_keys;             /* number of features in the table */
+  std::vector<Slots*> m_retired; /* old slots, freed by destructor */
+  std::vector<real_t*> m_slabs;  /* memory of all the blocks */
+  real_t* m_slab_begin;          /* aligned start of the last slab */
+  uint64 m_slab_remain;          /* free blocks in the last slab */
+  Mutex m_mutex;                 /* serialize the insertions */
+  std::vector<uint64> m_random_offsets; /* randomized values of a block */
+  real_t m_random_scale;         /* the range of the random values */
+  uint64 m_random_seed;          /* the seed of the random values */
+
+  static uint64 Hash(index_t key) {
+    return (key * 0x9E3779B97F4A7C15ULL) >> 17;
+  }
+
+  static Slots* NewSlots(uint64 num_slots);
+  static void DeleteSlots(Slots* slots);
+  static void InsertIntoSlots(Slots* slots, index_t key, real_t* block);
+
+  real_t* NewBlock(index_t key);
+  void RandomizeBlock(index_t key, real_t* block) const;
+  void Grow();
+
+  DISALLOW_COPY_AND_ASSIGN(SparseTable);
 };
 
 /* -----------------------------------------------------------------------------
  * Model is responsble for storing the global model parameters.                 *
  *                                                                              *
  * Note that, we represent the machine leanring model in a flat way, that is,   *
- * we store all the parameters in a single dense vector.                        *                          
+ * we store all the parameters in a single dense vector. The size of the        *
+ * vector is 64 bits, because an FFM model can have more than 4 billion         *
+ * parameters (feature_num * (1 + k * field_num)).                              *
+ *                                                                              *
+ * For a large number of hashed features, most of which never appear, we can    *
+ * store the model in the sparse mode (sparse = true). Then the parameters of   *
+ * each feature (w and its latent vectors) are kept in a SparseTable and are    *
+ * allocated on the first update. The per-feature methods (MutableW, W,         *
+ * MutableV and V) work in all modes; the const methods do not allocate and     *
+ * return the initial values for a feature which has not been updated.          *
+ *                                                                              *
+ * In the aligned mode (aligned = true), the parameters of each feature are     *
+ * stored in one block, which is aligned to the cache line:                     *
+ *                                                                              *
+ *   [ v(field 0) | v(field 1) | ... | v(field n-1) | w | zero padding ]        *
+ *                                                                              *
+ * Each latent vector is padded with zeros to GetPaddedK() (a multiple of       *
+ * kSIMDWidth), so the SIMD kernels can load aligned vectors and run over the   *
+ * padding without a scalar tail. The w of a feature is next to its latent      *
+ * vectors, so one feature touches as few cache lines as possible. The price    *
+ * is the memory of the padding, e.g., FM with k = 16 uses 32 floats for each   *
+ * feature instead of 17. The padding must stay zero, so an updater should      *
+ * only write the first k values of a latent vector.                            *
+ *                                                                              *
+ * An updater such as AdaGrad or FTRL keeps num_state values (e.g., the sum     *
+ * of squared gradients) for each parameter. They are stored in the block of    *
+ * the feature, right after its parameters, so an update of a feature reads     *
+ * and writes one contiguous block instead of two distant arrays:               *
+ *                                                                              *
+ *   [ v | w | state of w | state of v (aligned) | zero padding ]               *
+ *                                                                              *
+ * The state s of the latent vector of field f is MutableStateV(index, f, s),   *
+ * which has GetPaddedK() values. With num_state > 0, the dense mode without    *
+ * alignment also uses the blocks ([ w | v | state of w | state of v ]), so     *
+ * GetW() is not available. The state is initialized to zero.                   *
+ *                                                                              *
+ * With has_step = true, each block also keeps the step of the last update of   *
+ * the feature (LastStep() and SetLastStep()) right after the state of w, so    *
+ * an updater can apply the updates of the steps in which the feature did not   *
+ * appear (e.g., the L2 decay) lazily, when the feature appears again.          *
  * -----------------------------------------------------------------------------
  */
 
@@ -138,51 +534,35 @@ class Model {
   /* Constructor */
 
   Model(real_t init_value, ModelType type, 
-        index_t feature_num, int k, int field_num)
-     : m_feature_num(feature_num), 
-       m_k(k), 
-       m_field_num(field_num) {
-    // check the input value
-    CHECK_GT(m_feature_num, 0);
-    // Note that, for LR, m_k and m_field_num should be set to 0.
-    // For FM, just m_field_num should be set to 0.
-    CHECK_GE(m_k, 0);          
-    CHECK_GE(m_field_num, 0);
-    // allocated memory and initial model parameters 
-    if (type == LR) {
-      m_size_parameters = m_feature_num;
-    } else if (type == FM) {
-      m_size_parameters = m_feature_num * (1 + m_k);
-    } else if (type == FFM) {
-      m_size_parameters = m_feature_num * (1 + m_k * m_field_num);
-    } else {
-      LOG(FATAL) << "Unknow model type: " << type;
-    }
-    try {
-      m_parameters.reset(new real_t[m_size_parameters]);
-      Initialize(init_value, m_size_parameters);
-    } catch (std::bad_alloc&) {
-      LOG(FATAL) << "Cannot not allocate enough memory for   \
-                     current model parameters.";
-    }
-  }
+        index_t feature_num, int k, int field_num,
+        bool sparse = false, bool aligned = false,
+        int num_state = 0, bool has_step = false);
 
-  /* Return a start pointer of w and its size. 
-     Used by LR, FM, and FFM. */
+  /* Return a start pointer of w and its size. Used by LR, 
+     FM, and FFM in the dense mode without alignment and without
+     the updater states. */
 
   index_t GetW(real_t** pointer) { 
-    *pointer = m_parameters.get();
+    if (!m_flat) {
+      LOG(FATAL) << "There is no dense w in the sparse or aligned mode, "
+                 << "or with the updater states.";
+    }
+    *pointer = m_parameters;
     return m_feature_num;
   }
 
+  /* Return the dense w of all the features, or NULL if the model
+     has no dense w (see GetW()). */
+
+  const real_t* DenseW() const { return m_flat ? m_parameters : NULL; }
+
   /* Return the start pointer of a vector for specified feature,
      and return the size of this vector. Used by FM. */
 
   int GetV(real_t** pointer, int index) {
     // 0 <= index < m_feature_num
     CHECK_GE(index, 0);
-    CHECK_LT(index, m_feature_num);
-    *pointer = m_parameters.get() + m_feature_num + m_k * index;
+    *pointer = MutableV(index);
     return m_k;
   }
 
@@ -192,28 +572,198 @@ class Model {
   int GetV(real_t** pointer, int index, int field) {
     // 0 <= index < m_feature_num
     CHECK_GE(index, 0);
+    *pointer = MutableV(index, field);
+    return m_k;
+  }
+
+  /* Return the pointer to w of a feature. In the sparse mode, 
+     allocate the parameters of the feature on the first call. */
+
+  real_t* MutableW(index_t index) {
+    CHECK_LT(index, m_feature_num);
+    if (m_flat) {
+      return m_parameters + index;
+    }
+    return MutableBlock(index) + m_offset_w;
+  }
+
+  /* Return the pointer to the latent vector of a feature for
+     the field (field = 0 for FM). In the sparse mode, allocate 
+     the parameters of the feature on the first call. */
+
+  real_t* MutableV(index_t index, int field = 0) {
     CHECK_LT(index, m_feature_num);
-    // 0 <= field < m_field_num
     CHECK_GE(field, 0);
-    CHECK_LT(field, m_field_num);
-    *pointer = m_parameters.get() + m_feature_num + 
-               m_k * m_field_num * index + m_k * field;
-    return m_k;
+    CHECK_LT(field, m_num_v);
+    if (m_flat) {
+      return m_parameters + m_feature_num + 
+             m_size_block * index + m_padded_k * field;
+    }
+    return MutableBlock(index) + m_offset_v + m_padded_k * field;
   }
 
+  /* Return the pointer to the state s of w of a feature. */
+
+  real_t* MutableStateW(index_t index, int s) {
+    CHECK_LT(index, m_feature_num);
+    CHECK_GE(s, 0);
+    CHECK_LT(s, m_num_state);
+    return MutableBlock(index) + m_offset_state_w + s;
+  }
+
+  /* Return the pointer to the state s of the latent vector of 
+     a feature for the field, which has GetPaddedK() values. */
+
+  real_t* MutableStateV(index_t index, int field, int s) {
+    CHECK_LT(index, m_feature_num);
+    CHECK_GE(field, 0);
+    CHECK_LT(field, m_num_v);
+    CHECK_GE(s, 0);
+    CHECK_LT(s, m_num_state);
+    return MutableBlock(index) + m_offset_state_v + 
+           (field * m_num_state + s) * m_padded_k;
+  }
+
+  /* The step of the last update of a feature, which is 0 if the 
+     feature has never been updated. */
+
+  uint32 LastStep(index_t index) const {
+    CHECK_LT(index, m_feature_num);
+    CHECK(m_has_step);
+    const uint32* slot = 
+        reinterpret_cast<const uint32*>(Block(index) + m_offset_step);
+    return __atomic_load_n(slot, __ATOMIC_RELAXED);
+  }
+
+  void SetLastStep(index_t index, uint32 step) {
+    __atomic_store_n(MutableLastStep(index), step, __ATOMIC_RELAXED);
+  }
+
+  /* The slot of the last step, which is shared by the Hogwild threads
+     and must be accessed by the __atomic builtins. The slot is one
+     real_t, which has the size and the alignment of uint32. */
+
+  uint32* MutableLastStep(index_t index) {
+    CHECK_LT(index, m_feature_num);
+    CHECK(m_has_step);
+    return reinterpret_cast<uint32*>(MutableBlock(index) + m_offset_step);
+  }
+
+  /* Return all the features in the model, that is, the allocated 
+     features in the sparse mode, and [0, feature_num) otherwise. */
+
+  void GetFeatures(std::vector<index_t>* features) const;
+
+  /* Read-only version of MutableW(), which never allocates. */
+
+  const real_t* W(index_t index) const {
+    CHECK_LT(index, m_feature_num);
+    if (m_flat) {
+      return m_parameters + index;
+    }
+    return Block(index) + m_offset_w;
+  }
+
+  /* Read-only version of MutableV(), which never allocates. */
+
+  const real_t* V(index_t index, int field = 0) const {
+    CHECK_LT(index, m_feature_num);
+    CHECK_GE(field, 0);
+    CHECK_LT(field, m_num_v);
+    if (m_flat) {
+      return m_parameters + m_feature_num + 
+             m_size_block * index + m_padded_k * field;
+    }
+    return Block(index) + m_offset_v + m_padded_k * field;
+  }
+
+  /* The distance between two latent vectors of a feature, which is 
+     k padded to a multiple of kSIMDWidth in the aligned mode. The 
+     values after the first k of a latent vector are zero. In all 
+     the modes, the latent vectors of a feature are contiguous, so
+     V(index, field) == V(index) + field * GetPaddedK(). */
+
+  int GetPaddedK() const { return m_padded_k; }
+
+  /* The number of parameters of the model. In the sparse mode,
+     only the allocated parameters are counted. */
+
+  uint64 GetSizeParameters() const {
+    return m_sparse ? m_table->size() * m_table->block_size() 
+                    : m_size_parameters;
+  }
+
+  bool IsSparse() const { return m_sparse; }
+  bool IsAligned() const { return m_aligned; }
+
+  ModelType GetType() const { return m_type; }
+  index_t GetFeatureNum() const { return m_feature_num; }
+  int GetK() const { return m_k; }
+  int GetFieldNum() const { return m_field_num; }
+  int GetNumV() const { return m_num_v; }
+  int GetNumState() const { return m_num_state; }
+  bool HasStep() const { return m_has_step; }
+
+  /* Set the first k values of every latent vector to a random value
+     in [-scale, scale). A model with all-zero latent vectors has zero
+     gradients of v (FM and FFM), so the latent vectors should be 
+     randomized before training. In the sparse mode, a feature is 
+     randomized when its block is allocated, with the same values as 
+     the dense mode; a feature which has not been allocated still 
+     reads init_value. */
+
+  void RandomizeV(real_t scale, uint64 seed);
+
  private:
-  scoped_array<real_t> m_parameters;   /* To store the model parameters */
+  scoped_array<real_t> m_memory;       /* The memory of dense parameters */
+  real_t* m_parameters;                /* To store the model parameters */
+  ModelType m_type;                    /* LR, FM, or FFM */
   index_t m_feature_num;               /* number of features */ 
   int m_k;                             /* The size of k (for FM and FFM) */
   int m_field_num;                     /* The number of field (only for FFM) */
-  index_t m_size_parameters;           /* The size of total parameters */
+  int m_num_v;                         /* The number of v of one feature */
+  int m_padded_k;                      /* The distance between two v */
+  int m_num_state;                     /* The number of updater states 
+                                          of one parameter */
+  bool m_has_step;                     /* Whether keep the last step of 
+                                          each feature */
+  bool m_sparse;                       /* Whether use the sparse mode */
+  bool m_aligned;                      /* Whether use the aligned layout */
+  bool m_flat;                         /* Dense and not aligned: all w 
+                                          first, then all v */
+  uint64 m_size_block;                 /* The size of one feature's block 
+                                          (v of one feature if m_flat) */
+  uint64 m_offset_w;                   /* The offset of w in a block */
+  uint64 m_offset_v;                   /* The offset of v in a block */
+  uint64 m_offset_state_w;             /* The offset of the state of w */
+  uint64 m_offset_state_v;             /* The offset of the state of v */
+  uint64 m_offset_step;                /* The offset of the last step */
+  uint64 m_size_parameters;            /* The size of total parameters */
+  scoped_ptr<SparseTable> m_table;     /* The parameters in sparse mode */
+  std::vector<real_t> m_init_block;    /* Initial block of a feature */
+
+  /* The offsets of the first k values of all v in a block. */
+
+  void GetVOffsets(std::vector<uint64>* offsets) const;
+
+  /* Return the block of a feature. */
+
+  real_t* MutableBlock(index_t index) {
+    if (m_sparse) {
+      return m_table->FindOrInsert(index);
+    }
+    return m_parameters + m_size_block * index;
+  }
 
-  /* Initial the model parameters */
+  /* Return the block of a feature, or the initial block 
+     if the feature is not allocated in the sparse mode. */
 
-  void Initialize(real_t init_val, index_t len) {
-    for (index_t i = 0; i < len; ++i) {
-      *(m_parameters.get() + i) = init_val;
+  const real_t* Block(index_t index) const {
+    if (m_sparse) {
+      const real_t* block = m_table->Find(index);
+      return block != NULL ? block : m_init_block.data();
     }
+    return m_parameters + m_size_block * index;
   }
 
   DISALLOW_COPY_AND_ASSIGN(Model);
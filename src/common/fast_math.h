@@ -0,0 +1,108 @@
+/*
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or (at
+your option) any later version.
+
+This program is distributed in the hope that it will be useful, but
+WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+02110-1301, USA.
+*/
+
+/* 
+Copyright (c) 2016 by contributors.
+Author: Chao Ma (mctt90@gmail.com)
+
+This file defines the fast approximations of exp() and log1p(),
+which are used to evaluate the log loss.
+*/
+
+#ifndef F2M_COMMON_FAST_MATH_H_
+#define F2M_COMMON_FAST_MATH_H_
+
+#include <string.h>
+
+#include "src/common/common.h"
+#include "src/common/data_structure.h"
+
+namespace f2m {
+
+/* -----------------------------------------------------------------------------
+ * FastExp(x) computes exp(x) = 2^i * 2^f, where i = round(x * log2(e)) and     *
+ * f is in [-0.5, 0.5]. The 2^i is built from the bits of a float, and the      *
+ * e^(f * log(2)) is a polynomial of degree 6. The relative error is 2e-7 for   *
+ * |x| <= 1, and |x| * 2e-7 for a larger x, which comes from the rounding of    *
+ * x * log2(e) in float. x is clamped to [-87, 88], so the result is never 0    *
+ * or inf.                                                                      *
+ *                                                                              *
+ * FastLog1p(x) computes log(1 + x) for x > -1 by log(1 + x) = e * log(2) +     *
+ * log(m), where 1 + x = m * 2^e and m is in [sqrt(0.5), sqrt(2)). The log(m)   *
+ * is 2 * atanh(s) with s = (m - 1) / (m + 1), which is a short odd series      *
+ * since |s| < 0.18. For a small x, 1 + x loses the low bits of x, so the       *
+ * result is scaled by x / ((1 + x) - 1), which corrects the rounding.          *
+ *                                                                              *
+ * Both are inline, branch-free and call no libm function, so a loop over       *
+ * them can be vectorized. GCC only does so with -fno-trapping-math, which is   *
+ * set for logit_loss.cc; there the log loss runs about 1.5x faster than with   *
+ * log(1 + exp(x)) of libm.                                                     *
+ * -----------------------------------------------------------------------------
+ */
+
+inline real_t FastExp(real_t x) {
+  x = x < -87.0f ? -87.0f : x;
+  x = x > 88.0f ? 88.0f : x;
+  real_t t = x * 1.44269504f;           // x * log2(e)
+  int i = static_cast<int>(t + (t < 0 ? -0.5f : 0.5f));
+  real_t f = (t - i) * 0.69314718f;     // 2^(t - i) = e^f
+  // e^f, |f| <= log(2) / 2
+  real_t p = 1.0f + f * (1.0f + f * (0.5f + f * (1.6666667e-1f + 
+             f * (4.1666667e-2f + f * (8.3333333e-3f + 
+             f * 1.3888889e-3f)))));
+  uint32 bits = static_cast<uint32>(i + 127) << 23;
+  real_t scale;
+  memcpy(&scale, &bits, sizeof(scale));
+  return p * scale;
+}
+
+inline real_t FastLog1p(real_t x) {
+  real_t y = 1.0f + x;
+  uint32 bits;
+  memcpy(&bits, &y, sizeof(bits));
+  int e = static_cast<int>((bits >> 23) & 0xFF) - 127;
+  // m in [1, 2)
+  bits = (bits & 0x007FFFFF) | 0x3F800000;
+  real_t m;
+  memcpy(&m, &bits, sizeof(m));
+  // m in [sqrt(0.5), sqrt(2))
+  bool large = m > 1.41421356f;
+  m = large ? m * 0.5f : m;
+  e = large ? e + 1 : e;
+  real_t s = (m - 1.0f) / (m + 1.0f);
+  real_t s2 = s * s;
+  real_t log_m = 2.0f * s * (1.0f + s2 * (0.33333333f + s2 * (0.2f + 
+                 s2 * (0.14285714f + s2 * 0.11111111f))));
+  // y - 1 is exact, and corrects the rounding error of 1 + x.
+  // Both sides are computed, so the select has no branch.
+  real_t d = y - 1.0f;
+  real_t ratio = x / (d == 0 ? 1.0f : d);
+  real_t result = (e * 0.69314718f + log_m) * ratio;
+  return d == 0 ? x : result;
+}
+
+/* log(1 + exp(z)) = max(z, 0) + log(1 + exp(-|z|)), so exp() never
+   overflows. */
+
+inline real_t FastLog1pExp(real_t z) {
+  real_t a = z < 0 ? -z : z;
+  return (z > 0 ? z : 0) + FastLog1p(FastExp(-a));
+}
+
+} // namespace f2m
+
+#endif // F2M_COMMON_FAST_MATH_H_
@@ -0,0 +1,66 @@
+/*
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or (at
+your option) any later version.
+
+This program is distributed in the hope that it will be useful, but
+WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+02110-1301, USA.
+*/
+
+/* 
+Copyright (c) 2016 by contributors.
+Author: Chao Ma (mctt90@gmail.com)
+
+This file is the implementation of linear_algebra.h
+*/
+
+#include "src/common/linear_algebra.h"
+
+namespace f2m {
+
+/* The arguments of SpMVBlock() */
+
+struct SpMVArgs {
+  const SIMDKernels* kernels;
+  const DataMatrix* matrix;
+  const real_t* dense_vector;
+  real_t* result;
+};
+
+/* Multiply the rows [begin, end) as a CSR matrix of their own. */
+
+static void SpMVBlock(void* arg, int begin, int end) {
+  const SpMVArgs* args = reinterpret_cast<const SpMVArgs*>(arg);
+  const DataMatrix& matrix = *args->matrix;
+  args->kernels->SparseDot(matrix.x.data(),
+                           matrix.position.data(),
+                           matrix.row_offset.data() + begin,
+                           end - begin,
+                           args->dense_vector,
+                           args->result + begin);
+}
+
+void SparseMatrixDenseVectorTimes(const DataMatrix& matrix, 
+                                  const real_t* dense_vector,
+                                  std::vector<real_t>* result,
+                                  ThreadPool* pool,
+                                  SIMDLevel level) {
+  CHECK_NOTNULL(pool);
+  CHECK_EQ(matrix.size(), result->size());
+  SpMVArgs args;
+  args.kernels = &GetSIMDKernels(level);
+  args.matrix = &matrix;
+  args.dense_vector = dense_vector;
+  args.result = result->data();
+  pool->ParallelFor(0, matrix.size(), kRowsPerBlock, SpMVBlock, &args);
+}
+
+} // namespace f2m
@@ -26,7 +26,12 @@ operations used in f2m.
 #ifndef F2M_COMMON_LINEAR_ALGERBA_H_
 #define F2M_COMMON_LINEAR_ALGERBA_H_
 
+#include <vector>
+
 #include "src/common/common.h"
+#include "src/common/data_structure.h"
+#include "src/common/simd.h"
+#include "src/common/thread_pool.h"
 
 namespace f2m {
 
@@ -42,11 +47,11 @@ namespace f2m {
  * -----------------------------------------------------------------------------
  */
 
-void SparseVectorDenseVectorTimes(const real_t* sparse_vector,
-	                              const index_t* position,
-	                              const int vec_size,
-	                              const real_t* dense_vector,
-	                              real_t* result) {
+inline void SparseVectorDenseVectorTimes(const real_t* sparse_vector,
+                                         const index_t* position,
+                                         const int vec_size,
+                                         const real_t* dense_vector,
+                                         real_t* result) {
   *result = 0;
   for (int i = 0; i < vec_size; ++i) {
   	index_t idx = position[i];
@@ -64,25 +69,45 @@ void SparseVectorDenseVectorTimes(const real_t* sparse_vector,
  *                    4                                                         *
  *                                                                              *
  * Note that the result vector should be pre-allocated with                     *
- * the same row size of matrix.                                                 * 
+ * the same row size of matrix.                                                 *
+ * The matrix is stored in CSR format, so we scan all the values of the         *
+ * matrix in a single pass over the contiguous arrays, with the SparseDot()     *
+ * kernel of simd.h. The scalar kernel is the default; a caller can pass        *
+ * kAVX2 (gather and prefetch) if linear_algebra_benchmark shows a win on       *
+ * its machine.                                                                 *
+ *                                                                              *
+ * With a ThreadPool, the rows are cut into blocks of kRowsPerBlock rows,       *
+ * and each block is a CSR matrix of its own (row_offset + begin), so the       *
+ * threads run the same kernel on disjoint parts of x, position and result.     *
  * -----------------------------------------------------------------------------
  */
 
-void SparseMatrixDenseVectorTimes(const DataMatrix& matrix, 
-	                              const real_t* dense_vector,
-	                              std::vector<real_t>* result) {
+inline void SparseMatrixDenseVectorTimes(const DataMatrix& matrix, 
+                                         const real_t* dense_vector,
+                                         std::vector<real_t>* result,
+                                         SIMDLevel level = kScalar) {
   CHECK_EQ(matrix.size(), result->size());
-  for (int row = 0; row < matrix.size(); ++row) {
-  	real_t res = 0;
-  	SparseVectorDenseVectorTimes(matrix[row].x.get(), 
-  		                         matrix[row].position.get(),
-  		                         matrix[row].size,
-  		                         dense_vector,
-  		                         &res);
-  	(*result)[row] = res;
+  if (matrix.size() == 0) {
+    return;
   }
+  GetSIMDKernels(level).SparseDot(matrix.x.data(),
+                                  matrix.position.data(),
+                                  matrix.row_offset.data(),
+                                  matrix.size(),
+                                  dense_vector,
+                                  result->data());
 }
 
+/* The number of rows in a block of the parallel version. */
+
+const int kRowsPerBlock = 4096;
+
+void SparseMatrixDenseVectorTimes(const DataMatrix& matrix, 
+                                  const real_t* dense_vector,
+                                  std::vector<real_t>* result,
+                                  ThreadPool* pool,
+                                  SIMDLevel level = kScalar);
+
 } // namespace f2m
 
 #endif // F2M_COMMON_LINEAR_ALGEBRA_H_
\ No newline at end of file
@@ -0,0 +1,319 @@
+/*
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or (at
+your option) any later version.
+
+This program is distributed in the hope that it will be useful, but
+WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+02110-1301, USA.
+*/
+
+/* 
+Copyright (c) 2016 by contributors.
+Author: Chao Ma (mctt90@gmail.com)
+
+This file is the implementation of simd.h
+*/
+
+#include "src/common/simd.h"
+
+#if defined __GNUC__ && (defined __x86_64__ || defined __i386__)
+#define F2M_X86_SIMD
+#include <immintrin.h>
+#endif
+
+namespace f2m {
+
+//------------------------------------------------------------------------------
+// Scalar kernels
+//------------------------------------------------------------------------------
+
+static real_t DotScalar(const real_t* a, const real_t* b, int size) {
+  real_t sum = 0;
+  for (int i = 0; i < size; ++i) {
+    sum += a[i] * b[i];
+  }
+  return sum;
+}
+
+static void AxpyScalar(real_t alpha, const real_t* a, real_t* y, int size) {
+  for (int i = 0; i < size; ++i) {
+    y[i] += alpha * a[i];
+  }
+}
+
+static void SparseDotScalar(const real_t* x, 
+                            const index_t* position,
+                            const uint64* row_offset,
+                            int num_rows,
+                            const real_t* dense,
+                            real_t* result) {
+  for (int r = 0; r < num_rows; ++r) {
+    real_t sum = 0;
+    for (uint64 i = row_offset[r]; i < row_offset[r + 1]; ++i) {
+      sum += x[i] * dense[position[i]];
+    }
+    result[r] = sum;
+  }
+}
+
+#ifdef F2M_X86_SIMD
+
+/* The gather kernels prefetch the dense values of kPrefetchDistance
+   positions ahead, which are usually in the next row. */
+
+static const uint64 kPrefetchDistance = 32;
+
+/* Prefetch dense[position[i]] for the n positions from i. */
+
+static inline void PrefetchDense(const real_t* dense,
+                                 const index_t* position,
+                                 uint64 i, int n) {
+  for (int j = 0; j < n; ++j) {
+    _mm_prefetch(reinterpret_cast<const char*>(dense + position[i + j]),
+                 _MM_HINT_T0);
+  }
+}
+
+//------------------------------------------------------------------------------
+// SSE kernels (4 floats)
+//------------------------------------------------------------------------------
+
+__attribute__((target("sse2")))
+static real_t DotSSE(const real_t* a, const real_t* b, int size) {
+  __m128 sum = _mm_setzero_ps();
+  int i = 0;
+  for (; i + 4 <= size; i += 4) {
+    sum = _mm_add_ps(sum, _mm_mul_ps(_mm_loadu_ps(a + i), 
+                                     _mm_loadu_ps(b + i)));
+  }
+  // horizontal sum of 4 floats
+  sum = _mm_add_ps(sum, _mm_movehl_ps(sum, sum));
+  sum = _mm_add_ss(sum, _mm_shuffle_ps(sum, sum, 1));
+  real_t result = _mm_cvtss_f32(sum);
+  for (; i < size; ++i) {
+    result += a[i] * b[i];
+  }
+  return result;
+}
+
+__attribute__((target("sse2")))
+static void AxpySSE(real_t alpha, const real_t* a, real_t* y, int size) {
+  __m128 va = _mm_set1_ps(alpha);
+  int i = 0;
+  for (; i + 4 <= size; i += 4) {
+    __m128 vy = _mm_add_ps(_mm_loadu_ps(y + i), 
+                           _mm_mul_ps(va, _mm_loadu_ps(a + i)));
+    _mm_storeu_ps(y + i, vy);
+  }
+  for (; i < size; ++i) {
+    y[i] += alpha * a[i];
+  }
+}
+
+/* SSE has no gather instruction, so this is the scalar loop with
+   the prefetch. */
+
+__attribute__((target("sse2")))
+static void SparseDotSSE(const real_t* x, 
+                         const index_t* position,
+                         const uint64* row_offset,
+                         int num_rows,
+                         const real_t* dense,
+                         real_t* result) {
+  const uint64 end = row_offset[num_rows];
+  for (int r = 0; r < num_rows; ++r) {
+    real_t sum = 0;
+    for (uint64 i = row_offset[r]; i < row_offset[r + 1]; ++i) {
+      if (i + kPrefetchDistance < end) {
+        PrefetchDense(dense, position, i + kPrefetchDistance, 1);
+      }
+      sum += x[i] * dense[position[i]];
+    }
+    result[r] = sum;
+  }
+}
+
+//------------------------------------------------------------------------------
+// AVX2 kernels (8 floats, with FMA)
+//------------------------------------------------------------------------------
+
+__attribute__((target("avx2,fma")))
+static real_t DotAVX2(const real_t* a, const real_t* b, int size) {
+  __m256 sum = _mm256_setzero_ps();
+  int i = 0;
+  for (; i + 8 <= size; i += 8) {
+    sum = _mm256_fmadd_ps(_mm256_loadu_ps(a + i), 
+                          _mm256_loadu_ps(b + i), sum);
+  }
+  // horizontal sum of 8 floats
+  __m128 half = _mm_add_ps(_mm256_castps256_ps128(sum), 
+                           _mm256_extractf128_ps(sum, 1));
+  half = _mm_add_ps(half, _mm_movehl_ps(half, half));
+  half = _mm_add_ss(half, _mm_shuffle_ps(half, half, 1));
+  real_t result = _mm_cvtss_f32(half);
+  for (; i < size; ++i) {
+    result += a[i] * b[i];
+  }
+  return result;
+}
+
+__attribute__((target("avx2,fma")))
+static void AxpyAVX2(real_t alpha, const real_t* a, real_t* y, int size) {
+  __m256 va = _mm256_set1_ps(alpha);
+  int i = 0;
+  for (; i + 8 <= size; i += 8) {
+    _mm256_storeu_ps(y + i, _mm256_fmadd_ps(va, _mm256_loadu_ps(a + i),
+                                            _mm256_loadu_ps(y + i)));
+  }
+  for (; i < size; ++i) {
+    y[i] += alpha * a[i];
+  }
+}
+
+__attribute__((target("avx2,fma")))
+static void SparseDotAVX2(const real_t* x, 
+                          const index_t* position,
+                          const uint64* row_offset,
+                          int num_rows,
+                          const real_t* dense,
+                          real_t* result) {
+  const uint64 end = row_offset[num_rows];
+  for (int r = 0; r < num_rows; ++r) {
+    __m256 sum = _mm256_setzero_ps();
+    uint64 i = row_offset[r];
+    const uint64 row_end = row_offset[r + 1];
+    for (; i + 8 <= row_end; i += 8) {
+      if (i + kPrefetchDistance + 8 <= end) {
+        PrefetchDense(dense, position, i + kPrefetchDistance, 8);
+      }
+      // position is unsigned, so the indices are zero-extended to 
+      // 64 bits (the 32-bit gather would see 2^31 as negative).
+      __m128i low = _mm_loadu_si128(
+          reinterpret_cast<const __m128i*>(position + i));
+      __m128i high = _mm_loadu_si128(
+          reinterpret_cast<const __m128i*>(position + i + 4));
+      __m128 value_low = _mm256_i64gather_ps(
+          dense, _mm256_cvtepu32_epi64(low), 4);
+      __m128 value_high = _mm256_i64gather_ps(
+          dense, _mm256_cvtepu32_epi64(high), 4);
+      __m256 value = _mm256_insertf128_ps(
+          _mm256_castps128_ps256(value_low), value_high, 1);
+      sum = _mm256_fmadd_ps(_mm256_loadu_ps(x + i), value, sum);
+    }
+    __m128 half = _mm_add_ps(_mm256_castps256_ps128(sum), 
+                             _mm256_extractf128_ps(sum, 1));
+    half = _mm_add_ps(half, _mm_movehl_ps(half, half));
+    half = _mm_add_ss(half, _mm_shuffle_ps(half, half, 1));
+    real_t res = _mm_cvtss_f32(half);
+    for (; i < row_end; ++i) {
+      res += x[i] * dense[position[i]];
+    }
+    result[r] = res;
+  }
+}
+
+//------------------------------------------------------------------------------
+// AVX-512 kernels (16 floats, with a masked tail)
+//------------------------------------------------------------------------------
+
+/* Horizontal sum of 16 floats: fold 512 -> 128 bits, then SSE.
+   The masked forms avoid a false -Wuninitialized of GCC in the 
+   unmasked intrinsics. */
+
+__attribute__((target("avx512f")))
+static inline real_t HorizontalSumAVX512(__m512 sum) {
+  sum = _mm512_add_ps(sum, _mm512_mask_shuffle_f32x4(sum, 0xFFFF, 
+                                                     sum, sum, 0x4E));
+  sum = _mm512_add_ps(sum, _mm512_mask_shuffle_f32x4(sum, 0xFFFF, 
+                                                     sum, sum, 0xB1));
+  __m128 quarter = _mm512_mask_extractf32x4_ps(_mm_setzero_ps(), 0xF,
+                                               sum, 0);
+  quarter = _mm_add_ps(quarter, _mm_movehl_ps(quarter, quarter));
+  quarter = _mm_add_ss(quarter, _mm_shuffle_ps(quarter, quarter, 1));
+  return _mm_cvtss_f32(quarter);
+}
+
+__attribute__((target("avx512f")))
+static real_t DotAVX512(const real_t* a, const real_t* b, int size) {
+  __m512 sum = _mm512_setzero_ps();
+  int i = 0;
+  for (; i + 16 <= size; i += 16) {
+    sum = _mm512_fmadd_ps(_mm512_loadu_ps(a + i), 
+                          _mm512_loadu_ps(b + i), sum);
+  }
+  if (i < size) {
+    __mmask16 mask = (1U << (size - i)) - 1;
+    sum = _mm512_fmadd_ps(_mm512_maskz_loadu_ps(mask, a + i),
+                          _mm512_maskz_loadu_ps(mask, b + i), sum);
+  }
+  return HorizontalSumAVX512(sum);
+}
+
+__attribute__((target("avx512f")))
+static void AxpyAVX512(real_t alpha, const real_t* a, real_t* y, int size) {
+  __m512 va = _mm512_set1_ps(alpha);
+  int i = 0;
+  for (; i + 16 <= size; i += 16) {
+    _mm512_storeu_ps(y + i, _mm512_fmadd_ps(va, _mm512_loadu_ps(a + i),
+                                            _mm512_loadu_ps(y + i)));
+  }
+  if (i < size) {
+    __mmask16 mask = (1U << (size - i)) - 1;
+    __m512 vy = _mm512_fmadd_ps(va, _mm512_maskz_loadu_ps(mask, a + i),
+                                _mm512_maskz_loadu_ps(mask, y + i));
+    _mm512_mask_storeu_ps(y + i, mask, vy);
+  }
+}
+
+#endif  // F2M_X86_SIMD
+
+//------------------------------------------------------------------------------
+// Runtime dispatch
+//------------------------------------------------------------------------------
+
+static const SIMDKernels kKernels[] = {
+  { kScalar, "scalar", DotScalar, AxpyScalar, SparseDotScalar },
+#ifdef F2M_X86_SIMD
+  { kSSE, "sse", DotSSE, AxpySSE, SparseDotSSE },
+  { kAVX2, "avx2", DotAVX2, AxpyAVX2, SparseDotAVX2 },
+  // The 64-bit gather of AVX-512 reads 8 values like two of AVX2, 
+  // so AVX-512 uses the AVX2 SparseDot().
+  { kAVX512, "avx512", DotAVX512, AxpyAVX512, SparseDotAVX2 },
+#endif
+};
+
+SIMDLevel DetectSIMDLevel() {
+#ifdef F2M_X86_SIMD
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx512f")) {
+    return kAVX512;
+  }
+  if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma")) {
+    return kAVX2;
+  }
+  if (__builtin_cpu_supports("sse2")) {
+    return kSSE;
+  }
+#endif
+  return kScalar;
+}
+
+const SIMDKernels& GetSIMDKernels(SIMDLevel level) {
+  SIMDLevel best = DetectSIMDLevel();
+  return kKernels[level < best ? level : best];
+}
+
+const SIMDKernels& GetSIMDKernels() {
+  static const SIMDKernels& kernels = GetSIMDKernels(DetectSIMDLevel());
+  return kernels;
+}
+
+} // namespace f2m
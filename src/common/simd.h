@@ -0,0 +1,107 @@
+/*
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or (at
+your option) any later version.
+
+This program is distributed in the hope that it will be useful, but
+WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+02110-1301, USA.
+*/
+
+/* 
+Copyright (c) 2016 by contributors.
+Author: Chao Ma (mctt90@gmail.com)
+
+This file defines the SIMD kernels of dense real_t vectors, which
+are used by the inner loops of FM and FFM.
+*/
+
+#ifndef F2M_COMMON_SIMD_H_
+#define F2M_COMMON_SIMD_H_
+
+#include "src/common/common.h"
+#include "src/common/data_structure.h"
+
+namespace f2m {
+
+/* -----------------------------------------------------------------------------
+ * The kernels are compiled for each instruction set (scalar, SSE, AVX2 and     *
+ * AVX-512), and the best one supported by the CPU is chosen at run time by     *
+ * CPUID, so one binary runs on all the x86 machines:                           *
+ *                                                                              *
+ *   const SIMDKernels& kernels = GetSIMDKernels();                             *
+ *                                                                              *
+ *   real_t dot = kernels.Dot(a, b, k);    // <a, b>                            *
+ *   kernels.Axpy(alpha, a, y, k);         // y += alpha * a                    *
+ *                                                                              *
+ * SparseDot() is the gather kernel of SparseMatrixDenseVectorTimes(): it       *
+ * reads dense[position[i]] with the AVX2 gather instruction (64-bit indices,   *
+ * so every uint32 position works), and prefetches the dense values of          *
+ * kPrefetchDistance positions ahead, since the positions of a sparse row are   *
+ * random and most of the reads miss the cache when the dense vector is large.  *
+ * linear_algebra_benchmark has not shown a consistent win over the scalar      *
+ * kernel, so SparseMatrixDenseVectorTimes() uses the scalar one by default.    *
+ *                                                                              *
+ * The kernels use unaligned loads and a scalar tail, so they work for any k    *
+ * and any address. With the aligned layout of Model, k is padded to a          *
+ * multiple of kSIMDWidth, and the tail is never used.                          *
+ *                                                                              *
+ * On other platforms, only the scalar kernels are available.                   *
+ * -----------------------------------------------------------------------------
+ */
+
+enum SIMDLevel {
+  kScalar = 0,
+  kSSE = 1,
+  kAVX2 = 2,
+  kAVX512 = 3
+};
+
+struct SIMDKernels {
+  SIMDLevel level;
+  const char* name;
+
+  /* Return the inner product of a and b. */
+
+  real_t (*Dot)(const real_t* a, const real_t* b, int size);
+
+  /* y += alpha * a */
+
+  void (*Axpy)(real_t alpha, const real_t* a, real_t* y, int size);
+
+  /* result[r] = <X[r], dense> for the num_rows rows of a CSR matrix X,
+     where X[r] is x[i] at position[i] for i in [row_offset[r], 
+     row_offset[r + 1]). The offsets index x and position from their
+     start, so a block of rows is row_offset + begin and result + begin. */
+
+  void (*SparseDot)(const real_t* x, 
+                    const index_t* position,
+                    const uint64* row_offset,
+                    int num_rows,
+                    const real_t* dense,
+                    real_t* result);
+};
+
+/* Return the best SIMD level supported by the CPU. */
+
+SIMDLevel DetectSIMDLevel();
+
+/* Return the kernels of the best level supported by the CPU. */
+
+const SIMDKernels& GetSIMDKernels();
+
+/* Return the kernels of the level, or the kernels of the best 
+   supported level if the CPU does not support the level. */
+
+const SIMDKernels& GetSIMDKernels(SIMDLevel level);
+
+} // namespace f2m
+
+#endif // F2M_COMMON_SIMD_H_
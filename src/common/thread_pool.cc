@@ -0,0 +1,132 @@
+/*
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or (at
+your option) any later version.
+
+This program is distributed in the hope that it will be useful, but
+WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+02110-1301, USA.
+*/
+
+/* 
+Copyright (c) 2016 by contributors.
+Author: Chao Ma (mctt90@gmail.com)
+
+This file is the implementation of thread_pool.h
+*/
+
+#include "src/common/thread_pool.h"
+
+namespace f2m {
+
+/* Constructor */
+
+ThreadPool::ThreadPool(int num_threads)
+  : mutex_(false),
+    generation_(0),
+    num_running_(0),
+    stop_(false),
+    task_(NULL),
+    arg_(NULL),
+    end_(0),
+    grain_(1),
+    next_(0) {
+  CHECK_GT(num_threads, 0);
+  threads_.resize(num_threads - 1);
+  for (int i = 0; i < threads_.size(); ++i) {
+    if (pthread_create(&threads_[i], NULL, WorkerThread, this) != 0) {
+      LOG(FATAL) << "Cannot create worker thread.";
+    }
+  }
+}
+
+/* Destructor */
+
+ThreadPool::~ThreadPool() {
+  {
+    MutexLocker locker(&mutex_);
+    stop_ = true;
+    start_.Broadcast();
+  }
+  for (int i = 0; i < threads_.size(); ++i) {
+    pthread_join(threads_[i], NULL);
+  }
+}
+
+void ThreadPool::ParallelFor(int begin, int end, int grain, 
+                             Task task, void* arg) {
+  CHECK_NOTNULL(task);
+  CHECK_GT(grain, 0);
+  if (begin >= end) {
+    return;
+  }
+  // A single block is not worth waking up the workers.
+  if (threads_.empty() || end - begin <= grain) {
+    task(arg, begin, end);
+    return;
+  }
+  {
+    MutexLocker locker(&mutex_);
+    task_ = task;
+    arg_ = arg;
+    end_ = end;
+    grain_ = grain;
+    next_ = begin;
+    num_running_ = threads_.size();
+    ++generation_;
+    start_.Broadcast();
+  }
+  RunBlocks();
+  MutexLocker locker(&mutex_);
+  while (num_running_ > 0) {
+    done_.Wait(&mutex_);
+  }
+}
+
+void* ThreadPool::WorkerThread(void* pool) {
+  reinterpret_cast<ThreadPool*>(pool)->WorkerLoop();
+  return NULL;
+}
+
+void ThreadPool::WorkerLoop() {
+  uint64 seen = 0;
+  for (;;) {
+    {
+      MutexLocker locker(&mutex_);
+      while (generation_ == seen && !stop_) {
+        start_.Wait(&mutex_);
+      }
+      if (stop_) {
+        return;
+      }
+      seen = generation_;
+    }
+    RunBlocks();
+    MutexLocker locker(&mutex_);
+    if (--num_running_ == 0) {
+      done_.Signal();
+    }
+  }
+}
+
+/* The fields of the loop are written under mutex_ before the 
+   workers are woken up, so they can be read without the lock. */
+
+void ThreadPool::RunBlocks() {
+  for (;;) {
+    int begin = __atomic_fetch_add(&next_, grain_, __ATOMIC_RELAXED);
+    if (begin >= end_) {
+      break;
+    }
+    task_(arg_, begin, end_ - begin < grain_ ? end_ : begin + grain_);
+  }
+}
+
+} // namespace f2m
@@ -0,0 +1,111 @@
+/*
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or (at
+your option) any later version.
+
+This program is distributed in the hope that it will be useful, but
+WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+02110-1301, USA.
+*/
+
+/* 
+Copyright (c) 2016 by contributors.
+Author: Chao Ma (mctt90@gmail.com)
+
+This file defines ThreadPool, which runs a parallel for loop 
+on a fixed set of threads.
+*/
+
+#ifndef F2M_COMMON_THREAD_POOL_H_
+#define F2M_COMMON_THREAD_POOL_H_
+
+#include <pthread.h>
+
+#include <vector>
+
+#include "src/common/common.h"
+
+namespace f2m {
+
+/* -----------------------------------------------------------------------------
+ * ThreadPool keeps num_threads - 1 worker threads alive and runs a loop        *
+ * of [begin, end) in parallel on them and the calling thread:                  *
+ *                                                                              *
+ *   void Square(void* arg, int begin, int end) {                               *
+ *     real_t* a = reinterpret_cast<real_t*>(arg);                              *
+ *     for (int i = begin; i < end; ++i) a[i] *= a[i];                          *
+ *   }                                                                          *
+ *                                                                              *
+ *   ThreadPool pool(4);                                                        *
+ *   pool.ParallelFor(0, n, 1024, Square, a);   // return when all done         *
+ *                                                                              *
+ * The range is cut into blocks of grain items, and every thread takes the      *
+ * next block by an atomic counter until no block is left, so a slow block      *
+ * does not hold up the others. The grain should be large enough (thousands     *
+ * of rows) that the cost of taking a block is negligible.                      *
+ *                                                                              *
+ * Creating the threads costs far more than a loop over one batch, which is     *
+ * why the threads are created once and wait on a ConditionVariable between     *
+ * two calls. ParallelFor() can be called by one thread at a time.              *
+ * -----------------------------------------------------------------------------
+ */
+
+class ThreadPool {
+ public:
+  /* The task of a block: run the items [begin, end) with arg. */
+
+  typedef void (*Task)(void* arg, int begin, int end);
+
+  /* Start num_threads - 1 worker threads. With num_threads = 1,
+     ParallelFor() runs in the calling thread only. */
+
+  explicit ThreadPool(int num_threads);
+
+  /* Stop and join all the worker threads. */
+
+  ~ThreadPool();
+
+  /* Run task on the blocks of [begin, end), and return when all 
+     the blocks are done. */
+
+  void ParallelFor(int begin, int end, int grain, Task task, void* arg);
+
+  int num_threads() const { return threads_.size() + 1; }
+
+ private:
+  std::vector<pthread_t> threads_;
+
+  Mutex mutex_;
+  ConditionVariable start_;       /* signaled when a loop starts */
+  ConditionVariable done_;        /* signaled when a worker is done */
+  uint64 generation_;             /* number of loops started */
+  int num_running_;               /* workers still in the loop */
+  bool stop_;                     /* set by the destructor */
+
+  /* The current loop */
+  Task task_;
+  void* arg_;
+  int end_;
+  int grain_;
+  int next_;                      /* the begin of the next block */
+
+  static void* WorkerThread(void* pool);
+  void WorkerLoop();
+
+  /* Take and run the blocks until no block is left. */
+
+  void RunBlocks();
+
+  DISALLOW_COPY_AND_ASSIGN(ThreadPool);
+};
+
+} // namespace f2m
+
+#endif // F2M_COMMON_THREAD_POOL_H_
@@ -0,0 +1,113 @@
+/*
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or (at
+your option) any later version.
+
+This program is distributed in the hope that it will be useful, but
+WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+02110-1301, USA.
+*/
+
+/* 
+Copyright (c) 2016 by contributors.
+Author: Chao Ma (mctt90@gmail.com)
+
+This file is the implementation of ffm_loss.h
+*/
+
+#include "src/loss/ffm_loss.h"
+
+#include <cmath>
+
+namespace f2m {
+
+/* Find the latent vectors and w of every feature of the row. The
+   latent vectors of a feature are contiguous in all the layouts of
+   Model, so v_{i,f} = latent_[i] + f * padded_k. */
+
+void FFMLoss::GatherRow(const SparseRow& row, const Model& param) {
+  CHECK_NOTNULL(row.field);
+  latent_.resize(row.size);
+  weight_.resize(row.size);
+  // v_i + field_j * k must stay in the latent block of feature i.
+  const int field_num = param.GetFieldNum();
+  for (uint32 i = 0; i < row.size; ++i) {
+    if (row.field[i] < 0 || row.field[i] >= field_num) {
+      LOG(FATAL) << "Field " << row.field[i] << " is out of the range [0, "
+                 << field_num << ") of the model.";
+    }
+    latent_[i] = param.V(row.position[i]);
+    weight_[i] = *param.W(row.position[i]);
+  }
+}
+
+real_t FFMLoss::PredictRow(const SparseRow& row, int k) {
+  real_t pred = 0;
+  for (uint32 i = 0; i < row.size; ++i) {
+    pred += weight_[i] * row.x[i];
+  }
+  for (uint32 i = 0; i < row.size; ++i) {
+    const real_t* latent_i = latent_[i];
+    int field_i = row.field[i];
+    real_t x_i = row.x[i];
+    for (uint32 j = i + 1; j < row.size; ++j) {
+      const real_t* v_i = latent_i + row.field[j] * k;
+      const real_t* v_j = latent_[j] + field_i * k;
+      pred += kernels_.Dot(v_i, v_j, k) * x_i * row.x[j];
+    }
+  }
+  return pred;
+}
+
+void FFMLoss::Predict(const DataMatrix& matrix,
+                      const Model& param,
+                      std::vector<real_t>* pred) {
+  const int k = param.GetPaddedK();
+  pred->resize(matrix.size());
+  for (size_t r = 0; r < matrix.size(); ++r) {
+    SparseRow row = matrix[r];
+    GatherRow(row, param);
+    (*pred)[r] = PredictRow(row, k);
+  }
+}
+
+void FFMLoss::CalcGrad(const DataMatrix& matrix,
+                       const Model& param,
+                       SparseGrad* grad) {
+  const int k = param.GetPaddedK();
+  grad->Clear(k);
+  for (size_t r = 0; r < matrix.size(); ++r) {
+    SparseRow row = matrix[r];
+    GatherRow(row, param);
+    real_t y = row.y > 0 ? 1 : -1;
+    real_t p = -y / (1 + exp(y * PredictRow(row, k)));
+    for (uint32 i = 0; i < row.size; ++i) {
+      grad->AddW(row.position[i], p * row.x[i]);
+    }
+    for (uint32 i = 0; i < row.size; ++i) {
+      index_t pos_i = row.position[i];
+      const real_t* latent_i = latent_[i];
+      int field_i = row.field[i];
+      real_t x_i = row.x[i];
+      for (uint32 j = i + 1; j < row.size; ++j) {
+        int field_j = row.field[j];
+        const real_t* v_i = latent_i + field_j * k;
+        const real_t* v_j = latent_[j] + field_i * k;
+        real_t s = p * x_i * row.x[j];
+        size_t grad_i = grad->AddV(pos_i, field_j);
+        size_t grad_j = grad->AddV(row.position[j], field_i);
+        kernels_.Axpy(s, v_j, grad->GradV(grad_i), k);
+        kernels_.Axpy(s, v_i, grad->GradV(grad_j), k);
+      }
+    }
+  }
+}
+
+} // namespace f2m
@@ -29,13 +29,46 @@ This file defines the FFM loss.
 
 #include "src/common/common.h"
 #include "src/common/data_structure.h"
+#include "src/common/simd.h"
 
 #include "src/loss/loss.h"
 
 namespace f2m {
 
+/* -----------------------------------------------------------------------------
+ * Field-aware Factorization Machines Loss, Math:                               *
+ *                                                                              *
+ *  [ pred = sum_i w_i * x_i +                                                  *
+ *           sum_{i<j} <v_{i,f_j}, v_{j,f_i}> * x_i * x_j ]                     *
+ *                                                                              *
+ *  [ loss(x, y) = log(1 + exp(-y * pred)) ]                                    *
+ *                                                                              *
+ * where f_i is the field of the i-th feature, and v_{i,f} is the latent        *
+ * vector of the i-th feature for field f. With p = -y / (1 + exp(y * pred)),   *
+ * the gradients are:                                                           *
+ *                                                                              *
+ *  [ grad w_i = p * x_i ]                                                      *
+ *  [ grad v_{i,f_j} = p * x_i * x_j * v_{j,f_i} ]                              *
+ *  [ grad v_{j,f_i} = p * x_i * x_j * v_{i,f_j} ]                              *
+ *                                                                              *
+ * The cost is O(n^2 * k) for a row of n features, which is spent on the        *
+ * inner products and the updates of the latent vectors. They are computed      *
+ * by the SIMD kernels of simd.h, which are chosen at run time. With the        *
+ * aligned Model, the kernels run over the padded k without a scalar tail.      *
+ * -----------------------------------------------------------------------------
+ */
+
 class FFMLoss : public Loss {
  public:
+  /* Use the best SIMD kernels supported by the CPU. */
+
+  FFMLoss() : kernels_(GetSIMDKernels()) {}
+
+  /* Use the SIMD kernels of the level, e.g., kScalar for 
+     the reference results. */
+
+  explicit FFMLoss(SIMDLevel level) : kernels_(GetSIMDKernels(level)) {}
+
   ~FFMLoss() {}
 
   void Predict(const DataMatrix& matrix,
@@ -43,13 +76,22 @@ class FFMLoss : public Loss {
                std::vector<real_t>* pred);
 
   void CalcGrad(const DataMatrix& matrix,
- 	            const Model& param,
- 	            SparseGrad* grad);
+                const Model& param,
+                SparseGrad* grad);
 
  private:
-  DISALLOW_COPY_AND_ASSIGN(FMLoss);
+  const SIMDKernels& kernels_;
+  std::vector<const real_t*> latent_;  /* latent vectors of a row */
+  std::vector<real_t> weight_;         /* w of a row */
+
+  /* Find the parameters of one row, then return its prediction. */
+
+  void GatherRow(const SparseRow& row, const Model& param);
+  real_t PredictRow(const SparseRow& row, int k);
+
+  DISALLOW_COPY_AND_ASSIGN(FFMLoss);
 };
 
 } // namespace f2m
 
-#endif // F2M_LOSS_FFM_LOSS_H_
\ No newline at end of file
+#endif // F2M_LOSS_FFM_LOSS_H_
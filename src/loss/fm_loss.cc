@@ -0,0 +1,83 @@
+/*
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or (at
+your option) any later version.
+
+This program is distributed in the hope that it will be useful, but
+WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+02110-1301, USA.
+*/
+
+/* 
+Copyright (c) 2016 by contributors.
+Author: Chao Ma (mctt90@gmail.com)
+
+This file is the implementation of fm_loss.h
+*/
+
+#include "src/loss/fm_loss.h"
+
+#include <cmath>
+
+namespace f2m {
+
+/* A single pass over the features of the row, which finds the
+   latent vectors, and computes w * x, s and q together. */
+
+real_t FMLoss::PredictRow(const SparseRow& row, const Model& param, 
+                          int k) {
+  latent_.resize(row.size);
+  sum_.assign(k, 0);
+  real_t linear = 0;
+  real_t square = 0;
+  for (uint32 i = 0; i < row.size; ++i) {
+    index_t pos = row.position[i];
+    real_t x = row.x[i];
+    const real_t* v = param.V(pos);
+    latent_[i] = v;
+    linear += *param.W(pos) * x;
+    kernels_.Axpy(x, v, sum_.data(), k);
+    square += kernels_.Dot(v, v, k) * x * x;
+  }
+  real_t sum_square = kernels_.Dot(sum_.data(), sum_.data(), k);
+  return linear + 0.5 * (sum_square - square);
+}
+
+void FMLoss::Predict(const DataMatrix& matrix,
+                     const Model& param,
+                     std::vector<real_t>* pred) {
+  const int k = param.GetPaddedK();
+  pred->resize(matrix.size());
+  for (size_t r = 0; r < matrix.size(); ++r) {
+    (*pred)[r] = PredictRow(matrix[r], param, k);
+  }
+}
+
+void FMLoss::CalcGrad(const DataMatrix& matrix,
+                      const Model& param,
+                      SparseGrad* grad) {
+  const int k = param.GetPaddedK();
+  grad->Clear(k);
+  for (size_t r = 0; r < matrix.size(); ++r) {
+    SparseRow row = matrix[r];
+    real_t y = row.y > 0 ? 1 : -1;
+    real_t p = -y / (1 + exp(y * PredictRow(row, param, k)));
+    // grad v_i = (p * x_i) * s - (p * x_i^2) * v_i
+    for (uint32 i = 0; i < row.size; ++i) {
+      real_t px = p * row.x[i];
+      grad->AddW(row.position[i], px);
+      real_t* g = grad->GradV(grad->AddV(row.position[i]));
+      kernels_.Axpy(px, sum_.data(), g, k);
+      kernels_.Axpy(-px * row.x[i], latent_[i], g, k);
+    }
+  }
+}
+
+} // namespace f2m
@@ -29,27 +29,68 @@ This file defines the FM loss.
 
 #include "src/common/common.h"
 #include "src/common/data_structure.h"
+#include "src/common/simd.h"
 
 #include "src/loss/loss.h"
 
 namespace f2m {
 
+/* -----------------------------------------------------------------------------
+ * Factorization Machines Loss, Math:                                           *
+ *                                                                              *
+ *  [ pred = sum_i w_i * x_i + sum_{i<j} <v_i, v_j> * x_i * x_j ]               *
+ *                                                                              *
+ *  [ loss(x, y) = log(1 + exp(-y * pred)) ]                                    *
+ *                                                                              *
+ * The pairwise part costs O(n^2 * k) for a row of n features. We use the       *
+ * identity                                                                     *
+ *                                                                              *
+ *  [ sum_{i<j} <v_i, v_j> * x_i * x_j = 0.5 * (<s, s> - q) ]                   *
+ *                                                                              *
+ * where s = sum_i v_i * x_i and q = sum_i <v_i, v_i> * x_i^2, so that it       *
+ * costs O(n * k). With p = -y / (1 + exp(y * pred)), the gradients are:        *
+ *                                                                              *
+ *  [ grad w_i = p * x_i ]                                                      *
+ *  [ grad v_i = p * x_i * (s - v_i * x_i) ]                                    *
+ *                                                                              *
+ * The sum s of a row is computed once by the prediction and reused by the      *
+ * gradients. All the operations over k use the SIMD kernels of simd.h.         *
+ * -----------------------------------------------------------------------------
+ */
+
 class FMLoss : public Loss {
  public:
+  /* Use the best SIMD kernels supported by the CPU. */
+
+  FMLoss() : kernels_(GetSIMDKernels()) {}
+
+  /* Use the SIMD kernels of the level, e.g., kScalar for 
+     the reference results. */
+
+  explicit FMLoss(SIMDLevel level) : kernels_(GetSIMDKernels(level)) {}
+
   ~FMLoss() {}
 
   void Predict(const DataMatrix& matrix,
- 	           const Model& param,
- 	           std::vector<real_t>* pred);
+               const Model& param,
+               std::vector<real_t>* pred);
 
   void CalcGrad(const DataMatrix& matrix,
- 	            const Model& param,
- 	            SparseGrad* grad);
+                const Model& param,
+                SparseGrad* grad);
 
  private:
+  const SIMDKernels& kernels_;
+  std::vector<const real_t*> latent_;  /* latent vectors of a row */
+  std::vector<real_t> sum_;            /* s = sum_i v_i * x_i */
+
+  /* Return the prediction of one row, and keep its s in sum_. */
+
+  real_t PredictRow(const SparseRow& row, const Model& param, int k);
+
   DISALLOW_COPY_AND_ASSIGN(FMLoss);
 };
 
 } // namespace f2m
 
-#endif // F2M_LOSS_FM_LOSS_H_
\ No newline at end of file
+#endif // F2M_LOSS_FM_LOSS_H_
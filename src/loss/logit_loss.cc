@@ -0,0 +1,106 @@
+/*
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or (at
+your option) any later version.
+
+This program is distributed in the hope that it will be useful, but
+WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+02110-1301, USA.
+*/
+
+/* 
+Copyright (c) 2016 by contributors.
+Author: Chao Ma (mctt90@gmail.com)
+
+This file is the implementation of logit_loss.h
+*/
+
+#include "src/loss/logit_loss.h"
+
+#include <cmath>
+
+#include "src/common/fast_math.h"
+#include "src/common/linear_algebra.h"
+
+namespace f2m {
+
+real_t LogitLoss::PredictRow(const SparseRow& row, const Model& param) {
+  const real_t* w = param.DenseW();
+  real_t pred = 0;
+  if (w != NULL) {
+    SparseVectorDenseVectorTimes(row.x, row.position, row.size, w, &pred);
+    return pred;
+  }
+  for (uint32 i = 0; i < row.size; ++i) {
+    pred += *param.W(row.position[i]) * row.x[i];
+  }
+  return pred;
+}
+
+void LogitLoss::Predict(const DataMatrix& matrix,
+                        const Model& param,
+                        std::vector<real_t>* pred) {
+  pred->resize(matrix.size());
+  if (param.DenseW() != NULL) {
+    if (pool_ != NULL) {
+      SparseMatrixDenseVectorTimes(matrix, param.DenseW(), pred, pool_);
+    } else {
+      SparseMatrixDenseVectorTimes(matrix, param.DenseW(), pred);
+    }
+    return;
+  }
+  for (size_t r = 0; r < matrix.size(); ++r) {
+    (*pred)[r] = PredictRow(matrix[r], param);
+  }
+}
+
+void LogitLoss::CalcGrad(const DataMatrix& matrix,
+                         const Model& param,
+                         SparseGrad* grad) {
+  grad->Clear();
+  for (size_t r = 0; r < matrix.size(); ++r) {
+    SparseRow row = matrix[r];
+    real_t y = row.y > 0 ? 1 : -1;
+    real_t p = -y / (1 + exp(y * PredictRow(row, param)));
+    for (uint32 i = 0; i < row.size; ++i) {
+      grad->AddW(row.position[i], p * row.x[i]);
+    }
+  }
+}
+
+/* The fast path keeps kSIMDWidth partial sums, so the compiler can
+   vectorize the loop (a single sum is a serial dependence). */
+
+real_t LogitLoss::Evaluate(const std::vector<real_t>& pred,
+                           const std::vector<real_t>& label) const {
+  if (!fast_math_) {
+    return Loss::Evaluate(pred, label);
+  }
+  real_t sum[kSIMDWidth] = { 0 };
+  size_t size = pred.size();
+  size_t i = 0;
+  for (; i + kSIMDWidth <= size; i += kSIMDWidth) {
+    for (int j = 0; j < kSIMDWidth; ++j) {
+      real_t y = label[i + j] > 0 ? 1 : -1;
+      sum[j] += FastLog1pExp(-y * pred[i + j]);
+    }
+  }
+  for (; i < size; ++i) {
+    real_t y = label[i] > 0 ? 1 : -1;
+    sum[0] += FastLog1pExp(-y * pred[i]);
+  }
+  real_t objv = 0.0;
+  for (int j = 0; j < kSIMDWidth; ++j) {
+    objv += sum[j];
+  }
+  return objv;
+}
+
+} // namespace f2m
@@ -29,6 +29,7 @@ This file defines the logistic regression loss.
 
 #include "src/common/common.h"
 #include "src/common/data_structure.h"
+#include "src/common/thread_pool.h"
 
 #include "src/loss/loss.h"
 
@@ -44,6 +45,12 @@ namespace f2m {
 
 class LogitLoss : public Loss {
  public:
+  /* With fast_math = true, Evaluate() uses FastExp() and FastLog1p()
+     (fast_math.h) instead of exp() and log() of libm. With a pool, 
+     Predict() of a dense w splits the rows among its threads. */
+
+  explicit LogitLoss(bool fast_math = false, ThreadPool* pool = NULL) 
+    : fast_math_(fast_math), pool_(pool) {}
   ~LogitLoss() {}
 
   /* ---------------------------------------------------------------------------
@@ -59,9 +66,7 @@ class LogitLoss : public Loss {
 
   void Predict(const DataMatrix& matrix,
                const Model& param,
-               std::vector<real_t>* pred) {
-
-  }
+               std::vector<real_t>* pred);
 
   /* ---------------------------------------------------------------------------
    * Given the input data matrix and current model, return                      *
@@ -84,16 +89,31 @@ class LogitLoss : public Loss {
    *  [ grad += X[i] * p[i] ]                                                   *
    *                                                                            *
    * where n is the row number of the data matrix X.                            *
+   *                                                                            *
+   * The three steps are fused: for each row, we compute <w, X[i]>, p[i], and   *
+   * add X[i] * p[i] to grad while the row is still in the cache, so the        *
+   * matrix is read once and the pred vector is never stored.                   *
    * ---------------------------------------------------------------------------
    */
 
   void CalcGrad(const DataMatrix& matrix,
                 const Model& param,
-                SparseGrad* grad) {
-    
-  }
+                SparseGrad* grad);
+
+  /* The log loss, which uses the fast approximations if fast_math. */
+
+  real_t Evaluate(const std::vector<real_t>& pred,
+                  const std::vector<real_t>& label) const;
 
  private: 
+  bool fast_math_;
+  ThreadPool* pool_;     /* NULL for the calling thread only */
+
+  /* Return <w, row>, with SparseVectorDenseVectorTimes() if the 
+     model has a dense w. */
+
+  static real_t PredictRow(const SparseRow& row, const Model& param);
+
   DISALLOW_COPY_AND_ASSIGN(LogitLoss);
 };
 
@@ -44,6 +44,7 @@ namespace f2m {
 
 class Loss {
  public:
+  Loss() {}
   virtual ~Loss() {}
 
   /* ---------------------------------------------------------------------------
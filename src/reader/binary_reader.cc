@@ -0,0 +1,255 @@
+/*
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or (at
+your option) any later version.
+
+This program is distributed in the hope that it will be useful, but
+WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+02110-1301, USA.
+*/
+
+/* 
+Copyright (c) 2016 by contributors.
+Author: Chao Ma (mctt90@gmail.com)
+
+This file is the implementation of binary_reader.h
+*/
+
+#include "src/reader/binary_reader.h"
+
+#include <string.h>
+
+#include "src/common/common.h"
+
+namespace f2m {
+
+/* Append the bytes of data to a buffer. */
+
+static void AppendBytes(std::string* buf, const void* data, size_t size) {
+  buf->append(reinterpret_cast<const char*>(data), size);
+}
+
+/* Append a varint (7 bits per byte) to a buffer. */
+
+static void AppendVarint(std::string* buf, uint64 value) {
+  while (value >= 0x80) {
+    buf->push_back(static_cast<char>(value | 0x80));
+    value >>= 7;
+  }
+  buf->push_back(static_cast<char>(value));
+}
+
+/* Read a varint from [*p, end) and move *p to the next byte. */
+
+static uint64 ReadVarint(const char** p, const char* end) {
+  uint64 value = 0;
+  for (int shift = 0; *p != end && shift < 64; shift += 7) {
+    uint8 byte = static_cast<uint8>(*(*p)++);
+    value |= static_cast<uint64>(byte & 0x7F) << shift;
+    if ((byte & 0x80) == 0) {
+      return value;
+    }
+  }
+  LOG(FATAL) << "Corrupted varint in binary record.";
+  return 0;
+}
+
+//------------------------------------------------------------------------------
+// BinaryWriter
+//------------------------------------------------------------------------------
+
+BinaryWriter::BinaryWriter(const std::string& filename, uint32 flags) {
+  memset(&header_, 0, sizeof(header_));
+  header_.magic = kBinaryMagic;
+  header_.version = kBinaryVersion;
+  header_.flags = flags;
+  file_ptr_ = OpenFileOrDie(filename.c_str(), "wb");
+  // The header will be re-written by Close().
+  if (fwrite(&header_, sizeof(header_), 1, file_ptr_) != 1) {
+    LOG(FATAL) << "Write file error: " << filename;
+  }
+}
+
+BinaryWriter::~BinaryWriter() {
+  if (file_ptr_ != NULL) {
+    Close();
+  }
+}
+
+void BinaryWriter::Write(const DataMatrix& matrix) {
+  bool has_field = (header_.flags & kBinaryField) != 0;
+  if (has_field) {
+    CHECK_EQ(matrix.field.size(), matrix.nnz());
+  }
+  for (size_t i = 0; i < matrix.size(); ++i) {
+    SparseRow row = matrix[i];
+    record_.clear();
+    AppendBytes(&record_, &row.size, sizeof(row.size));
+    AppendBytes(&record_, &row.y, sizeof(row.y));
+    AppendBytes(&record_, row.x, row.size * sizeof(real_t));
+    if (has_field) {
+      for (uint32 n = 0; n < row.size; ++n) {
+        int32 field = row.field[n];
+        CHECK_GE(field, 0);
+        if (header_.flags & kBinaryField16) {
+          CHECK_LT(field, 65536);
+          uint16 short_field = field;
+          AppendBytes(&record_, &short_field, sizeof(short_field));
+        } else {
+          AppendBytes(&record_, &field, sizeof(field));
+        }
+        header_.num_fields = std::max(header_.num_fields, 
+                                      static_cast<uint32>(field + 1));
+      }
+    }
+    if (header_.flags & kBinaryDelta) {
+      int64 prev = 0;
+      for (uint32 n = 0; n < row.size; ++n) {
+        int64 delta = static_cast<int64>(row.position[n]) - prev;
+        // zigzag encoding: 0, -1, 1, -2, 2 ... -> 0, 1, 2, 3, 4 ...
+        AppendVarint(&record_, (static_cast<uint64>(delta) << 1) ^ 
+                               static_cast<uint64>(delta >> 63));
+        prev = row.position[n];
+      }
+    } else {
+      AppendBytes(&record_, row.position, row.size * sizeof(index_t));
+    }
+    for (uint32 n = 0; n < row.size; ++n) {
+      header_.num_features = std::max(header_.num_features,
+                                      static_cast<uint64>(row.position[n]) + 1);
+    }
+    uint32 length = record_.size();
+    if (fwrite(&length, sizeof(length), 1, file_ptr_) != 1 ||
+        fwrite(record_.data(), 1, length, file_ptr_) != length) {
+      LOG(FATAL) << "Write file error.";
+    }
+    header_.num_rows++;
+  }
+}
+
+void BinaryWriter::Close() {
+  CHECK_NOTNULL(file_ptr_);
+  fseek(file_ptr_, 0, SEEK_SET);
+  if (fwrite(&header_, sizeof(header_), 1, file_ptr_) != 1) {
+    LOG(FATAL) << "Write file error.";
+  }
+  fclose(file_ptr_);
+  file_ptr_ = NULL;
+}
+
+//------------------------------------------------------------------------------
+// BinaryReader
+//------------------------------------------------------------------------------
+
+BinaryReader::BinaryReader(const std::string& filename, int num_samples)
+  : Reader(filename, num_samples, true) {
+  if (ranges_.size() != 1) {
+    LOG(FATAL) << "BinaryReader can only read one file: " << filename;
+  }
+  if (size_memory_buffer_ < sizeof(header_)) {
+    LOG(FATAL) << "Not a binary data file: " << filename;
+  }
+  memcpy(&header_, memory_buffer_, sizeof(header_));
+  if (header_.magic != kBinaryMagic) {
+    LOG(FATAL) << "Not a binary data file: " << filename;
+  }
+  if (header_.version != kBinaryVersion) {
+    LOG(FATAL) << "Unknown version of binary data file: " 
+               << header_.version;
+  }
+  if (header_.num_rows == 0) {
+    LOG(FATAL) << "Empty input file: " << filename;
+  }
+  // The records start after the header.
+  shard_begin_ = sizeof(header_);
+  cursor_ = shard_begin_;
+}
+
+bool BinaryReader::ReadLine(StringPiece* record) {
+  // End of the file, return to the first record.
+  if (AtEnd()) {
+    Rewind();
+    return false;
+  }
+  uint32 length = 0;
+  if (cursor_ + sizeof(length) > shard_end_) {
+    LOG(FATAL) << "Corrupted binary data file: " << filename_;
+  }
+  memcpy(&length, memory_buffer_ + cursor_, sizeof(length));
+  cursor_ += sizeof(length);
+  if (cursor_ + length > shard_end_) {
+    LOG(FATAL) << "Corrupted binary data file: " << filename_;
+  }
+  UpdateMaxLineLength(length);
+  record->set(memory_buffer_ + cursor_, length);
+  cursor_ += length;
+  return true;
+}
+
+//------------------------------------------------------------------------------
+// BinaryParser
+//------------------------------------------------------------------------------
+
+/* Copy size bytes from *p to dst, and move *p to the next byte. 
+   The records may not be aligned (e.g., copied by Pipeline), 
+   so we always use memcpy() to read them. */
+
+static void ReadBytes(const char** p, const char* end, 
+                      void* dst, size_t size) {
+  if (*p + size > end) {
+    LOG(FATAL) << "Corrupted binary record.";
+  }
+  memcpy(dst, *p, size);
+  *p += size;
+}
+
+void BinaryParser::ParseLine(const StringPiece& record, DataMatrix* matrix) {
+  const char* p = record.data();
+  const char* end = p + record.size();
+  uint32 size = 0;
+  real_t y = 0;
+  ReadBytes(&p, end, &size, sizeof(size));
+  ReadBytes(&p, end, &y, sizeof(y));
+  // The new row starts at the end of the matrix.
+  size_t start = matrix->x.size();
+  matrix->x.resize(start + size);
+  ReadBytes(&p, end, matrix->x.data() + start, size * sizeof(real_t));
+  if (flags_ & kBinaryField) {
+    matrix->field.resize(start + size);
+    if (flags_ & kBinaryField16) {
+      for (uint32 n = 0; n < size; ++n) {
+        uint16 field = 0;
+        ReadBytes(&p, end, &field, sizeof(field));
+        matrix->field[start + n] = field;
+      }
+    } else {
+      ReadBytes(&p, end, matrix->field.data() + start, size * sizeof(int));
+    }
+  }
+  matrix->position.resize(start + size);
+  if (flags_ & kBinaryDelta) {
+    int64 index = 0;
+    for (uint32 n = 0; n < size; ++n) {
+      uint64 zigzag = ReadVarint(&p, end);
+      index += static_cast<int64>(zigzag >> 1) ^ 
+               -static_cast<int64>(zigzag & 1);
+      matrix->position[start + n] = index;
+    }
+  } else {
+    ReadBytes(&p, end, matrix->position.data() + start, 
+              size * sizeof(index_t));
+  }
+  if (p != end) {
+    LOG(FATAL) << "Corrupted binary record.";
+  }
+  matrix->EndRow(y);
+}
+
+} // namespace f2m
@@ -0,0 +1,167 @@
+/*
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or (at
+your option) any later version.
+
+This program is distributed in the hope that it will be useful, but
+WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+02110-1301, USA.
+*/
+
+/* 
+Copyright (c) 2016 by contributors.
+Author: Chao Ma (mctt90@gmail.com)
+
+This files defines the binary format of the data set, and the 
+BinaryWriter, BinaryReader and BinaryParser classes to write 
+and read the binary files.
+*/
+
+#ifndef F2M_READER_BINARY_READER_H_
+#define F2M_READER_BINARY_READER_H_
+
+#include <string>
+
+#include "src/common/common.h"
+#include "src/common/data_structure.h"
+#include "src/reader/parser.h"
+#include "src/reader/reader.h"
+
+namespace f2m {
+
+/* -----------------------------------------------------------------------------
+ * Parsing the text data is expensive (atof), and we have to do it again and    *
+ * again in every epoch. Instead, we can convert the text file to a binary      *
+ * file once (by the text_to_binary tool), and then train on the binary file:   *
+ *                                                                              *
+ *   BinaryReader reader("/tmp/testdata.bin", num_samples = 100);               *
+ *   BinaryParser parser(reader.flags());                                       *
+ *                                                                              *
+ *   Loop until converge {                                                      *
+ *      parser.Parse(reader.SampleViews(), &matrix);                            *
+ *      ... use the matrix to train model                                       *
+ *   }                                                                          *
+ *                                                                              *
+ * The binary file begins with a BinaryHeader, followed by the records of       *
+ * every row. A record is a length-prefixed row stored in CSR format:           *
+ *                                                                              *
+ *   [uint32 length] [uint32 n] [float y] [float value * n]                     *
+ *   [field * n (optional)] [index * n]                                         *
+ *                                                                              *
+ * The field is int32, or uint16 if kBinaryField16 is set. The index is uint32, *
+ * or the zigzag varint of the difference with the previous index in the same   *
+ * row if kBinaryDelta is set. The numbers are stored in the byte order of the  *
+ * host.                                                                        *
+ *                                                                              *
+ * BinaryReader maps the file into memory as the in-memory mode of Reader, and  *
+ * returns the views of records. So BinaryReader can also be used in Pipeline.  *
+ * BinaryParser copies the records into the DataMatrix, which costs only memory *
+ * bandwidth.                                                                   *
+ * -----------------------------------------------------------------------------
+ */
+
+enum BinaryFlag {
+  kBinaryField   = 1,   /* has field (FFM) */
+  kBinaryField16 = 2,   /* field is stored as uint16 */
+  kBinaryDelta   = 4    /* index is delta-encoded */
+};
+
+struct BinaryHeader {
+  uint32 magic;         /* must be kBinaryMagic */
+  uint32 version;       /* version of the format */
+  uint32 flags;         /* BinaryFlag */
+  uint32 num_fields;    /* max field + 1 */
+  uint64 num_features;  /* max index + 1 */
+  uint64 num_rows;      /* number of rows */
+};
+
+const uint32 kBinaryMagic = 0x424D3246;  // "F2MB"
+const uint32 kBinaryVersion = 1;
+
+/* -----------------------------------------------------------------------------
+ * BinaryWriter writes DataMatrix to a binary file.                             *
+ * -----------------------------------------------------------------------------
+ */
+
+class BinaryWriter {
+ public:
+  BinaryWriter(const std::string& filename, uint32 flags);
+  ~BinaryWriter();
+
+  /* Append all the rows of the matrix to the file. */
+
+  void Write(const DataMatrix& matrix);
+
+  /* Write the header and close the file. */
+
+  void Close();
+
+ private:
+  FILE* file_ptr_;
+  BinaryHeader header_;
+  std::string record_;    /* buffer of one record */
+
+  DISALLOW_COPY_AND_ASSIGN(BinaryWriter);
+};
+
+/* -----------------------------------------------------------------------------
+ * BinaryReader returns N records of a binary file in each iteration.           *
+ * -----------------------------------------------------------------------------
+ */
+
+class BinaryReader : public Reader {
+ public:
+  BinaryReader(const std::string& filename, int num_samples);
+
+  ~BinaryReader() {}
+
+  /* Read the next record and return true. At the end of the file, 
+     return false, and the next call will start from the first 
+     record again. Samples() and SampleViews() of Reader return 
+     N records by this method. */
+
+  bool ReadLine(StringPiece* record);
+
+  /* Shuffling of records is not supported yet. */
+
+  void EnableShuffle(uint64 block_size = 1, uint64 seed = 0) {
+    LOG(FATAL) << "BinaryReader does not support shuffling.";
+  }
+
+  uint32 flags() const { return header_.flags; }
+  uint32 num_fields() const { return header_.num_fields; }
+  uint64 num_features() const { return header_.num_features; }
+  uint64 num_rows() const { return header_.num_rows; }
+
+ private:
+  BinaryHeader header_;
+
+  DISALLOW_COPY_AND_ASSIGN(BinaryReader);
+};
+
+/* -----------------------------------------------------------------------------
+ * BinaryParser parses the records returned by BinaryReader to a DataMatrix.    *
+ * -----------------------------------------------------------------------------
+ */
+
+class BinaryParser : public Parser {
+ public:
+  explicit BinaryParser(uint32 flags) : flags_(flags) {}
+
+ protected:
+  virtual void ParseLine(const StringPiece& record, DataMatrix* matrix);
+
+ private:
+  uint32 flags_;
+};
+
+} // namespace f2m
+
+#endif // F2M_READER_BINARY_READER_H_
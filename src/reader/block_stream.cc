@@ -0,0 +1,371 @@
+/*
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or (at
+your option) any later version.
+
+This program is distributed in the hope that it will be useful, but
+WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+02110-1301, USA.
+*/
+
+/*
+Copyright (c) 2016 by contributors.
+Author: Chao Ma (mctt90@gmail.com)
+
+This file is the implementation of block_stream.h
+*/
+
+#include "src/reader/block_stream.h"
+
+#include <errno.h>
+#include <string.h>
+#include <zlib.h>
+#include <algorithm>
+#if defined __unix__ || defined __APPLE__
+#include <unistd.h>
+#endif
+#ifdef F2M_USE_ZSTD
+#include <zstd.h>
+#endif
+
+#include "src/common/common.h"
+
+namespace f2m {
+
+const uint64 kInputBufferSize = 1024 * 1024;  // compressed bytes per fread
+
+Codec DetectCodec(FILE* file) {
+  unsigned char magic[4] = { 0, 0, 0, 0 };
+  size_t size = fread(magic, 1, sizeof(magic), file);
+  rewind(file);
+  if (size >= 2 && magic[0] == 0x1f && magic[1] == 0x8b) {
+    return kCodecGzip;
+  }
+  if (size == 4 && magic[0] == 0x28 && magic[1] == 0xb5 &&
+      magic[2] == 0x2f && magic[3] == 0xfd) {
+    return kCodecZstd;
+  }
+  return kCodecNone;
+}
+
+/* Constructor */
+
+BlockStream::BlockStream(const std::string& filename,
+                         Codec codec,
+                         uint64 block_size,
+                         int num_blocks,
+                         uint64 begin,
+                         uint64 end)
+  : filename_(filename),
+    codec_(codec),
+    block_size_(block_size),
+    current_(NULL),
+    running_(false),
+    begin_(begin),
+    end_(end),
+    position_(begin),
+    input_size_(0),
+    input_pos_(0),
+    decoder_(NULL),
+    at_boundary_(true) {
+
+  CHECK_GT(block_size_, 0);
+  CHECK_LE(block_size_, 1U << 30);  // avail_out of zlib is 32-bit
+  CHECK_GT(num_blocks, 0);
+  CHECK_LE(begin_, end_);
+  if (codec_ != kCodecNone) {
+    // A compressed file can only be read from the head.
+    CHECK_EQ(begin_, 0);
+    CHECK_EQ(end_, kEndOfFile);
+  }
+#ifndef F2M_USE_ZSTD
+  if (codec_ == kCodecZstd) {
+    LOG(FATAL) << "Cannot read the zstd file " << filename_
+               << ", because F2M is built without libzstd.";
+  }
+#endif
+
+  file_ptr_ = OpenFileOrDie(filename_.c_str(), "r");
+  input_.reset(new char[kInputBufferSize]);
+  for (int i = 0; i < num_blocks; ++i) {
+    Block* block = new Block;
+    block->data.reset(new char[block_size_]);
+    block->size = 0;
+    all_blocks_.push_back(block);
+  }
+  CreateDecoder();
+  Start();
+}
+
+/* Destructor */
+
+BlockStream::~BlockStream() {
+  Stop();
+  DestroyDecoder();
+  fclose(file_ptr_);
+  STLDeleteElementsAndClear(&all_blocks_);
+}
+
+/* Put all the blocks into the free queue, and start the
+   background thread to fill them. */
+
+void BlockStream::Start() {
+  free_blocks_.reset(new SignalQueue<Block*>(all_blocks_.size()));
+  full_blocks_.reset(new SignalQueue<Block*>(all_blocks_.size()));
+  for (size_t i = 0; i < all_blocks_.size(); ++i) {
+    free_blocks_->Push(all_blocks_[i]);
+  }
+  current_ = NULL;
+  if (pthread_create(&thread_, NULL, DecodeThread, this) != 0) {
+    LOG(FATAL) << "Cannot create decoder thread.";
+  }
+  running_ = true;
+}
+
+/* Wake up and wait for the background thread. */
+
+void BlockStream::Stop() {
+  if (!running_) {
+    return;
+  }
+  free_blocks_->Close();
+  full_blocks_->Close();
+  pthread_join(thread_, NULL);
+  running_ = false;
+}
+
+void BlockStream::Restart() {
+  Stop();
+  rewind(file_ptr_);
+  position_ = begin_;
+  input_size_ = 0;
+  input_pos_ = 0;
+  ResetDecoder();
+  Start();
+}
+
+bool BlockStream::NextBlock(StringPiece* block) {
+  if (current_ != NULL) {
+    free_blocks_->Push(current_);
+    current_ = NULL;
+  }
+  if (!full_blocks_->Pop(&current_)) {
+    current_ = NULL;
+    return false;
+  }
+  block->set(current_->data.get(), current_->size);
+  return true;
+}
+
+void* BlockStream::DecodeThread(void* stream) {
+  reinterpret_cast<BlockStream*>(stream)->DecodeLoop();
+  return NULL;
+}
+
+/* Fill the free blocks until the end of the file, or until
+   the queues are closed by Stop(). */
+
+void BlockStream::DecodeLoop() {
+  Block* block = NULL;
+  while (free_blocks_->Pop(&block)) {
+    block->size = Decode(block->data.get(), block_size_);
+    if (block->size == 0 || !full_blocks_->Push(block)) {
+      break;
+    }
+  }
+  full_blocks_->Close();
+}
+
+/* Read the next bytes of the file into input_.
+   Return false at the end of the file. */
+
+bool BlockStream::FillInput() {
+  input_size_ = fread(input_.get(), 1, kInputBufferSize, file_ptr_);
+  input_pos_ = 0;
+  if (ferror(file_ptr_)) {
+    LOG(FATAL) << "Read file error: " << filename_;
+  }
+  return input_size_ > 0;
+}
+
+/* Write at most capacity bytes of data to output, and return the
+   number of bytes. Only the end of the file returns less than
+   capacity bytes. */
+
+uint64 BlockStream::Decode(char* output, uint64 capacity) {
+  switch (codec_) {
+    case kCodecGzip:
+      return Inflate(output, capacity);
+    case kCodecZstd:
+      return DecompressZstd(output, capacity);
+    default:
+      return ReadRange(output, capacity);
+  }
+}
+
+/* Read the next bytes of the range of a plain file. pread() does 
+   not move the offset of the file, so it needs no lock. */
+
+uint64 BlockStream::ReadRange(char* output, uint64 capacity) {
+  uint64 size = 0;
+  while (size < capacity && position_ < end_) {
+    uint64 length = std::min(capacity - size, end_ - position_);
+#if defined __unix__ || defined __APPLE__
+    ssize_t result = pread(fileno(file_ptr_), output + size, 
+                           length, position_);
+    if (result < 0 && errno == EINTR) {
+      continue;
+    }
+    if (result < 0) {
+      LOG(FATAL) << "Read file error: " << filename_;
+    }
+#else
+    fseek(file_ptr_, position_, SEEK_SET);
+    uint64 result = fread(output + size, 1, length, file_ptr_);
+    if (ferror(file_ptr_)) {
+      LOG(FATAL) << "Read file error: " << filename_;
+    }
+#endif
+    if (result == 0) {
+      break;  // the end of the file
+    }
+    size += result;
+    position_ += result;
+  }
+  return size;
+}
+
+//------------------------------------------------------------------------------
+// The decoders call the library until the output is full. The library
+// may keep some output inside when the output is full, so it is called
+// again (with the rest of the input, which may be empty) before we read
+// more input. If the file ends inside a member or frame, it is truncated.
+//------------------------------------------------------------------------------
+
+uint64 BlockStream::Inflate(char* output, uint64 capacity) {
+  z_stream* stream = reinterpret_cast<z_stream*>(decoder_);
+  stream->next_out = reinterpret_cast<Bytef*>(output);
+  stream->avail_out = capacity;
+  for (;;) {
+    stream->next_in = reinterpret_cast<Bytef*>(input_.get() + input_pos_);
+    stream->avail_in = input_size_ - input_pos_;
+    uInt avail_out = stream->avail_out;
+    int ret = inflate(stream, Z_NO_FLUSH);
+    bool progress = stream->avail_in != input_size_ - input_pos_ ||
+                    stream->avail_out != avail_out;
+    input_pos_ = input_size_ - stream->avail_in;
+    if (ret == Z_STREAM_END) {
+      // The next member (if any) starts a new gzip stream.
+      inflateReset(stream);
+      at_boundary_ = true;
+    } else if (ret == Z_OK || ret == Z_BUF_ERROR) {
+      at_boundary_ = at_boundary_ && !progress;
+    } else {
+      LOG(FATAL) << "Corrupted gzip file: " << filename_;
+    }
+    if (stream->avail_out == 0) {
+      break;
+    }
+    if (input_pos_ < input_size_) {
+      continue;
+    }
+    if (!FillInput()) {
+      if (!at_boundary_) {
+        LOG(FATAL) << "Truncated gzip file: " << filename_;
+      }
+      break;
+    }
+  }
+  return capacity - stream->avail_out;
+}
+
+uint64 BlockStream::DecompressZstd(char* output, uint64 capacity) {
+#ifdef F2M_USE_ZSTD
+  ZSTD_DCtx* context = reinterpret_cast<ZSTD_DCtx*>(decoder_);
+  ZSTD_outBuffer out = { output, capacity, 0 };
+  for (;;) {
+    ZSTD_inBuffer in = { input_.get(), input_size_, input_pos_ };
+    size_t out_pos = out.pos;
+    size_t ret = ZSTD_decompressStream(context, &out, &in);
+    if (ZSTD_isError(ret)) {
+      LOG(FATAL) << "Corrupted zstd file: " << filename_
+                 << " (" << ZSTD_getErrorName(ret) << ")";
+    }
+    if (in.pos != input_pos_ || out.pos != out_pos) {
+      // ret is 0 only when a frame is decoded and flushed.
+      at_boundary_ = (ret == 0);
+    }
+    input_pos_ = in.pos;
+    if (out.pos == out.size) {
+      break;
+    }
+    if (input_pos_ < input_size_) {
+      continue;
+    }
+    if (!FillInput()) {
+      if (!at_boundary_) {
+        LOG(FATAL) << "Truncated zstd file: " << filename_;
+      }
+      break;
+    }
+  }
+  return out.pos;
+#else  // The constructor has rejected the zstd file.
+  LOG(FATAL) << "F2M is built without libzstd.";
+  return 0;
+#endif
+}
+
+void BlockStream::CreateDecoder() {
+  if (codec_ == kCodecGzip) {
+    z_stream* stream = new z_stream;
+    memset(stream, 0, sizeof(*stream));
+    // 15 + 16: the max window, and only the gzip format.
+    if (inflateInit2(stream, 15 + 16) != Z_OK) {
+      LOG(FATAL) << "Cannot initialize zlib.";
+    }
+    decoder_ = stream;
+  }
+#ifdef F2M_USE_ZSTD
+  if (codec_ == kCodecZstd) {
+    decoder_ = ZSTD_createDCtx();
+    CHECK_NOTNULL(decoder_);
+  }
+#endif
+}
+
+void BlockStream::ResetDecoder() {
+  if (codec_ == kCodecGzip) {
+    inflateReset(reinterpret_cast<z_stream*>(decoder_));
+  }
+#ifdef F2M_USE_ZSTD
+  if (codec_ == kCodecZstd) {
+    ZSTD_DCtx_reset(reinterpret_cast<ZSTD_DCtx*>(decoder_),
+                    ZSTD_reset_session_only);
+  }
+#endif
+  at_boundary_ = true;
+}
+
+void BlockStream::DestroyDecoder() {
+  if (codec_ == kCodecGzip) {
+    z_stream* stream = reinterpret_cast<z_stream*>(decoder_);
+    inflateEnd(stream);
+    delete stream;
+  }
+#ifdef F2M_USE_ZSTD
+  if (codec_ == kCodecZstd) {
+    ZSTD_freeDCtx(reinterpret_cast<ZSTD_DCtx*>(decoder_));
+  }
+#endif
+  decoder_ = NULL;
+}
+
+} // namespace f2m
@@ -0,0 +1,167 @@
+/*
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or (at
+your option) any later version.
+
+This program is distributed in the hope that it will be useful, but
+WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+02110-1301, USA.
+*/
+
+/*
+Copyright (c) 2016 by contributors.
+Author: Chao Ma (mctt90@gmail.com)
+
+This files defines BlockStream class, which reads (and decompresses)
+a file block by block in a background thread.
+*/
+
+#ifndef F2M_READER_BLOCK_STREAM_H_
+#define F2M_READER_BLOCK_STREAM_H_
+
+#include <pthread.h>
+#include <stdio.h>
+
+#include <string>
+#include <vector>
+
+#include "src/common/common.h"
+#include "src/reader/signal_queue.h"
+
+namespace f2m {
+
+/* -----------------------------------------------------------------------------
+ * The training logs are often stored as gzip or zstd files, which are 5x       *
+ * smaller than the text. BlockStream decompresses such a file in a background  *
+ * thread into a ring of blocks, so the I/O is 5x less and the decompression    *
+ * overlaps the parsing and the training:                                       *
+ *                                                                              *
+ *   BlockStream stream("/tmp/testdata.gz", kCodecGzip,                         *
+ *                      block_size = 4 MB, num_blocks = 4);                     *
+ *                                                                              *
+ *   StringPiece block;                                                         *
+ *   while (stream.NextBlock(&block)) {                                         *
+ *     ... use the bytes of the block                                           *
+ *   }                                                                          *
+ *   stream.Restart();   // read the file again from the head                   *
+ *                                                                              *
+ * The codec is detected by the magic bytes at the head of the file, not by     *
+ * the name of the file. A gzip file may have many members (e.g., made by       *
+ * cat a.gz b.gz), and a zstd file may have many frames, which are decoded as   *
+ * one stream. The zstd support needs libzstd (F2M_USE_ZSTD is defined by       *
+ * CMake if it is found), otherwise a zstd file is rejected.                    *
+ *                                                                              *
+ * A plain file (kCodecNone) is read by pread() at the offsets of the blocks,   *
+ * and we can read only a byte range [begin, end) of it, e.g., a shard:         *
+ *                                                                              *
+ *   BlockStream stream("/tmp/testdata", kCodecNone,                            *
+ *                      block_size = 16 MB, num_blocks = 2,                     *
+ *                      begin, end);                                            *
+ *                                                                              *
+ * With two blocks, the background thread reads the next block while the        *
+ * caller uses the current one (double buffering), so the latency of the disk   *
+ * is hidden behind the parsing and the training.                               *
+ *                                                                              *
+ * The blocks are recycled between the two threads by two SignalQueues, so      *
+ * the memory is num_blocks * block_size. A block is valid until the next       *
+ * call of NextBlock(). The blocks split the data at any byte, and the caller   *
+ * (e.g., Reader) has to join the lines across the blocks.                      *
+ * -----------------------------------------------------------------------------
+ */
+
+enum Codec {
+  kCodecNone,   /* plain text or binary */
+  kCodecGzip,   /* magic bytes: 1f 8b */
+  kCodecZstd    /* magic bytes: 28 b5 2f fd */
+};
+
+/* Detect the codec of an opened file by its magic bytes,
+   and then return to the head of the file. */
+
+Codec DetectCodec(FILE* file);
+
+const uint64 kEndOfFile = ~0ULL;  /* read a plain file to the end */
+
+class BlockStream {
+ public:
+  BlockStream(const std::string& filename,
+              Codec codec,
+              uint64 block_size,
+              int num_blocks,
+              uint64 begin = 0,          /* the byte range [begin, end) */
+              uint64 end = kEndOfFile);  /* of a plain file */
+
+  ~BlockStream();
+
+  /* Return the next block of the decompressed data and true. At
+     the end of the file, return false. The block is valid until
+     the next call. */
+
+  bool NextBlock(StringPiece* block);
+
+  /* Stop the background thread and read the file
+     again from the head. */
+
+  void Restart();
+
+ private:
+  /* A block of decompressed data. */
+
+  struct Block {
+    scoped_array<char> data;
+    uint64 size;
+  };
+
+  std::string filename_;
+  Codec codec_;
+  uint64 block_size_;
+  FILE* file_ptr_;
+
+  std::vector<Block*> all_blocks_;
+  scoped_ptr<SignalQueue<Block*> > free_blocks_;
+  scoped_ptr<SignalQueue<Block*> > full_blocks_;
+  Block* current_;                 /* the block returned to the caller */
+  pthread_t thread_;
+  bool running_;                   /* whether thread_ has been started */
+
+  /* The following fields are only used by the background thread. */
+
+  uint64 begin_;                   /* range of a plain file */
+  uint64 end_;
+  uint64 position_;                /* offset of the next pread() */
+  scoped_array<char> input_;       /* compressed bytes read from file */
+  uint64 input_size_;              /* number of bytes in input_ */
+  uint64 input_pos_;               /* number of bytes consumed */
+  void* decoder_;                  /* z_stream or ZSTD_DCtx */
+  bool at_boundary_;               /* whether the decoder is between two
+                                      members (gzip) or frames (zstd) */
+
+  void Start();
+  void Stop();
+
+  bool FillInput();
+  uint64 Decode(char* output, uint64 capacity);
+  uint64 ReadRange(char* output, uint64 capacity);
+  uint64 Inflate(char* output, uint64 capacity);
+  uint64 DecompressZstd(char* output, uint64 capacity);
+
+  void CreateDecoder();
+  void ResetDecoder();
+  void DestroyDecoder();
+
+  void DecodeLoop();
+  static void* DecodeThread(void* stream);
+
+  DISALLOW_COPY_AND_ASSIGN(BlockStream);
+};
+
+} // namespace f2m
+
+#endif // F2M_READER_BLOCK_STREAM_H_
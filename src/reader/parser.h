@@ -26,6 +26,10 @@ output to a DMatrix.
 #ifndef F2M_READER_PARSER_H_
 #define F2M_READER_PARSER_H_
 
+#include <ctype.h>
+#include <stdlib.h>
+#include <string.h>
+
 #include <vector>
 #include <string>
 
@@ -35,59 +39,229 @@ output to a DMatrix.
 namespace f2m {
 
 typedef std::vector<std::string> StringList;
+typedef std::vector<StringPiece> StringPieceList;
 
 /* -----------------------------------------------------------------------------
- * The Parser class parse a set of StringList to a DataMatrix.                  * 
+ * The Parser class parse a set of StringList to a DataMatrix.                  *
  * In default, the base Parse class parse the StringList to LR and FM format,   *
  * and we can implement different inhert classes to parser data for other       *
  * algorithms such as the FFMParser.                                            *
+ *                                                                              *
+ * Parser can also parse the views returned by Reader::SampleViews(), and in    *
+ * this way no line will be copied before parsing.                              *
+ *                                                                              *
+ * Every line is tokenized in a single pass over its bytes: the items can be    *
+ * separated by either '\t' or ' ', the numbers are parsed in place by          *
+ * ParseUInt() and ParseReal(), and the results are added to the DataMatrix     *
+ * directly, so no temporary string is created during parsing.                  *
  * -----------------------------------------------------------------------------
  */
 
 class Parser {
  public:
-  /* The matrix should be pre-initialized with the
-     the same row size of the StringList. */
+  virtual ~Parser() {}
+
+  /* Parse the StringList to the matrix. The matrix will be cleared
+     first, and its memory will be reused. */
+
+  void Parse(const StringList* list, DataMatrix* matrix) {
+    matrix->Clear();
+    for (int i = 0; i < list->size(); ++i) {
+      ParseLine(StringPiece((*list)[i]), matrix);
+    }
+  }
+
+  /* Parse the StringPieceList to the matrix. The matrix will be 
+     cleared first, and its memory will be reused. */
 
-  virtual void Parse(const StringList* list, DataMatrix* matrix) {
-    CHECK_EQ(list->size(), matrix->size());
+  void Parse(const StringPieceList* list, DataMatrix* matrix) {
+    matrix->Clear();
     for (int i = 0; i < list->size(); ++i) {
-      // parse the following format:
-      // [0:1234 1:0.123 2:0.21 3:1 4:1 5:0.05 0]
-      StringList items;
-      SplitStringUsing((*list)[i], "\t", &items);
-      int item_size = items.size();
-      // allocate memory for every single line.
-      (*matrix)[i].size = item_size - 1;
-      (*matrix)[i].x.reset(new real_t[item_size - 1]);
-      (*matrix)[i].position.reset(new index_t[item_size - 1]);
-      // parse every single items. 
-      for (int n = 0; n < item_size; ++n) {
-        char* ch_ptr = const_cast<char*>(items[n].c_str());
-        // the last element is y.
-      	if (n == item_size - 1) {
-      	  float value = atof(ch_ptr);
-      	  if (value != 0.0 && value != 1.0 && value != -1.0) {
-      	  	LOG(FATAL) << "Error of Y value: " << value;
-      	  }
-      	  (*matrix)[i].y = value;
-      	  break;
-      	}
-        // find the ':' position.
-        int pos = 0;
-        while (ch_ptr[pos] != ':' && pos < item_size - 1) { ++pos; }
-        if (pos >= item_size - 1) {
-          LOG(FATAL) << "Input data format error, the item is: "
-                     << items[n];
-        }
-        // get index and value
-        ch_ptr[pos] = '\0';
-        int index = atoi(ch_ptr);
-        float value = atof(ch_ptr + pos + 1);
-        // add index and value to RowData.
-        *((*matrix)[i].x.get() + n) = value;
-        *((*matrix)[i].position.get() + n) = index;
+      ParseLine((*list)[i], matrix);
+    }
+  }
+
+  /* Parse an unsigned integer from [p, end), and return the position 
+     after the last digit. Return NULL if there is no digit at p. */
+
+  static const char* ParseUInt(const char* p, const char* end, 
+                               uint32* value) {
+    const char* start = p;
+    uint64 result = 0;
+    while (p != end && IsDigit(*p)) {
+      result = result * 10 + (*p - '0');
+      if (result > kUInt32Max) {
+        LOG(FATAL) << "Integer overflow: " 
+                   << std::string(start, p - start + 1);
       }
+      ++p;
+    }
+    *value = result;
+    return p == start ? NULL : p;
+  }
+
+  /* Parse a real number like [-]123.456[e-7] from [p, end), and return 
+     the position after the number. Return NULL if it is not a number. 
+     The common cases (no more than 15 significant digits and a small 
+     exponent) are computed by one exact division or multiplication 
+     of double, which gives the same result as strtod(). Other cases 
+     fall back to strtod() on a copy of the token, so the number never 
+     extends past end or a separator. */
+
+  static const char* ParseReal(const char* p, const char* end, 
+                               real_t* value) {
+    static const double kPow10[] = {
+      1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,  1e8,  1e9,  1e10,
+      1e11, 1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21,
+      1e22
+    };
+    const char* start = p;
+    bool negative = false;
+    if (p != end && (*p == '-' || *p == '+')) {
+      negative = (*p == '-');
+      ++p;
+    }
+    uint64 mantissa = 0;
+    int num_digits = 0;       // significant digits
+    int exponent = 0;
+    bool has_digit = false;
+    for (; p != end && IsDigit(*p); ++p) {
+      mantissa = mantissa * 10 + (*p - '0');
+      num_digits += (mantissa != 0);
+      has_digit = true;
+    }
+    if (p != end && *p == '.') {
+      for (++p; p != end && IsDigit(*p); ++p) {
+        mantissa = mantissa * 10 + (*p - '0');
+        num_digits += (mantissa != 0);
+        --exponent;
+        has_digit = true;
+      }
+    }
+    if (!has_digit) {
+      return ParseRealSlow(start, end, value);
+    }
+    if (p != end && (*p == 'e' || *p == 'E')) {
+      const char* exp_ptr = p + 1;
+      bool exp_negative = false;
+      if (exp_ptr != end && (*exp_ptr == '-' || *exp_ptr == '+')) {
+        exp_negative = (*exp_ptr == '-');
+        ++exp_ptr;
+      }
+      int exp_value = 0;
+      const char* exp_start = exp_ptr;
+      for (; exp_ptr != end && IsDigit(*exp_ptr) && 
+             exp_value < 10000; ++exp_ptr) {
+        exp_value = exp_value * 10 + (*exp_ptr - '0');
+      }
+      if (exp_ptr == exp_start || exp_value >= 10000) {
+        return ParseRealSlow(start, end, value);
+      }
+      exponent += exp_negative ? -exp_value : exp_value;
+      p = exp_ptr;
+    }
+    if (num_digits > 15 || exponent < -22 || exponent > 22) {
+      return ParseRealSlow(start, end, value);
+    }
+    double result = static_cast<double>(mantissa);
+    if (exponent < 0) {
+      result /= kPow10[-exponent];
+    } else {
+      result *= kPow10[exponent];
+    }
+    *value = negative ? -result : result;
+    return p;
+  }
+
+ protected:
+  static bool IsDigit(char ch) { return ch >= '0' && ch <= '9'; }
+
+  static bool IsSeparator(char ch) { return ch == '\t' || ch == ' '; }
+
+  /* Skip the separators and return the start of next item. */
+
+  static const char* SkipSeparators(const char* p, const char* end) {
+    while (p != end && IsSeparator(*p)) { ++p; }
+    return p;
+  }
+
+  /* The slow path of ParseReal(). strtod() skips the leading white 
+     spaces and does not know end, so it parses a copy of the token 
+     [p, the next white space or end), and a token which starts with 
+     a white space is not a number. */
+
+  static const char* ParseRealSlow(const char* p, const char* end,
+                                   real_t* value) {
+    const char* token_end = p;
+    while (token_end != end && !isspace(static_cast<uint8>(*token_end))) {
+      ++token_end;
+    }
+    if (token_end == p) {
+      return NULL;
+    }
+    char buffer[64];
+    std::string long_token;
+    const char* token = buffer;
+    if (token_end - p < sizeof(buffer)) {
+      memcpy(buffer, p, token_end - p);
+      buffer[token_end - p] = '\0';
+    } else {
+      long_token.assign(p, token_end - p);
+      token = long_token.c_str();
+    }
+    char* end_ptr = NULL;
+    *value = strtod(token, &end_ptr);
+    return end_ptr == token ? NULL : p + (end_ptr - token);
+  }
+
+  /* Report a format error of line and exit. */
+
+  static void FormatError(const StringPiece& line) {
+    LOG(FATAL) << "Input data format error, the line is: "
+               << line.ToString();
+  }
+
+  /* Parse the last item [p, end) of a line to y. */
+
+  static real_t ParseY(const char* p, const char* end, 
+                       const StringPiece& line) {
+    real_t value = 0;
+    p = ParseReal(p, end, &value);
+    if (p == NULL || SkipSeparators(p, end) != end) {
+      FormatError(line);
+    }
+    if (value != 0.0 && value != 1.0 && value != -1.0) {
+      LOG(FATAL) << "Error of Y value: " << value;
+    }
+    return value;
+  }
+
+  /* Parse one line and add it to the matrix as a new row. */
+
+  virtual void ParseLine(const StringPiece& line, DataMatrix* matrix) {
+    // parse the following format:
+    // [0:1234 1:0.123 2:0.21 3:1 4:1 5:0.05 0]
+    const char* end = line.data() + line.size();
+    const char* p = SkipSeparators(line.data(), end);
+    for (;;) {
+      if (p == end) {
+        FormatError(line);  // no y
+      }
+      // An item starts with 'index:' is a feature,
+      // otherwise it must be the last element y.
+      uint32 index = 0;
+      const char* q = ParseUInt(p, end, &index);
+      if (q == NULL || q == end || *q != ':') {
+        matrix->EndRow(ParseY(p, end, line));
+        return;
+      }
+      real_t value = 0;
+      q = ParseReal(q + 1, end, &value);
+      if (q == NULL || (q != end && !IsSeparator(*q))) {
+        FormatError(line);
+      }
+      matrix->AddNode(index, value);
+      p = SkipSeparators(q, end);
     }
   }
 };
@@ -98,65 +272,115 @@ class Parser {
  */
 
 class FFMParser : public Parser {
+ protected:
+  virtual void ParseLine(const StringPiece& line, DataMatrix* matrix) {
+    // parse the following format:
+    // [1:1:1 2:2:1 3:3:1 3:4:1 4:5:0.999 1]
+    const char* end = line.data() + line.size();
+    const char* p = SkipSeparators(line.data(), end);
+    for (;;) {
+      if (p == end) {
+        FormatError(line);  // no y
+      }
+      // An item starts with 'field:' is a feature,
+      // otherwise it must be the last element y.
+      uint32 field = 0;
+      const char* q = ParseUInt(p, end, &field);
+      if (q == NULL || q == end || *q != ':') {
+        matrix->EndRow(ParseY(p, end, line));
+        return;
+      }
+      uint32 index = 0;
+      q = ParseUInt(q + 1, end, &index);
+      if (q == NULL || q == end || *q != ':') {
+        FormatError(line);
+      }
+      real_t value = 0;
+      q = ParseReal(q + 1, end, &value);
+      if (q == NULL || (q != end && !IsSeparator(*q))) {
+        FormatError(line);
+      }
+      matrix->AddNode(index, value, field);
+      p = SkipSeparators(q, end);
+    }
+  }
+};
+
+/* -----------------------------------------------------------------------------
+ * HashFFMParser parses raw string features with the hashing trick, so we do    *
+ * not need an offline job to build the dictionary of the features. Each item   *
+ * is field:feature:value, where feature is any string without ':', '\t' or     *
+ * ' ', and the last item is y:                                                 *
+ *                                                                              *
+ *   [0:user=1234:1 1:ad=ab12cd:1 2:city=beijing:0.5 1]                         *
+ *                                                                              *
+ *   HashFFMParser parser(hash_bits = 24);                                      *
+ *   parser.Parse(list, &matrix);   // indices are in [0, 2^24)                 *
+ *                                                                              *
+ * The feature string is hashed in place (no std::string is created) by         *
+ * XXHash64() into the 2^hash_bits indices, so the model needs 2^hash_bits      *
+ * features. By default the hash is seeded by the field, and the same string    *
+ * in different fields (e.g., "1" of two counters) gets different indices.      *
+ * Two strings may still collide, which is the price of the hashing trick: with *
+ * n distinct features, about n^2 / 2^(hash_bits+1) pairs share an index.       *
+ * -----------------------------------------------------------------------------
+ */
+
+class HashFFMParser : public Parser {
  public:
-  /* The matrix should be pre-initialized with the
-     the same size of the StringList. */
+  explicit HashFFMParser(int hash_bits, bool hash_field = true)
+    : mask_(0), hash_field_(hash_field) {
+    CHECK_GT(hash_bits, 0);
+    CHECK_LE(hash_bits, 31);  // the number of features is an index_t
+    mask_ = (1U << hash_bits) - 1;
+  }
 
-  virtual void Parse(const StringList* list, DataMatrix* matrix) {
-    CHECK_EQ(list->size(), matrix->size());
-    for (int i = 0; i < list->size(); ++i) {
-      // parse the following format:
-      // [1:1:1 2:2:1 3:3:1 3:4:1 4:5:0.999 1]
-      StringList items;
-      SplitStringUsing((*list)[i], "\t", &items);
-      int item_size = items.size();
-      // allocate memory for SparseRow
-      (*matrix)[i].size = item_size - 1;
-      (*matrix)[i].x.reset(new real_t[item_size - 1]);
-      (*matrix)[i].position.reset(new index_t[item_size - 1]);
-      (*matrix)[i].field.reset(new int[item_size - 1]);
-      // parse every single items.
-      for (int n = 0; n < items.size(); ++n) {
-        char* ch_ptr = const_cast<char*>(items[n].c_str());
-        // the last element is y.
-        if (n == item_size - 1) {
-          float value = atof(ch_ptr);
-          if (value != 0.0 && value != 1.0 && value != -1.0) {
-      	  	LOG(FATAL) << "Error of Y value: " << value;
-      	  }
-          (*matrix)[i].y = value;
-          break;
-        }
-        // find the first ':' position.
-        int pos = 0;
-        while (ch_ptr[pos] != ':' && pos < item_size - 1) { ++pos; }
-        if (pos >= item_size - 1) {
-          LOG(FATAL) << "Input data format error, the item is: "
-                     << items[n];
-        }
-        int pos_1 = pos++;
-        // find the second ':' position.
-        while (ch_ptr[pos] != ':' && pos < item_size - 1) { ++pos; }
-        if (pos >= item_size - 1) {
-          LOG(FATAL) << "Input data format error, the item is: "
-                     << items[n];
-        }
-        int pos_2 = pos;
-        ch_ptr[pos_1] = '\0';
-        ch_ptr[pos_2] = '\0';
-        // get field, index, and value.
-        int field = atoi(ch_ptr);
-        int index = atoi(ch_ptr + pos_1 + 1);
-        float value = atof(ch_ptr + pos_2 + 1);
-        // set RowData.
-        *((*matrix)[i].x.get() + n) = value;
-        *((*matrix)[i].position.get() + n) = index;
-        *((*matrix)[i].field.get() + n) = field;       
+  /* Return the index of the feature [p, p + length) in the field. */
+
+  index_t Hash(uint32 field, const char* p, size_t length) const {
+    return XXHash64(p, length, hash_field_ ? field + 1 : 0) & mask_;
+  }
+
+ protected:
+  virtual void ParseLine(const StringPiece& line, DataMatrix* matrix) {
+    const char* end = line.data() + line.size();
+    const char* p = SkipSeparators(line.data(), end);
+    for (;;) {
+      if (p == end) {
+        FormatError(line);  // no y
+      }
+      // An item starts with 'field:' is a feature,
+      // otherwise it must be the last element y.
+      uint32 field = 0;
+      const char* q = ParseUInt(p, end, &field);
+      if (q == NULL || q == end || *q != ':') {
+        matrix->EndRow(ParseY(p, end, line));
+        return;
       }
+      // The feature string ends at the next ':'.
+      const char* feature = ++q;
+      while (q != end && *q != ':' && !IsSeparator(*q)) {
+        ++q;
+      }
+      if (q == feature || q == end || *q != ':') {
+        FormatError(line);
+      }
+      index_t index = Hash(field, feature, q - feature);
+      real_t value = 0;
+      q = ParseReal(q + 1, end, &value);
+      if (q == NULL || (q != end && !IsSeparator(*q))) {
+        FormatError(line);
+      }
+      matrix->AddNode(index, value, field);
+      p = SkipSeparators(q, end);
     }
   }
+
+ private:
+  uint32 mask_;
+  bool hash_field_;
 };
 
 } // namespace f2m
 
-#endif // F2M_READER_PARSER_H_
\ No newline at end of file
+#endif // F2M_READER_PARSER_H_
@@ -0,0 +1,216 @@
+/*
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or (at
+your option) any later version.
+
+This program is distributed in the hope that it will be useful, but
+WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+02110-1301, USA.
+*/
+
+/* 
+Copyright (c) 2016 by contributors.
+Author: Chao Ma (mctt90@gmail.com)
+
+This file is the implementation of pipeline.h
+*/
+
+#include "src/reader/pipeline.h"
+
+#include <pthread.h>
+
+#include "src/common/common.h"
+
+namespace f2m {
+
+/* Constructor */
+
+Pipeline::Pipeline(Reader* reader,
+                   Parser* parser,
+                   int num_samples,
+                   int num_threads,
+                   int num_epochs,
+                   int queue_size)
+  : reader_(reader),
+    parser_(parser),
+    num_samples_(num_samples),
+    num_epochs_(num_epochs),
+    free_chunks_(queue_size + num_threads),
+    chunks_(queue_size),
+    free_batches_(queue_size + num_threads),
+    batches_(queue_size + num_threads),
+    epoch_(0),
+    num_returned_(0) {
+
+  CHECK_NOTNULL(reader_);
+  CHECK_NOTNULL(parser_);
+  CHECK_GT(num_samples_, 0);
+  CHECK_GT(num_threads, 0);
+  CHECK_GT(num_epochs_, 0);
+
+  // Every chunk and batch in flight comes from these pools, 
+  // so the memory is bounded.
+  for (int i = 0; i < queue_size + num_threads; ++i) {
+    all_chunks_.push_back(new Chunk);
+    free_chunks_.Push(all_chunks_.back());
+    all_matrices_.push_back(new DataMatrix(num_samples_));
+    free_batches_.Push(all_matrices_.back());
+  }
+
+  threads_.resize(num_threads + 1);
+  if (pthread_create(&threads_[0], NULL, ReadThread, this) != 0) {
+    LOG(FATAL) << "Cannot create reader thread.";
+  }
+  for (int i = 1; i <= num_threads; ++i) {
+    if (pthread_create(&threads_[i], NULL, ParseThread, this) != 0) {
+      LOG(FATAL) << "Cannot create parser thread.";
+    }
+  }
+}
+
+/* Destructor */
+
+Pipeline::~Pipeline() {
+  // Wake up all the blocked threads.
+  free_chunks_.Close();
+  chunks_.Close();
+  free_batches_.Close();
+  batches_.Close();
+  for (int i = 0; i < threads_.size(); ++i) {
+    pthread_join(threads_[i], NULL);
+  }
+  STLDeleteElementsAndClear(&all_chunks_);
+  STLDeleteElementsAndClear(&all_matrices_);
+}
+
+void* Pipeline::ReadThread(void* pipeline) {
+  reinterpret_cast<Pipeline*>(pipeline)->ReadLoop();
+  return NULL;
+}
+
+void* Pipeline::ParseThread(void* pipeline) {
+  reinterpret_cast<Pipeline*>(pipeline)->ParseLoop();
+  return NULL;
+}
+
+/* Read num_samples_ lines into every chunk. At the end of an epoch,
+   send a signal with the number of batches to the trainer. */
+
+void Pipeline::ReadLoop() {
+  for (int epoch = 0; epoch < num_epochs_; ++epoch) {
+    int num_batches = 0;
+    bool end_of_file = false;
+    while (!end_of_file) {
+      Chunk* chunk = NULL;
+      if (!free_chunks_.Pop(&chunk)) {
+        return;
+      }
+      chunk->buffer.clear();
+      chunk->line_end.clear();
+      chunk->epoch = epoch;
+      StringPiece line;
+      while (chunk->line_end.size() < num_samples_) {
+        if (!reader_->ReadLine(&line)) {
+          end_of_file = true;
+          break;
+        }
+        // Every line is followed by '\n' for the parser.
+        chunk->buffer.append(line.data(), line.size());
+        chunk->line_end.push_back(chunk->buffer.size());
+        chunk->buffer.push_back('\n');
+      }
+      if (chunk->line_end.empty()) {
+        free_chunks_.Push(chunk);
+        continue;
+      }
+      if (!chunks_.Push(chunk)) {
+        return;
+      }
+      ++num_batches;
+    }
+    Batch signal = { NULL, epoch, num_batches };
+    if (!batches_.Push(signal)) {
+      return;
+    }
+  }
+  // No more chunks, let the parser threads exit.
+  chunks_.Close();
+}
+
+/* Parse the chunks to batches. */
+
+void Pipeline::ParseLoop() {
+  for (;;) {
+    // Take a free batch before the chunk, so that a chunk in
+    // parsing never waits for the batches held by the trainer.
+    DataMatrix* matrix = NULL;
+    if (!free_batches_.Pop(&matrix)) {
+      return;
+    }
+    Chunk* chunk = NULL;
+    if (!chunks_.Pop(&chunk)) {
+      return;
+    }
+    chunk->lines.resize(chunk->line_end.size());
+    uint64 start = 0;
+    for (int i = 0; i < chunk->line_end.size(); ++i) {
+      chunk->lines[i].set(chunk->buffer.data() + start,
+                          chunk->line_end[i] - start);
+      start = chunk->line_end[i] + 1;
+    }
+    parser_->Parse(&chunk->lines, matrix);
+    Batch batch = { matrix, chunk->epoch, 0 };
+    free_chunks_.Push(chunk);
+    if (!batches_.Push(batch)) {
+      return;
+    }
+  }
+}
+
+DataMatrix* Pipeline::NextBatch() {
+  while (!Done()) {
+    // All the batches of current epoch have been returned.
+    if (num_batches_.size() > epoch_ &&
+        num_returned_ == num_batches_[epoch_]) {
+      ++epoch_;
+      num_returned_ = 0;
+      return NULL;
+    }
+    // Return the batches that arrived early at first.
+    for (int i = 0; i < pending_.size(); ++i) {
+      if (pending_[i].epoch == epoch_) {
+        DataMatrix* matrix = pending_[i].matrix;
+        pending_.erase(pending_.begin() + i);
+        ++num_returned_;
+        return matrix;
+      }
+    }
+    Batch batch;
+    if (!batches_.Pop(&batch)) {
+      return NULL;
+    }
+    if (batch.matrix == NULL) {  // end-of-epoch signal
+      num_batches_.push_back(batch.num_batches);
+    } else if (batch.epoch == epoch_) {
+      ++num_returned_;
+      return batch.matrix;
+    } else {  // a batch of the following epochs
+      pending_.push_back(batch);
+    }
+  }
+  return NULL;
+}
+
+void Pipeline::Recycle(DataMatrix* matrix) {
+  CHECK_NOTNULL(matrix);
+  free_batches_.Push(matrix);
+}
+
+} // namespace f2m
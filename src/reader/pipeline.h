@@ -0,0 +1,156 @@
+/*
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or (at
+your option) any later version.
+
+This program is distributed in the hope that it will be useful, but
+WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+02110-1301, USA.
+*/
+
+/* 
+Copyright (c) 2016 by contributors.
+Author: Chao Ma (mctt90@gmail.com)
+
+This files defines Pipeline class, which reads and parses the 
+data samples in background threads.
+*/
+
+#ifndef F2M_READER_PIPELINE_H_
+#define F2M_READER_PIPELINE_H_
+
+#include <string>
+#include <vector>
+
+#include "src/common/common.h"
+#include "src/common/data_structure.h"
+#include "src/reader/parser.h"
+#include "src/reader/reader.h"
+#include "src/reader/signal_queue.h"
+
+namespace f2m {
+
+/* -----------------------------------------------------------------------------
+ * Pipeline overlaps I/O, parsing and training in different threads:           *
+ *                                                                              *
+ *   reader thread  --(chunks of lines)-->  N parser threads                    *
+ *                  --(parsed batches)-->   trainer (the caller of NextBatch)   *
+ *                                                                              *
+ * The reader thread reads num_samples lines into a chunk by                    *
+ * Reader::ReadLine(), and the parser threads parse the chunks to DataMatrix.   *
+ * Both chunks and batches are allocated once and recycled, and the queues      *
+ * between threads are bounded (SignalQueue), so the reader thread and the      *
+ * parser threads will wait when the trainer is slow. We can use Pipeline       *
+ * like this:                                                                   *
+ *                                                                              *
+ *   Reader reader("/tmp/testdata", 1, true);                                   *
+ *   FFMParser parser;                                                          *
+ *   Pipeline pipeline(&reader, &parser, num_samples = 100,                     *
+ *                     num_threads = 4, num_epochs = 10);                       *
+ *                                                                              *
+ *   while (!pipeline.Done()) {                                                 *
+ *     DataMatrix* matrix = NULL;                                               *
+ *     while ((matrix = pipeline.NextBatch()) != NULL) {                        *
+ *       ... use the matrix to train model                                      *
+ *       pipeline.Recycle(matrix);                                              *
+ *     }                                                                        *
+ *     ... the end of an epoch, evaluate the model                              *
+ *   }                                                                          *
+ *                                                                              *
+ * The batches are parsed out of order, but the batches of an epoch are always  *
+ * returned before the end-of-epoch signal (NULL) and never mixed with the      *
+ * batches of the next epoch. NextBatch() and Recycle() should be called by     *
+ * only one thread. The Parser is shared by all the parser threads, which is    *
+ * safe since Parser and FFMParser have no state.                               *
+ * -----------------------------------------------------------------------------
+ */
+
+class Pipeline {
+ public:
+  Pipeline(Reader* reader,
+           Parser* parser,
+           int num_samples,
+           int num_threads,
+           int num_epochs,
+           int queue_size = 16);
+
+  ~Pipeline();
+
+  /* Return the next parsed batch of current epoch. Return NULL at
+     the end of current epoch, and then the following calls will 
+     return the batches of the next epoch. */
+
+  DataMatrix* NextBatch();
+
+  /* Give back a batch returned by NextBatch(),
+     so that its memory can be reused. */
+
+  void Recycle(DataMatrix* matrix);
+
+  /* Return the current epoch (start from 0). */
+
+  int epoch() const { return epoch_; }
+
+  /* Return true if all the epochs have been finished. */
+
+  bool Done() const { return epoch_ >= num_epochs_; }
+
+ private:
+  /* A chunk of raw lines, which are stored in one buffer. */
+
+  struct Chunk {
+    std::string buffer;
+    std::vector<uint64> line_end;
+    StringPieceList lines;
+    int epoch;
+  };
+
+  /* A parsed batch, or an end-of-epoch signal 
+     when matrix is NULL. */
+
+  struct Batch {
+    DataMatrix* matrix;
+    int epoch;
+    int num_batches;   /* number of batches in this epoch (signal only) */
+  };
+
+  Reader* reader_;
+  Parser* parser_;
+  int num_samples_;
+  int num_epochs_;
+
+  SignalQueue<Chunk*> free_chunks_;
+  SignalQueue<Chunk*> chunks_;
+  SignalQueue<DataMatrix*> free_batches_;
+  SignalQueue<Batch> batches_;
+
+  std::vector<Chunk*> all_chunks_;
+  std::vector<DataMatrix*> all_matrices_;
+  std::vector<pthread_t> threads_;
+
+  /* The following fields are only used by the trainer thread. */
+
+  int epoch_;                     /* current epoch */
+  int num_returned_;              /* returned batches of current epoch */
+  std::vector<int> num_batches_;  /* number of batches of each epoch */
+  std::vector<Batch> pending_;    /* batches of the following epochs */
+
+  void ReadLoop();
+  void ParseLoop();
+
+  static void* ReadThread(void* pipeline);
+  static void* ParseThread(void* pipeline);
+
+  DISALLOW_COPY_AND_ASSIGN(Pipeline);
+};
+
+} // namespace f2m
+
+#endif // F2M_READER_PIPELINE_H_
@@ -25,50 +25,213 @@ This file is the implementation of reader.h
 #include "src/reader/reader.h"
 
 #include <string.h>
+#include <algorithm>
+#if defined __unix__ || defined __APPLE__
+#include <dirent.h>
+#include <glob.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
 
 #include "src/common/common.h"
 
 namespace f2m {
 
-const int kDefaultMaxSizeLine = 100 * 1024; // 100 KB one line
+const uint64 kInitialSizeLineBuffer = 100 * 1024; // grows for longer lines
+const uint64 kPrefetchBlockSize = 16 * 1024 * 1024; // block of pread()
+const uint64 kStreamBlockSize = 4 * 1024 * 1024;    // decompressed block
+const int kNumStreamBlocks = 4;                     // blocks in the ring
+
+#if defined __unix__ || defined __APPLE__
+
+/* Append the files of an item of the input to the list. */
+
+static void ListFilesOfItem(const std::string& item, StringList* files) {
+  struct stat info;
+  if (stat(item.c_str(), &info) == 0 && S_ISDIR(info.st_mode)) {
+    DIR* dir = opendir(item.c_str());
+    if (dir == NULL) {
+      LOG(FATAL) << "Cannot open directory: " << item;
+    }
+    StringList names;
+    struct dirent* entry = NULL;
+    while ((entry = readdir(dir)) != NULL) {
+      std::string path = item + "/" + entry->d_name;
+      if (entry->d_name[0] != '.' && 
+          stat(path.c_str(), &info) == 0 && S_ISREG(info.st_mode)) {
+        names.push_back(path);
+      }
+    }
+    closedir(dir);
+    if (names.empty()) {
+      LOG(FATAL) << "No file in directory: " << item;
+    }
+    std::sort(names.begin(), names.end());
+    files->insert(files->end(), names.begin(), names.end());
+  } else if (item.find_first_of("*?[") != std::string::npos) {
+    glob_t result;
+    // The paths are sorted by glob().
+    if (glob(item.c_str(), 0, NULL, &result) != 0) {
+      LOG(FATAL) << "No file matches: " << item;
+    }
+    for (size_t i = 0; i < result.gl_pathc; ++i) {
+      files->push_back(result.gl_pathv[i]);
+    }
+    globfree(&result);
+  } else {
+    files->push_back(item);
+  }
+}
+
+#else  // No directory or pattern on this platform.
+
+static void ListFilesOfItem(const std::string& item, StringList* files) {
+  files->push_back(item);
+}
+
+#endif
+
+void ListFiles(const std::string& input, StringList* files) {
+  CHECK_NOTNULL(files);
+  files->clear();
+  StringList items;
+  SplitStringUsing(input, ",", &items);
+  for (size_t i = 0; i < items.size(); ++i) {
+    ListFilesOfItem(items[i], files);
+  }
+  if (files->empty()) {
+    LOG(FATAL) << "No input file: " << input;
+  }
+}
 
 /* Constructor */
 
 Reader::Reader(const std::string& filename,
                int num_samples,
-               bool in_memory)
+               bool in_memory,
+               int shard_id,
+               int num_shards)
   : filename_(filename),
     num_samples_(num_samples),
-    in_memory_(in_memory) {
+    in_memory_(in_memory),
+    file_ptr_(NULL),
+    memory_buffer_(NULL),
+    mapped_(false),
+    size_memory_buffer_(0),
+    size_memory_mapping_(0),
+    shard_begin_(0),
+    shard_end_(0),
+    cursor_(0),
+    epoch_(0),
+    size_line_buffer_(0),
+    max_line_length_(0),
+    next_range_(0),
+    block_pos_(0),
+    end_of_stream_(true),
+    shuffle_(false),
+    shuffle_block_size_(1),
+    random_state_(0),
+    next_block_(0),
+    next_line_(0) {
 
   CHECK_GT(num_samples_, 0);
 
   data_samples_ = new StringList(num_samples_);
+  data_views_ = new StringPieceList(num_samples_);
 
-  file_ptr_ = OpenFileOrDie(filename_.c_str(), "r");
+  CHECK_GT(num_shards, 0);
+  CHECK_GE(shard_id, 0);
+  CHECK_LT(shard_id, num_shards);
+
+  StringList files;
+  ListFiles(filename, &files);
+  if (files.size() == 1) {
+    filename_ = files[0];
+    OpenOneFile(shard_id, num_shards);
+  } else {
+    AssignFiles(files, shard_id, num_shards);
+  }
 
-  // allocate memory for buffer
   if (in_memory_) {
-    // get the size of current file
-    fseek(file_ptr_, 0, SEEK_END);
-    size_memory_buffer_ = ftell(file_ptr_);
-    rewind(file_ptr_);
-    try {
-      memory_buffer_ = new char[size_memory_buffer_];
-    } catch(std::bad_alloc&) {
-      LOG(FATAL) << "Cannot allocate enough memory for Reader.";
+    // load all data into memory (if it is not mapped)
+    if (!mapped_) {
+      ReadIntoMemory();
     }
-  } else { // do not use memory buffer
-    memory_buffer_ = NULL;
+  } else {
+    // read the blocks of the ranges in a background thread
+    line_buffer_.reset(new char[kInitialSizeLineBuffer]);
+    size_line_buffer_ = kInitialSizeLineBuffer;
+    NextRange();
   }
+}
 
-  // read all data into memory (if needed)
-  if (in_memory_) {
-    uint64 result = fread(memory_buffer_, 1, 
-                          size_memory_buffer_, file_ptr_);
-    if (result != size_memory_buffer_) {
-      LOG(FATAL) << "Read file error.";
+/* Find the byte range of this reader in one file, and map the 
+   file into memory in the in-memory mode. A compressed file is 
+   not split, and shard 0 reads all of it. */
+
+void Reader::OpenOneFile(int shard_id, int num_shards) {
+  file_ptr_ = OpenFileOrDie(filename_.c_str(), "r");
+  FileRange range;
+  range.filename = filename_;
+  range.codec = DetectCodec(file_ptr_);
+  if (range.codec == kCodecNone) {
+    SetShardRange(shard_id, num_shards);
+    range.begin = shard_begin_;
+    range.end = shard_end_;
+    ranges_.push_back(range);
+    if (in_memory_) {
+      MapFileIntoMemory();
+      mapped_ = true;
     }
+  } else if (shard_id == 0) {
+    range.begin = 0;
+    range.end = kEndOfFile;
+    ranges_.push_back(range);
+  }
+  // the mapping and the streams do not need the file any more.
+  fclose(file_ptr_);
+  file_ptr_ = NULL;
+}
+
+/* Assign whole files to the shards. The larger files are assigned 
+   first, each to the shard with the fewest bytes, so the shards 
+   have almost the same size. Every Reader computes the same 
+   assignment, and keeps its files in the order of the list. */
+
+void Reader::AssignFiles(const StringList& files,
+                         int shard_id, int num_shards) {
+  std::vector<uint64> sizes(files.size());
+  std::vector<std::pair<uint64, size_t> > order(files.size());
+  for (size_t i = 0; i < files.size(); ++i) {
+    FILE* file = OpenFileOrDie(files[i].c_str(), "r");
+    fseek(file, 0, SEEK_END);
+    sizes[i] = ftell(file);
+    fclose(file);
+    // the larger first, and the earlier first for the same size
+    order[i] = std::make_pair(~sizes[i], i);
+  }
+  std::sort(order.begin(), order.end());
+  std::vector<uint64> load(num_shards, 0);
+  std::vector<bool> mine(files.size(), false);
+  for (size_t i = 0; i < order.size(); ++i) {
+    size_t index = order[i].second;
+    int shard = std::min_element(load.begin(), load.end()) - load.begin();
+    load[shard] += sizes[index];
+    mine[index] = (shard == shard_id);
+  }
+  for (size_t i = 0; i < files.size(); ++i) {
+    if (!mine[i]) {
+      continue;
+    }
+    FileRange range;
+    range.filename = files[i];
+    FILE* file = OpenFileOrDie(files[i].c_str(), "r");
+    range.codec = DetectCodec(file);
+    fclose(file);
+    range.begin = 0;
+    range.end = (range.codec == kCodecNone) ? sizes[i] : kEndOfFile;
+    ranges_.push_back(range);
   }
 }
 
@@ -81,84 +244,473 @@ Reader::~Reader() {
   }
 
   if (memory_buffer_ != NULL) {
-    delete memory_buffer_;
+    UnmapFile();
   }
 
   delete data_samples_;
-  
+  delete data_views_;
 }
 
-StringList* Reader::Samples() {
-  return in_memory_ ? SampleFromMemory() : 
-                      SampleFromDisk();
+/* Split the file into num_shards byte ranges of the same size, and 
+   move the bounds of each range forward to the start of a line. So 
+   a line belongs to the shard which its first byte falls into, and 
+   every line is read by exactly one shard. */
+
+void Reader::SetShardRange(int shard_id, int num_shards) {
+  CHECK_GT(num_shards, 0);
+  CHECK_GE(shard_id, 0);
+  CHECK_LT(shard_id, num_shards);
+  fseek(file_ptr_, 0, SEEK_END);
+  uint64 file_size = ftell(file_ptr_);
+  shard_begin_ = FindLineStart(file_size * shard_id / num_shards);
+  shard_end_ = FindLineStart(file_size * (shard_id + 1) / num_shards);
+  // A shard may be empty when the file has fewer lines than shards,
+  // and then every epoch of it is an empty batch.
+  fseek(file_ptr_, shard_begin_, SEEK_SET);
+  cursor_ = shard_begin_;
 }
 
-/* Sample data from disk files. */
+/* Return the start of the first line at or after position. */
 
-StringList* Reader::SampleFromDisk() {
-  static char* line = new char[kDefaultMaxSizeLine];
-  // read num_samples_ lines of data from disk file.
-  for (int i = 0; i < num_samples_; ++i) {
-    if (fgets(line, kDefaultMaxSizeLine, file_ptr_) == NULL) {
-      // Either ferror or feof. Anyway, 
-      // return to the start of the file.
-      fseek(file_ptr_, 0, SEEK_SET);
-      i--; // re-read
-      continue;
+uint64 Reader::FindLineStart(uint64 position) {
+  if (position == 0) {
+    return 0;
+  }
+  // position is the start of a line if the byte before it is '\n'.
+  fseek(file_ptr_, position - 1, SEEK_SET);
+  int c = 0;
+  while ((c = getc(file_ptr_)) != EOF) {
+    if (c == '\n') {
+      return position;
+    }
+    ++position;
+  }
+  return position - 1;  // the end of the file
+}
+
+#if defined __unix__ || defined __APPLE__
+
+/* Map the whole file into memory. We first reserve an anonymous
+   mapping which is one page larger than the file, and then map the
+   file over it. Thus the byte after the file always exists and is
+   '\0', even if the last line does not end with '\n'. */
+
+void Reader::MapFileIntoMemory() {
+  fseek(file_ptr_, 0, SEEK_END);
+  size_memory_buffer_ = ftell(file_ptr_);
+  rewind(file_ptr_);
+  if (size_memory_buffer_ == 0) {
+    LOG(FATAL) << "Empty input file: " << filename_;
+  }
+  size_memory_mapping_ = size_memory_buffer_ + sysconf(_SC_PAGESIZE);
+  void* addr = mmap(NULL, size_memory_mapping_, PROT_READ,
+                    MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (addr == MAP_FAILED) {
+    LOG(FATAL) << "Cannot reserve enough memory for Reader.";
+  }
+  if (mmap(addr, size_memory_buffer_, PROT_READ, MAP_PRIVATE | MAP_FIXED,
+           fileno(file_ptr_), 0) == MAP_FAILED) {
+    LOG(FATAL) << "Cannot map file: " << filename_;
+  }
+  memory_buffer_ = reinterpret_cast<char*>(addr);
+  // We scan the shard from head to tail, so tell the
+  // kernel to read ahead aggressively.
+  uint64 page_size = sysconf(_SC_PAGESIZE);
+  uint64 start = shard_begin_ / page_size * page_size;
+  madvise(memory_buffer_ + start, shard_end_ - start, MADV_SEQUENTIAL);
+  madvise(memory_buffer_ + start, shard_end_ - start, MADV_WILLNEED);
+}
+
+void Reader::UnmapFile() {
+  if (mapped_) {
+    munmap(memory_buffer_, size_memory_mapping_);
+  } else {
+    delete [] memory_buffer_;  // see ReadIntoMemory()
+  }
+  memory_buffer_ = NULL;
+}
+
+#else  // No mmap() on this platform, read all data into heap.
+
+void Reader::MapFileIntoMemory() {
+  fseek(file_ptr_, 0, SEEK_END);
+  size_memory_buffer_ = ftell(file_ptr_);
+  rewind(file_ptr_);
+  if (size_memory_buffer_ == 0) {
+    LOG(FATAL) << "Empty input file: " << filename_;
+  }
+  size_memory_mapping_ = size_memory_buffer_ + 1;
+  try {
+    memory_buffer_ = new char[size_memory_mapping_];
+  } catch(std::bad_alloc&) {
+    LOG(FATAL) << "Cannot allocate enough memory for Reader.";
+  }
+  uint64 result = fread(memory_buffer_, 1,
+                        size_memory_buffer_, file_ptr_);
+  if (result != size_memory_buffer_) {
+    LOG(FATAL) << "Read file error.";
+  }
+  memory_buffer_[size_memory_buffer_] = '\0';
+}
+
+void Reader::UnmapFile() {
+  delete [] memory_buffer_;
+  memory_buffer_ = NULL;
+}
+
+#endif
+
+/* Append length bytes of data to a heap buffer, which is doubled 
+   when it is full. One more byte is always left for the '\0'. */
+
+static void AppendToBuffer(const char* data, uint64 length,
+                           scoped_array<char>* buffer, 
+                           uint64* size, uint64* capacity) {
+  if (*size + length + 1 > *capacity) {
+    while (*size + length + 1 > *capacity) {
+      *capacity *= 2;
+    }
+    char* larger = NULL;
+    try {
+      larger = new char[*capacity];
+    } catch(std::bad_alloc&) {
+      LOG(FATAL) << "Cannot allocate enough memory for Reader.";
+    }
+    memcpy(larger, buffer->get(), *size);
+    buffer->reset(larger);
+  }
+  memcpy(buffer->get() + *size, data, length);
+  *size += length;
+}
+
+/* Read (and decompress) all the ranges into a heap buffer. A '\n' 
+   is added between two files if the first one does not end with
+   it. The byte after the data is '\0' as the mapped file. */
+
+void Reader::ReadIntoMemory() {
+  uint64 capacity = kStreamBlockSize;
+  scoped_array<char> buffer(new char[capacity]);
+  size_memory_buffer_ = 0;
+  for (size_t i = 0; i < ranges_.size(); ++i) {
+    if (size_memory_buffer_ > 0 && 
+        buffer[size_memory_buffer_ - 1] != '\n') {
+      AppendToBuffer("\n", 1, &buffer, &size_memory_buffer_, &capacity);
     }
-    int read_size = strlen(line);
-    if (line[read_size - 1] != '\n') {
-      LOG(FATAL) << "Encountered a too-long line..";
+    BlockStream stream(ranges_[i].filename, ranges_[i].codec,
+                       kStreamBlockSize, 2, 
+                       ranges_[i].begin, ranges_[i].end);
+    StringPiece block;
+    while (stream.NextBlock(&block)) {
+      AppendToBuffer(block.data(), block.size(), 
+                     &buffer, &size_memory_buffer_, &capacity);
+    }
+  }
+  buffer[size_memory_buffer_] = '\0';
+  size_memory_mapping_ = capacity;
+  memory_buffer_ = buffer.release();
+  shard_begin_ = 0;
+  shard_end_ = size_memory_buffer_;
+  cursor_ = 0;
+}
+
+StringList* Reader::Samples() {
+  if (!in_memory_) {
+    return SampleFromDisk();
+  }
+  // Copy the views to strings for the caller.
+  StringPieceList* views = SampleFromMemory();
+  data_samples_->resize(views->size());
+  for (size_t i = 0; i < views->size(); ++i) {
+    (*data_samples_)[i].assign((*views)[i].data(), (*views)[i].size());
+  }
+  return data_samples_;
+}
+
+StringPieceList* Reader::SampleViews() {
+  if (in_memory_) {
+    return SampleFromMemory();
+  }
+  // Point the views to the strings read from disk.
+  StringList* samples = SampleFromDisk();
+  data_views_->resize(samples->size());
+  for (size_t i = 0; i < samples->size(); ++i) {
+    (*data_views_)[i] = StringPiece((*samples)[i]);
+  }
+  return data_views_;
+}
+
+/* Return to the head of the shard and start a new epoch. */
+
+void Reader::Rewind() {
+  if (!in_memory_) {
+    next_range_ = 0;
+    end_of_stream_ = true;
+    NextRange();
+  }
+  cursor_ = shard_begin_;
+  ++epoch_;
+  if (shuffle_) {
+    ShuffleBlocks();
+  }
+}
+
+/* Move to the next block of the current range. */
+
+void Reader::NextStreamBlock() {
+  block_pos_ = 0;
+  end_of_stream_ = !stream_->NextBlock(&block_);
+}
+
+/* At the end of a range, open the stream of the next range which is
+   not empty. end_of_stream_ is still true after the last range. The 
+   stream of a single range is restarted instead of created again. */
+
+void Reader::NextRange() {
+  while (end_of_stream_ && next_range_ < ranges_.size()) {
+    const FileRange& range = ranges_[next_range_++];
+    if (stream_.get() != NULL && ranges_.size() == 1) {
+      stream_->Restart();
+    } else if (range.codec == kCodecNone) {
+      // Two blocks: one is being read while the other is used.
+      uint64 block_size = std::min(kPrefetchBlockSize, 
+                                   range.end - range.begin + 1);
+      stream_.reset(new BlockStream(range.filename, range.codec, 
+                                    block_size, 2, 
+                                    range.begin, range.end));
     } else {
-      line[read_size - 1] = '\0';
-      // Handle some windows text format.
-      if (read_size > 1 && line[read_size - 2] == '\r') { 
-        line[read_size - 2] = '\0';
-      }
+      stream_.reset(new BlockStream(range.filename, range.codec, 
+                                    kStreamBlockSize, kNumStreamBlocks));
     }
-    (*data_samples_)[i].assign(line);
+    NextStreamBlock();
+  }
+}
+
+/* Make line_buffer_ hold at least size bytes, and keep its data. */
+
+void Reader::ReserveLineBuffer(uint64 size) {
+  if (size <= size_line_buffer_) {
+    return;
+  }
+  uint64 new_size = size_line_buffer_ * 2;
+  while (new_size < size) {
+    new_size *= 2;
+  }
+  char* buffer = new char[new_size];
+  memcpy(buffer, line_buffer_.get(), size_line_buffer_);
+  line_buffer_.reset(buffer);
+  size_line_buffer_ = new_size;
+}
+
+/* Read one line from the blocks of the disk file and return a view
+   of it, without the tailing '\n' (and '\r' for windows text format).
+   The line is copied to line_buffer_, since it may cross the blocks. 
+   We move to the next block as soon as a block is used up, so AtEnd()
+   is true right after the last line. Return false at the end of the 
+   shard, and the next line will be read from the head of the shard.
+   Used by Reader::SampleFromDisk() and Reader::ReadLine() */
+
+bool Reader::ReadLineFromDisk(StringPiece* view) {
+  if (AtEnd()) {
+    Rewind();
+    return false;
+  }
+  uint64 read_size = 0;
+  for (;;) {
+    const char* begin = block_.data() + block_pos_;
+    uint64 remain = block_.size() - block_pos_;
+    const char* end = reinterpret_cast<const char*>(
+        memchr(begin, '\n', remain));
+    uint64 size = (end == NULL) ? remain : end - begin;
+    ReserveLineBuffer(read_size + size + 1);
+    memcpy(line_buffer_.get() + read_size, begin, size);
+    read_size += size;
+    block_pos_ += (end == NULL) ? size : size + 1;
+    if (block_pos_ == block_.size()) {
+      NextStreamBlock();
+    }
+    // The last line of a file may have no '\n'.
+    if (end != NULL || end_of_stream_) {
+      break;
+    }
+  }
+  NextRange();
+  char* line = line_buffer_.get();
+  line[read_size] = '\0';
+  // Handle some windows text format.
+  if (read_size > 0 && line[read_size - 1] == '\r') {
+    line[--read_size] = '\0';
+  }
+  UpdateMaxLineLength(read_size);
+  view->set(line, read_size);
+  return true;
+}
+
+/* Sample data from disk files. */
+
+StringList* Reader::SampleFromDisk() {
+  // read at most num_samples_ lines of data from disk file.
+  data_samples_->resize(num_samples_);
+  int num_lines = 0;
+  StringPiece line;
+  while (num_lines < num_samples_ && ReadLineFromDisk(&line)) {
+    (*data_samples_)[num_lines++].assign(line.data(), line.size());
+  }
+  data_samples_->resize(num_lines);
+  // The last batch of an epoch ends here. If no line is read, 
+  // ReadLine() has started the next epoch (e.g., an empty shard).
+  if (num_lines > 0 && AtEnd()) {
+    Rewind();
   }
   return data_samples_;
 }
 
-/* Read one line from a memory buffer.
-   Used by Reader::SampleFromMemory() */
+/* Read one line from a memory buffer and return a view of it,
+   without the tailing '\n' (and '\r' for windows text format).
+   Return false at the end of the shard, and the next line 
+   will be read from the head of the shard.
+   Used by Reader::SampleFromMemory() and Reader::ReadLine() */
 
-int ReadLineFromMemory(char* line, char* buf, uint64 buf_len) {
-  static uint64 start_position = 0;
-  static uint64 end_position = 0;
-  // End of the buffer, return to the head
-  if (end_position >= buf_len) {
-    start_position = 0;
-    end_position = 0;
+bool Reader::ReadLineFromMemory(StringPiece* view) {
+  if (shuffle_) {
+    return ReadShuffledLine(view);
+  }
+  // End of the shard, return to the head
+  if (AtEnd()) {
+    Rewind();
+    return false;
   }
   // Read one line
-  while (*(buf + end_position) != '\n') { ++end_position; }
-  int read_size = end_position - start_position + 1;
-  if (read_size > kDefaultMaxSizeLine) {
-    LOG(FATAL) << "Encountered a too-long line..";   
+  uint64 remain = shard_end_ - cursor_;
+  const char* line = memory_buffer_ + cursor_;
+  const char* end = reinterpret_cast<const char*>(
+      memchr(line, '\n', remain));
+  uint64 read_size = (end == NULL) ? remain : end - line;
+  cursor_ += read_size + 1;
+  // Handle some windows text format.
+  if (read_size > 0 && line[read_size - 1] == '\r') {
+    --read_size;
   }
-  memcpy(line, buf + start_position, read_size);
-  start_position = ++end_position;
-  return read_size;
+  UpdateMaxLineLength(read_size);
+  view->set(line, read_size);
+  return true;
 }
 
-/* Sample data from a memory buffer. */
+void Reader::EnableShuffle(uint64 block_size, uint64 seed) {
+  if (!in_memory_) {
+    LOG(FATAL) << "Shuffling is only supported in the in-memory mode.";
+  }
+  CHECK_GT(block_size, 0);
+  // Build the index of lines once.
+  if (line_offsets_.empty()) {
+    uint64 position = shard_begin_;
+    while (position < shard_end_) {
+      line_offsets_.push_back(position);
+      const char* end = reinterpret_cast<const char*>(
+          memchr(memory_buffer_ + position, '\n', shard_end_ - position));
+      position = (end == NULL) ? shard_end_ 
+                               : end - memory_buffer_ + 1;
+    }
+    line_offsets_.push_back(shard_end_);
+  }
+  shuffle_ = true;
+  shuffle_block_size_ = block_size;
+  random_state_ = seed;
+  ShuffleBlocks();
+}
 
-StringList* Reader::SampleFromMemory() {
-  static char* line = new char[kDefaultMaxSizeLine];
-  // read num_samples_ lines of data from memory
-  for (int i = 0; i < num_samples_; ++i) {
-    int read_size = ReadLineFromMemory(line, memory_buffer_, 
-                                       size_memory_buffer_);
-    line[read_size - 1] = '\0';
-    // Handle some windows text format.
-    if (read_size > 1 && line[read_size - 2] == '\r') { 
-      line[read_size - 2] = '\0';
+/* A splitmix64 generator. Each Reader has its own state, so that
+   the Readers in different threads do not share a generator. 
+   Return a random number in [0, bound). */
+
+uint64 Reader::NextRandom(uint64 bound) {
+  uint64 z = (random_state_ += 0x9E3779B97F4A7C15ULL);
+  z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+  z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+  return (z ^ (z >> 31)) % bound;
+}
+
+/* Put the blocks in a new random order (Fisher-Yates shuffle). */
+
+void Reader::ShuffleBlocks() {
+  uint64 num_lines = line_offsets_.size() - 1;
+  uint64 num_blocks = (num_lines + shuffle_block_size_ - 1) / 
+                      shuffle_block_size_;
+  block_order_.resize(num_blocks);
+  for (uint64 i = 0; i < num_blocks; ++i) {
+    block_order_[i] = i;
+  }
+  for (uint64 i = num_blocks; i > 1; --i) {
+    std::swap(block_order_[i - 1], block_order_[NextRandom(i)]);
+  }
+  next_block_ = 0;
+  line_order_.clear();
+  next_line_ = 0;
+}
+
+/* Put the lines of a block in a new random order. */
+
+void Reader::ShuffleLinesInBlock(uint64 block) {
+  uint64 num_lines = line_offsets_.size() - 1;
+  uint64 begin = block * shuffle_block_size_;
+  uint64 end = std::min(begin + shuffle_block_size_, num_lines);
+  line_order_.resize(end - begin);
+  for (uint64 i = 0; i < line_order_.size(); ++i) {
+    line_order_[i] = begin + i;
+  }
+  for (uint64 i = line_order_.size(); i > 1; --i) {
+    std::swap(line_order_[i - 1], line_order_[NextRandom(i)]);
+  }
+  next_line_ = 0;
+}
+
+/* Read the next line in the random order. Return false at the 
+   end of the epoch, and the next epoch uses a new order. */
+
+bool Reader::ReadShuffledLine(StringPiece* view) {
+  if (next_line_ >= line_order_.size()) {
+    if (next_block_ >= block_order_.size()) {
+      Rewind();
+      return false;
     }
-    (*data_samples_)[i].assign(line);
+    ShuffleLinesInBlock(block_order_[next_block_++]);
+  }
+  uint64 index = line_order_[next_line_++];
+  const char* line = memory_buffer_ + line_offsets_[index];
+  uint64 read_size = line_offsets_[index + 1] - line_offsets_[index];
+  // Remove the tailing '\n' and '\r'.
+  if (read_size > 0 && line[read_size - 1] == '\n') {
+    --read_size;
   }
-  return data_samples_; 
+  if (read_size > 0 && line[read_size - 1] == '\r') {
+    --read_size;
+  }
+  UpdateMaxLineLength(read_size);
+  view->set(line, read_size);
+  return true;
+}
+
+/* Sample data from a memory buffer. */
+
+StringPieceList* Reader::SampleFromMemory() {
+  // read at most num_samples_ lines of data from memory.
+  // ReadLine() is virtual, so that the sub-classes (e.g., 
+  // BinaryReader) only need to know how to read one record.
+  data_views_->resize(num_samples_);
+  int num_lines = 0;
+  while (num_lines < num_samples_ && ReadLine(&(*data_views_)[num_lines])) {
+    ++num_lines;
+  }
+  data_views_->resize(num_lines);
+  // The last batch of an epoch ends here. If no line is read, 
+  // ReadLine() has started the next epoch (e.g., an empty shard).
+  if (num_lines > 0 && AtEnd()) {
+    Rewind();
+  }
+  return data_views_; 
+}
+
+bool Reader::ReadLine(StringPiece* line) {
+  return in_memory_ ? ReadLineFromMemory(line) : ReadLineFromDisk(line);
 }
 
 } // namespace f2m
@@ -30,6 +30,7 @@ in each iteration.
 #include <vector>
 
 #include "src/common/common.h"
+#include "src/reader/block_stream.h"
 
 namespace f2m {
 
@@ -57,6 +58,11 @@ namespace f2m {
  *   N = total_samples indicates that we use Bactch GD.                         *
  *   others indicate that we use mini-batch GD.                                 *
  *                                                                              *
+ * In the disk mode, a background thread reads the next block (16 MB) of the    *
+ * file by pread() while Reader returns the lines of the current block          *
+ * (double buffering), so the caller seldom waits for the disk. A line may      *
+ * cross two blocks, and it is joined in a buffer of Reader.                    *
+ *                                                                              *
  * Before sampling, we can load all data into memory if the capacity            *
  * of your main memory is big enough for current training task:                 *
  *                                                                              *
@@ -76,6 +82,94 @@ namespace f2m {
  *                                                                              *
  *   }                                                                          *
  *                                                                              *
+ * The in-memory mode maps the file into memory (mmap) instead of reading it    *
+ * into a heap buffer, so the construction costs O(1) and the pages are loaded  *
+ * by the OS on demand. To avoid copying any line before parsing, we can use    *
+ * SampleViews() instead of Samples(), which returns N views (pointer + length) *
+ * into the mapped file:                                                        *
+ *                                                                              *
+ *   Loop until converge {                                                      *
+ *                                                                              *
+ *      Views = reader.SampleViews(); // return N views of data samples         *
+ *                                                                              *
+ *      parser.Parse(Views, &matrix);                                           *
+ *                                                                              *
+ *   }                                                                          *
+ *                                                                              *
+ * The views are valid until the next call of Samples() or SampleViews(), and   *
+ * every view is followed by a non-digit byte ('\r', '\n' or '\0'), so the      *
+ * numbers inside it can be parsed by atoi() and atof() directly.               *
+ *                                                                              *
+ * A batch never crosses the end of the file. The last batch of an epoch        *
+ * holds the remaining lines (Data.size() may be less than N), and the next     *
+ * batch starts a new epoch from the head of the file. So the trainer can       *
+ * evaluate the model after each epoch:                                         *
+ *                                                                              *
+ *   while (reader.epoch() < num_epochs) {                                      *
+ *                                                                              *
+ *      int epoch = reader.epoch();                                             *
+ *                                                                              *
+ *      Data = reader.Samples();                                                *
+ *                                                                              *
+ *      ... train model with Data.size() samples                                *
+ *                                                                              *
+ *      if (reader.epoch() != epoch) { ... the end of an epoch }                *
+ *                                                                              *
+ *   }                                                                          *
+ *                                                                              *
+ * To read one file with many threads, each thread can create its own Reader    *
+ * for one shard of the file. The file is split into num_shards byte ranges,    *
+ * which are aligned to the start of lines, and each Reader only returns the    *
+ * lines in its range:                                                          *
+ *                                                                              *
+ *   // In thread i of N threads                                                *
+ *   Reader reader(filename = "/tmp/testdata",                                  *
+ *                 num_samples = 100,                                           *
+ *                 in_memory = false,                                           *
+ *                 shard_id = i,                                                *
+ *                 num_shards = N);                                             *
+ *                                                                              *
+ * If the file has fewer lines than shards, some shards are empty, and each     *
+ * call of Samples() on an empty shard returns no line and finishes an epoch.   *
+ *                                                                              *
+ * Logs are often sorted by time, which hurts the convergence of SGD. In the    *
+ * in-memory mode, Reader can return the lines in a new random order in each    *
+ * epoch. It builds an index of the line offsets once, so the file does not     *
+ * need to be shuffled on disk:                                                 *
+ *                                                                              *
+ *   Reader reader(filename = "/tmp/testdata",                                  *
+ *                 num_samples = 100,                                           *
+ *                 in_memory = true);                                           *
+ *                                                                              *
+ *   reader.EnableShuffle(block_size = 1);                                      *
+ *                                                                              *
+ * With block_size > 1, Reader shuffles the blocks of block_size adjacent       *
+ * lines, and then the lines inside each block. The lines of one block are      *
+ * close to each other in memory, so this is more cache-friendly, and only      *
+ * the order of blocks is kept in memory.                                       *
+ *                                                                              *
+ * The input of Reader can also be a list of files separated by ',', a          *
+ * directory, or a glob pattern (see ListFiles()), e.g., the hourly parts of    *
+ * the logs of a day:                                                           *
+ *                                                                              *
+ *   Reader reader(filename = "/data/2016-10-17/part-*",                        *
+ *                 num_samples = 100);                                          *
+ *                                                                              *
+ * The files are read one by one as one stream, and an epoch is a pass over     *
+ * all of them. With many shards, the whole files are assigned to the shards    *
+ * (the larger files first, each to the smallest shard), so each thread reads   *
+ * its own files and no file is read by two threads. A shard may be empty if    *
+ * there are fewer files than shards. In the in-memory mode, the files of a     *
+ * shard are loaded into one heap buffer.                                       *
+ *                                                                              *
+ * Reader also reads the gzip and zstd files, which are detected by the magic   *
+ * bytes (see block_stream.h). In the disk mode, a background thread            *
+ * decompresses the file into a ring of blocks, and Reader joins the lines      *
+ * across the blocks. In the in-memory mode, the whole file is decompressed     *
+ * into a heap buffer once. A compressed file can not be split at the start     *
+ * of a line without decompressing it, so shard 0 reads the whole file and      *
+ * the other shards are empty.                                                  *
+ *                                                                              *
  * Reader is an algorithm-agnostic class and can mask the details of            *
  * the data source (on disk or in memory), and it is flexible for               *
  * different gradient descent methods (e.g., SGD, mini-batch GD, and            *
@@ -84,33 +178,163 @@ namespace f2m {
  */
 
 typedef std::vector<std::string> StringList;
- 
+typedef std::vector<StringPiece> StringPieceList;
+
+/* Expand the input of Reader to a list of files. The input is one 
+   or more items separated by ',', and each item is a file, a 
+   directory (all the files in it, except the hidden ones), or a 
+   glob pattern (e.g., "/data/2016-10-17/part-*"). The files of a 
+   directory or a pattern are sorted by name. */
+
+void ListFiles(const std::string& input, StringList* files);
+
 class Reader {
  public:
   Reader(const std::string& filename,
          int num_samples,
-         bool in_memory = false);  /* Reader samples data from disk 
+         bool in_memory = false,   /* Reader samples data from disk 
                                       file in defualt.*/
+         int shard_id = 0,         /* Reader returns the lines in the */
+         int num_shards = 1);      /* shard_id-th of num_shards ranges */
   
-  ~Reader();
+  virtual ~Reader();
  
-  /* Return a pointer to N lines of data samples. */
+  /* Return a pointer to N lines of data samples. The last batch 
+     of an epoch may have less than N lines, and the next call 
+     starts a new epoch from the head of the file. */
 
   StringList* Samples();
 
- private:
+  /* Return a pointer to N views of data samples. In the in-memory
+     mode, the views point to the mapped file and no line is copied.
+     The last batch of an epoch may have less than N views. */
+
+  StringPieceList* SampleViews();
+
+  /* Read the next line and return true. At the end of the file 
+     (or the shard), return false, and the next call will start from 
+     the head of the file again. The line is valid until the next 
+     call. */
+
+  virtual bool ReadLine(StringPiece* line);
+
+  /* Return the lines in a random order in each epoch, which is only
+     supported in the in-memory mode. Reader shuffles the blocks of 
+     block_size lines, and then the lines inside each block. The 
+     current epoch starts again in the new order. */
+
+  virtual void EnableShuffle(uint64 block_size = 1, uint64 seed = 0);
+
+  /* The number of finished passes over the file (or the shard). */
+
+  int epoch() const { return epoch_; }
+
+  /* The length of the longest line read so far (without '\n'), 
+     which can be used to estimate the memory of a batch. */
+
+  uint64 max_line_length() const { return max_line_length_; }
+
+ protected:
   std::string filename_;        /* identify the input file */
   int num_samples_;             /* how many data samples return to user */
   bool in_memory_;              /* whether load all data into memory */
 
-  FILE* file_ptr_;              /* maintain current file pointer */
-  char* memory_buffer_;         /* in-memory buffer */
+  FILE* file_ptr_;              /* the file, only used (and closed)
+                                   in the constructor */
+  char* memory_buffer_;         /* in-memory buffer (mapped file, or
+                                   the data of the files in heap) */
+  bool mapped_;                 /* whether memory_buffer_ is mapped */
   uint64 size_memory_buffer_;   /* the size of memory buffer */
+  uint64 size_memory_mapping_;  /* the size of the whole mapping */
   
   StringList* data_samples_;    /* current data samples */
+  StringPieceList* data_views_; /* views of current data samples */
+
+  /* The read state belongs to each Reader, so that many Readers 
+     (e.g., one for each thread) can work at the same time. */
+
+  scoped_array<char> line_buffer_; /* buffer of one line from disk,
+                                      which grows for long lines */
+  uint64 shard_begin_;             /* byte range [begin, end) of the */
+  uint64 shard_end_;               /* shard read by this Reader */
+  uint64 cursor_;                  /* position of the next line */
+  int epoch_;                      /* number of finished epochs */
+  uint64 size_line_buffer_;        /* the size of line_buffer_ */
+  uint64 max_line_length_;         /* the longest line read so far */
 
+  /* A byte range of a file read by this Reader, which is a shard 
+     of a plain file, or a whole file. */
+
+  struct FileRange {
+    std::string filename;
+    Codec codec;
+    uint64 begin;
+    uint64 end;   /* kEndOfFile for a compressed file */
+  };
+
+  std::vector<FileRange> ranges_;  /* in the order of reading */
+
+  /* The state of the disk mode, which reads the blocks of the 
+     ranges one by one from a background thread. */
+
+  size_t next_range_;              /* the range after stream_ */
+  scoped_ptr<BlockStream> stream_; /* reads blocks in background */
+  StringPiece block_;              /* current block of stream_ */
+  uint64 block_pos_;               /* position of the next line */
+  bool end_of_stream_;             /* whether stream_ has no block */
+
+  /* The state of shuffling in the in-memory mode. */
+
+  bool shuffle_;                     /* whether to shuffle lines */
+  uint64 shuffle_block_size_;        /* number of lines in a block */
+  uint64 random_state_;              /* state of the random generator */
+  std::vector<uint64> line_offsets_; /* start of every line, and the end */
+  std::vector<uint64> block_order_;  /* blocks in random order */
+  std::vector<uint64> line_order_;   /* lines of the current block */
+  uint64 next_block_;                /* next block in block_order_ */
+  uint64 next_line_;                 /* next line in line_order_ */
+
+  bool AtEnd() const {
+    if (shuffle_) {
+      return next_line_ >= line_order_.size() &&
+             next_block_ >= block_order_.size();
+    }
+    return in_memory_ ? cursor_ >= shard_end_ : end_of_stream_;
+  }
+  void Rewind();
+
+  void UpdateMaxLineLength(uint64 length) {
+    if (length > max_line_length_) {
+      max_line_length_ = length;
+    }
+  }
+
+ private:
   StringList* SampleFromDisk();
-  StringList* SampleFromMemory();
+  StringPieceList* SampleFromMemory();
+
+  bool ReadLineFromDisk(StringPiece* line);
+  bool ReadLineFromMemory(StringPiece* line);
+  bool ReadShuffledLine(StringPiece* line);
+
+  void ShuffleBlocks();
+  void ShuffleLinesInBlock(uint64 block);
+  uint64 NextRandom(uint64 bound);
+
+  void SetShardRange(int shard_id, int num_shards);
+  uint64 FindLineStart(uint64 position);
+
+  void OpenOneFile(int shard_id, int num_shards);
+  void AssignFiles(const StringList& files,
+                   int shard_id, int num_shards);
+
+  void MapFileIntoMemory();
+  void ReadIntoMemory();
+  void UnmapFile();
+
+  void NextRange();
+  void NextStreamBlock();
+  void ReserveLineBuffer(uint64 size);
  
   DISALLOW_COPY_AND_ASSIGN(Reader);
 };
@@ -19,6 +19,127 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
 Copyright (c) 2016 by contributors.
 Author: Chao Ma (mctt90@gmail.com)
 
-This files defines Parser class, which parse the Reader's 
-output to a DMatrix.
-*/
\ No newline at end of file
+This files defines SignalQueue class, which is a bounded blocking 
+queue used to pass data between threads.
+*/
+
+#ifndef F2M_READER_SIGNAL_QUEUE_H_
+#define F2M_READER_SIGNAL_QUEUE_H_
+
+#include <vector>
+
+#include "src/common/common.h"
+
+namespace f2m {
+
+/* -----------------------------------------------------------------------------
+ * SignalQueue is a bounded FIFO queue which can be shared by multiple          *
+ * producer threads and multiple consumer threads:                              *
+ *                                                                              *
+ *   SignalQueue<Chunk*> queue(16);                                             *
+ *                                                                              *
+ *   // producer thread                                                         *
+ *   queue.Push(chunk);     // block if the queue is full                       *
+ *   ...                                                                        *
+ *   queue.Close();         // no more items                                    *
+ *                                                                              *
+ *   // consumer thread                                                         *
+ *   while (queue.Pop(&chunk)) {   // block if the queue is empty               *
+ *     ... use the chunk                                                        *
+ *   }                                                                          *
+ *                                                                              *
+ * Push() blocks when the queue is full, which gives the producers a            *
+ * backpressure when the consumers are slow, and thus the memory is bounded.    *
+ * Close() wakes up all the blocked threads: Push() returns false at once and   *
+ * Pop() returns false when all the remaining items have been popped.           *
+ *                                                                              *
+ * SignalQueue uses a Mutex and two ConditionVariables. The items should be     *
+ * coarse-grained (e.g., a pointer to a chunk of lines or a parsed batch), so   *
+ * that the lock is taken once for thousands of rows and the contention is      *
+ * negligible compared with a lock-free queue.                                  *
+ * -----------------------------------------------------------------------------
+ */
+
+template <typename T>
+class SignalQueue {
+ public:
+  explicit SignalQueue(int capacity)
+    : buffer_(capacity), 
+      capacity_(capacity),
+      head_(0), 
+      size_(0), 
+      closed_(false) {
+    CHECK_GT(capacity_, 0);
+  }
+
+  ~SignalQueue() {}
+
+  /* Push an item to the tail of the queue. Block if the queue is
+     full. Return false if the queue has been closed. */
+
+  bool Push(const T& item) {
+    MutexLocker locker(&mutex_);
+    while (size_ == capacity_ && !closed_) {
+      not_full_.Wait(&mutex_);
+    }
+    if (closed_) {
+      return false;
+    }
+    buffer_[(head_ + size_) % capacity_] = item;
+    ++size_;
+    not_empty_.Signal();
+    return true;
+  }
+
+  /* Pop an item from the head of the queue. Block if the queue is
+     empty. Return false if the queue has been closed and empty. */
+
+  bool Pop(T* item) {
+    MutexLocker locker(&mutex_);
+    while (size_ == 0 && !closed_) {
+      not_empty_.Wait(&mutex_);
+    }
+    if (size_ == 0) {
+      return false;
+    }
+    *item = buffer_[head_];
+    head_ = (head_ + 1) % capacity_;
+    --size_;
+    not_full_.Signal();
+    return true;
+  }
+
+  /* Wake up all the blocked threads and reject all the 
+     following Push(). */
+
+  void Close() {
+    MutexLocker locker(&mutex_);
+    closed_ = true;
+    not_full_.Broadcast();
+    not_empty_.Broadcast();
+  }
+
+  /* Return the number of items in the queue. */
+
+  int Size() {
+    MutexLocker locker(&mutex_);
+    return size_;
+  }
+
+ private:
+  std::vector<T> buffer_;          /* ring buffer */
+  int capacity_;                   /* max number of items */
+  int head_;                       /* position of the first item */
+  int size_;                       /* current number of items */
+  bool closed_;                    /* whether Close() has been called */
+
+  Mutex mutex_;
+  ConditionVariable not_full_;     /* signaled after Pop() */
+  ConditionVariable not_empty_;    /* signaled after Push() */
+
+  DISALLOW_COPY_AND_ASSIGN(SignalQueue);
+};
+
+} // namespace f2m
+
+#endif // F2M_READER_SIGNAL_QUEUE_H_
@@ -0,0 +1,97 @@
+/*
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or (at
+your option) any later version.
+
+This program is distributed in the hope that it will be useful, but
+WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+02110-1301, USA.
+*/
+
+/* 
+Copyright (c) 2016 by contributors.
+Author: Chao Ma (mctt90@gmail.com)
+
+This tool converts a text data file (libsvm or libffm format) to 
+the binary format defined in binary_reader.h. Usage:
+
+  text_to_binary input_file output_file [--ffm] [--field16] [--delta]
+
+  --ffm      the input file is in libffm format.
+  --field16  store the fields as uint16 (only for --ffm).
+  --delta    store the delta-encoded indices.
+*/
+
+#include <string.h>
+
+#include <string>
+
+#include "src/common/common.h"
+#include "src/common/data_structure.h"
+#include "src/reader/binary_reader.h"
+#include "src/reader/parser.h"
+#include "src/reader/reader.h"
+
+using namespace f2m;
+
+const int kNumLinesPerBatch = 10000;
+
+int main(int argc, char* argv[]) {
+  if (argc < 3) {
+    fprintf(stderr, "Usage: %s input_file output_file "
+                    "[--ffm] [--field16] [--delta]\n", argv[0]);
+    return 1;
+  }
+  uint32 flags = 0;
+  for (int i = 3; i < argc; ++i) {
+    if (strcmp(argv[i], "--ffm") == 0) {
+      flags |= kBinaryField;
+    } else if (strcmp(argv[i], "--field16") == 0) {
+      flags |= kBinaryField16;
+    } else if (strcmp(argv[i], "--delta") == 0) {
+      flags |= kBinaryDelta;
+    } else {
+      fprintf(stderr, "Unknown option: %s\n", argv[i]);
+      return 1;
+    }
+  }
+  if ((flags & kBinaryField16) && !(flags & kBinaryField)) {
+    fprintf(stderr, "--field16 can only be used with --ffm\n");
+    return 1;
+  }
+
+  Reader reader(argv[1], 1);
+  scoped_ptr<Parser> parser(flags & kBinaryField ? new FFMParser 
+                                                 : new Parser);
+  BinaryWriter writer(argv[2], flags);
+  StringList lines;
+  DataMatrix matrix(kNumLinesPerBatch);
+  uint64 num_rows = 0;
+  // Read the file once, kNumLinesPerBatch lines in each batch.
+  bool end_of_file = false;
+  while (!end_of_file) {
+    lines.clear();
+    StringPiece line;
+    while (lines.size() < kNumLinesPerBatch) {
+      if (!reader.ReadLine(&line)) {
+        end_of_file = true;
+        break;
+      }
+      lines.push_back(line.ToString());
+    }
+    parser->Parse(&lines, &matrix);
+    writer.Write(matrix);
+    num_rows += matrix.size();
+  }
+  writer.Close();
+  LOG(INFO) << "Converted " << num_rows << " rows from " << argv[1]
+            << " to " << argv[2];
+  return 0;
+}
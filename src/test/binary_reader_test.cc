@@ -0,0 +1,145 @@
+/*
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or (at
+your option) any later version.
+
+This program is distributed in the hope that it will be useful, but
+WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+02110-1301, USA.
+*/
+/*
+Copyright (c) 2016 by contributors.
+Author: Chao Ma (mctt90@gmail.com)
+
+Unit Test for BinaryReader (binary_reader.h and binary_reader.cc)
+We write a matrix to a binary file with each combination of flags,
+then check the matrix read back by BinaryReader and BinaryParser.
+*/
+
+#include "gtest/gtest.h"
+
+#include "src/reader/binary_reader.h"
+#include "src/reader/pipeline.h"
+#include "src/common/common.h"
+#include "src/common/data_structure.h"
+
+#include <string>
+#include <vector>
+
+using f2m::BinaryParser;
+using f2m::BinaryReader;
+using f2m::BinaryWriter;
+using f2m::DataMatrix;
+using f2m::Pipeline;
+using f2m::SparseRow;
+using f2m::StringPieceList;
+
+const std::string filename = "/tmp/binary-reader-test.bin";
+
+const int num_line = 100;
+const int num_samples = 10;
+
+// Row i has (i % 5) + 1 nodes, with indices going up and down.
+void BuildMatrix(DataMatrix* matrix, bool has_field) {
+  matrix->Clear();
+  for (int i = 0; i < num_line; ++i) {
+    for (int n = 0; n <= i % 5; ++n) {
+      uint32 index = (n % 2 == 0) ? i * 1000 + n : i + n;
+      f2m::real_t value = 0.5 * n + i;
+      if (has_field) {
+        matrix->AddNode(index, value, i + n);
+      } else {
+        matrix->AddNode(index, value);
+      }
+    }
+    matrix->EndRow(i % 2);
+  }
+}
+
+void CheckRow(const SparseRow& expected, const SparseRow& actual, 
+              bool has_field) {
+  EXPECT_EQ(expected.y, actual.y);
+  ASSERT_EQ(expected.size, actual.size);
+  for (uint32 n = 0; n < expected.size; ++n) {
+    EXPECT_EQ(expected.x[n], actual.x[n]);
+    EXPECT_EQ(expected.position[n], actual.position[n]);
+    if (has_field) {
+      EXPECT_EQ(expected.field[n], actual.field[n]);
+    }
+  }
+}
+
+void CheckRoundTrip(uint32 flags) {
+  bool has_field = (flags & f2m::kBinaryField) != 0;
+  DataMatrix expected;
+  BuildMatrix(&expected, has_field);
+  BinaryWriter writer(filename, flags);
+  writer.Write(expected);
+  writer.Close();
+
+  BinaryReader reader(filename, num_samples);
+  EXPECT_EQ(reader.flags(), flags);
+  EXPECT_EQ(reader.num_rows(), num_line);
+  EXPECT_EQ(reader.num_features(), (num_line - 1) * 1000 + 5);
+  EXPECT_EQ(reader.num_fields(), has_field ? num_line + 4 : 0);
+  BinaryParser parser(reader.flags());
+  DataMatrix matrix;
+  // Read the file twice.
+  for (int k = 0; k < 2 * num_line / num_samples; ++k) {
+    StringPieceList* views = reader.SampleViews();
+    parser.Parse(views, &matrix);
+    ASSERT_EQ(matrix.size(), num_samples);
+    for (int i = 0; i < num_samples; ++i) {
+      int row = (k * num_samples + i) % num_line;
+      CheckRow(expected[row], matrix[i], has_field);
+    }
+  }
+}
+
+TEST(BinaryReaderTest, RoundTrip) {
+  CheckRoundTrip(0);
+  CheckRoundTrip(f2m::kBinaryDelta);
+}
+
+TEST(BinaryReaderTest, RoundTripWithField) {
+  CheckRoundTrip(f2m::kBinaryField);
+  CheckRoundTrip(f2m::kBinaryField | f2m::kBinaryField16);
+  CheckRoundTrip(f2m::kBinaryField | f2m::kBinaryDelta);
+  CheckRoundTrip(f2m::kBinaryField | f2m::kBinaryField16 | 
+                 f2m::kBinaryDelta);
+}
+
+TEST(BinaryReaderTest, Pipeline) {
+  DataMatrix expected;
+  BuildMatrix(&expected, true);
+  uint32 flags = f2m::kBinaryField | f2m::kBinaryDelta;
+  BinaryWriter writer(filename, flags);
+  writer.Write(expected);
+  writer.Close();
+
+  BinaryReader reader(filename, 1);
+  BinaryParser parser(flags);
+  Pipeline pipeline(&reader, &parser, 7, 2, 1, 2);
+  std::vector<int> count(num_line, 0);
+  DataMatrix* matrix = NULL;
+  while ((matrix = pipeline.NextBatch()) != NULL) {
+    for (int i = 0; i < matrix->size(); ++i) {
+      // The y and the first value identify the row.
+      int row = static_cast<int>((*matrix)[i].x[0]);
+      ASSERT_LT(row, num_line);
+      CheckRow(expected[row], (*matrix)[i], true);
+      count[row]++;
+    }
+    pipeline.Recycle(matrix);
+  }
+  for (int i = 0; i < num_line; ++i) {
+    EXPECT_EQ(count[i], 1);
+  }
+}
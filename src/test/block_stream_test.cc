@@ -0,0 +1,304 @@
+/*
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or (at
+your option) any later version.
+
+This program is distributed in the hope that it will be useful, but
+WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+02110-1301, USA.
+*/
+
+/*
+Copyright (c) 2016 by contributors.
+Author: Chao Ma (mctt90@gmail.com)
+
+Unit Test for BlockStream (block_stream.h and block_stream.cc)
+We compress some data to a file, then check the decompressed blocks.
+*/
+
+#include "gtest/gtest.h"
+
+#include "src/reader/block_stream.h"
+#include "src/common/common.h"
+
+#include <stdio.h>
+#include <zlib.h>
+#ifdef F2M_USE_ZSTD
+#include <zstd.h>
+#endif
+
+#include <string>
+#include <fstream>
+#include <iterator>
+#include <algorithm>
+
+using f2m::BlockStream;
+using f2m::Codec;
+
+const std::string filename = "/tmp/block-stream-test";
+
+/* Some text which is not too easy to compress. */
+
+std::string MakeData(int size) {
+  std::string data;
+  uint64 x = 1;
+  while (data.size() < size) {
+    x = x * 6364136223846793005ULL + 1442695040888963407ULL;
+    data += StringPrintf("%llu:%d\n", x >> 40, static_cast<int>(x % 100));
+  }
+  data.resize(size);
+  return data;
+}
+
+/* Write data to a gzip file as num_members members. */
+
+void WriteGzip(const std::string& name,
+               const std::string& data,
+               int num_members) {
+  remove(name.c_str());
+  size_t begin = 0;
+  for (int i = 0; i < num_members; ++i) {
+    size_t end = data.size() * (i + 1) / num_members;
+    // "a" appends a new member to the file.
+    gzFile file = gzopen(name.c_str(), "ab");
+    ASSERT_TRUE(file != NULL);
+    if (end > begin) {
+      EXPECT_EQ(gzwrite(file, data.data() + begin, end - begin),
+                end - begin);
+    }
+    gzclose(file);
+    begin = end;
+  }
+}
+
+void WriteFile(const std::string& name, const std::string& data) {
+  std::ofstream file(name.c_str(), std::ios::binary);
+  file << data;
+}
+
+std::string ReadFile(const std::string& name) {
+  std::ifstream file(name.c_str(), std::ios::binary);
+  return std::string(std::istreambuf_iterator<char>(file),
+                     std::istreambuf_iterator<char>());
+}
+
+/* Read all the blocks, and check that only the last block
+   is smaller than block_size. */
+
+std::string ReadAll(BlockStream* stream, uint64 block_size) {
+  std::string data;
+  StringPiece block;
+  bool last = false;
+  while (stream->NextBlock(&block)) {
+    EXPECT_FALSE(last);
+    EXPECT_GT(block.size(), 0);
+    EXPECT_LE(block.size(), block_size);
+    last = block.size() < block_size;
+    data.append(block.data(), block.size());
+  }
+  // The end of the stream is sticky.
+  EXPECT_FALSE(stream->NextBlock(&block));
+  return data;
+}
+
+Codec DetectFile(const std::string& name) {
+  FILE* file = fopen(name.c_str(), "r");
+  Codec codec = f2m::DetectCodec(file);
+  // The file returns to the head.
+  EXPECT_EQ(ftell(file), 0);
+  fclose(file);
+  return codec;
+}
+
+TEST(BlockStreamTest, DetectCodec) {
+  WriteFile(filename, "");
+  EXPECT_EQ(DetectFile(filename), f2m::kCodecNone);
+  WriteFile(filename, "\x1f");
+  EXPECT_EQ(DetectFile(filename), f2m::kCodecNone);
+  WriteFile(filename, "1:2 0\n");
+  EXPECT_EQ(DetectFile(filename), f2m::kCodecNone);
+  WriteFile(filename, "\x28\xb5\x2f\xfd");
+  EXPECT_EQ(DetectFile(filename), f2m::kCodecZstd);
+  WriteGzip(filename, "1:2 0\n", 1);
+  EXPECT_EQ(DetectFile(filename), f2m::kCodecGzip);
+}
+
+TEST(BlockStreamTest, PlainFile) {
+  std::string data = MakeData(100000);
+  WriteFile(filename, data);
+  BlockStream stream(filename, f2m::kCodecNone, 4096, 2);
+  EXPECT_EQ(ReadAll(&stream, 4096), data);
+}
+
+TEST(BlockStreamTest, PlainRange) {
+  std::string data = MakeData(100000);
+  WriteFile(filename, data);
+  const uint64 ranges[][2] = { { 0, 100000 }, { 0, f2m::kEndOfFile },
+                               { 777, 54321 }, { 99999, f2m::kEndOfFile },
+                               { 5000, 5000 }, { 200000, f2m::kEndOfFile } };
+  for (int i = 0; i < 6; ++i) {
+    uint64 begin = ranges[i][0];
+    uint64 end = std::min(ranges[i][1], static_cast<uint64>(data.size()));
+    std::string expected = begin < end ? data.substr(begin, end - begin)
+                                       : std::string();
+    BlockStream stream(filename, f2m::kCodecNone, 1000, 2,
+                       ranges[i][0], ranges[i][1]);
+    EXPECT_EQ(ReadAll(&stream, 1000), expected);
+    stream.Restart();
+    EXPECT_EQ(ReadAll(&stream, 1000), expected);
+  }
+}
+
+// Block sizes which do not divide the data, and one block in the ring.
+TEST(BlockStreamTest, GzipRoundTrip) {
+  std::string data = MakeData(3 * 1024 * 1024 + 17);
+  const int block_sizes[] = { 1000, 65536, 4 * 1024 * 1024 };
+  for (int num_members = 1; num_members <= 3; ++num_members) {
+    WriteGzip(filename, data, num_members);
+    for (int i = 0; i < 3; ++i) {
+      for (int num_blocks = 1; num_blocks <= 4; num_blocks += 3) {
+        BlockStream stream(filename, f2m::kCodecGzip,
+                           block_sizes[i], num_blocks);
+        EXPECT_EQ(ReadAll(&stream, block_sizes[i]), data);
+      }
+    }
+  }
+}
+
+// Members end in the middle of the tiny blocks.
+TEST(BlockStreamTest, GzipTinyBlocks) {
+  std::string data = MakeData(20000);
+  WriteGzip(filename, data, 3);
+  for (int block_size = 1; block_size <= 7; block_size += 3) {
+    BlockStream stream(filename, f2m::kCodecGzip, block_size, 2);
+    EXPECT_EQ(ReadAll(&stream, block_size), data);
+  }
+}
+
+TEST(BlockStreamTest, GzipWithEmptyMember) {
+  WriteGzip(filename, "", 1);
+  BlockStream stream(filename, f2m::kCodecGzip, 1024, 2);
+  EXPECT_EQ(ReadAll(&stream, 1024), std::string());
+  std::string data = MakeData(5000);
+  WriteGzip(filename, data, 1);
+  WriteGzip(filename + ".empty", "", 1);
+  WriteFile(filename, ReadFile(filename) + ReadFile(filename + ".empty"));
+  BlockStream stream2(filename, f2m::kCodecGzip, 1024, 2);
+  EXPECT_EQ(ReadAll(&stream2, 1024), data);
+}
+
+TEST(BlockStreamTest, Restart) {
+  std::string data = MakeData(200000);
+  WriteGzip(filename, data, 2);
+  BlockStream stream(filename, f2m::kCodecGzip, 1000, 3);
+  StringPiece block;
+  // Restart in the middle of the file, and at the end.
+  ASSERT_TRUE(stream.NextBlock(&block));
+  ASSERT_TRUE(stream.NextBlock(&block));
+  stream.Restart();
+  EXPECT_EQ(ReadAll(&stream, 1000), data);
+  stream.Restart();
+  EXPECT_EQ(ReadAll(&stream, 1000), data);
+}
+
+TEST(BlockStreamTest, DestroyBeforeEnd) {
+  std::string data = MakeData(1000000);
+  WriteGzip(filename, data, 1);
+  BlockStream stream(filename, f2m::kCodecGzip, 1000, 2);
+  StringPiece block;
+  ASSERT_TRUE(stream.NextBlock(&block));
+  EXPECT_EQ(block.ToString(), data.substr(0, 1000));
+  // The destructor stops the blocked thread.
+}
+
+TEST(BlockStreamDeathTest, TruncatedGzip) {
+  std::string data = MakeData(100000);
+  WriteGzip(filename, data, 1);
+  std::string compressed = ReadFile(filename);
+  WriteFile(filename, compressed.substr(0, compressed.size() / 2));
+  EXPECT_DEATH({
+    BlockStream stream(filename, f2m::kCodecGzip, 1000, 2);
+    ReadAll(&stream, 1000);
+  }, "Truncated gzip file");
+  // The 8-byte trailer (CRC and size) is missing.
+  WriteFile(filename, compressed.substr(0, compressed.size() - 8));
+  EXPECT_DEATH({
+    BlockStream stream(filename, f2m::kCodecGzip, 1000, 2);
+    ReadAll(&stream, 1000);
+  }, "Truncated gzip file");
+}
+
+TEST(BlockStreamDeathTest, CorruptedGzip) {
+  std::string data = MakeData(100000);
+  WriteGzip(filename, data, 1);
+  std::string compressed = ReadFile(filename);
+  for (size_t i = 20; i < compressed.size(); i += 7) {
+    compressed[i] ^= 0x55;
+  }
+  WriteFile(filename, compressed);
+  EXPECT_DEATH({
+    BlockStream stream(filename, f2m::kCodecGzip, 1000, 2);
+    ReadAll(&stream, 1000);
+  }, "Corrupted gzip file");
+}
+
+#ifdef F2M_USE_ZSTD
+
+/* Write data to a zstd file as num_frames frames. */
+
+void WriteZstd(const std::string& name,
+               const std::string& data,
+               int num_frames) {
+  std::string compressed;
+  size_t begin = 0;
+  for (int i = 0; i < num_frames; ++i) {
+    size_t end = data.size() * (i + 1) / num_frames;
+    std::string frame(ZSTD_compressBound(end - begin), '\0');
+    size_t size = ZSTD_compress(&frame[0], frame.size(),
+                                data.data() + begin, end - begin, 1);
+    ASSERT_FALSE(ZSTD_isError(size));
+    compressed.append(frame.data(), size);
+    begin = end;
+  }
+  WriteFile(name, compressed);
+}
+
+TEST(BlockStreamTest, ZstdRoundTrip) {
+  std::string data = MakeData(3 * 1024 * 1024 + 17);
+  for (int num_frames = 1; num_frames <= 3; ++num_frames) {
+    WriteZstd(filename, data, num_frames);
+    EXPECT_EQ(DetectFile(filename), f2m::kCodecZstd);
+    BlockStream stream(filename, f2m::kCodecZstd, 65536, 4);
+    EXPECT_EQ(ReadAll(&stream, 65536), data);
+    stream.Restart();
+    EXPECT_EQ(ReadAll(&stream, 65536), data);
+  }
+}
+
+TEST(BlockStreamDeathTest, TruncatedZstd) {
+  std::string data = MakeData(100000);
+  WriteZstd(filename, data, 1);
+  std::string compressed = ReadFile(filename);
+  WriteFile(filename, compressed.substr(0, compressed.size() / 2));
+  EXPECT_DEATH({
+    BlockStream stream(filename, f2m::kCodecZstd, 1000, 2);
+    ReadAll(&stream, 1000);
+  }, "Truncated zstd file");
+}
+
+#else
+
+TEST(BlockStreamDeathTest, ZstdNotBuilt) {
+  WriteFile(filename, "\x28\xb5\x2f\xfd");
+  EXPECT_DEATH(BlockStream(filename, f2m::kCodecZstd, 1000, 2),
+               "built without libzstd");
+}
+
+#endif
@@ -0,0 +1,56 @@
+/*
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or (at
+your option) any later version.
+
+This program is distributed in the hope that it will be useful, but
+WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+02110-1301, USA.
+*/
+
+/*
+Copyright (c) 2016 by contributors.
+Author: Chao Ma (mctt90@gmail.com)
+
+Unit Test for FastExp() and FastLog1p() (fast_math.h)
+*/
+
+#include "gtest/gtest.h"
+
+#include "src/common/fast_math.h"
+#include "src/common/common.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace f2m {
+
+TEST(FastMathTest, FastExp) {
+  for (double x = -80; x <= 80; x += 0.01) {
+    double exact = exp(x);
+    double error = 3e-7 * std::max(1.0, fabs(x)) * exact;
+    EXPECT_NEAR(FastExp(x), exact, error) << "x = " << x;
+  }
+  // Clamped, but never 0 or inf.
+  EXPECT_GT(FastExp(-1000), 0);
+  EXPECT_FALSE(std::isinf(FastExp(1000)));
+}
+
+TEST(FastMathTest, FastLog1p) {
+  for (double x = -0.99; x <= 1e6; x = x < 1 ? x + 1e-3 : x * 1.01) {
+    double exact = log1p(x);
+    EXPECT_NEAR(FastLog1p(x), exact, 1e-6 * fabs(exact)) << "x = " << x;
+  }
+  // Small x keeps its precision.
+  EXPECT_NEAR(FastLog1p(1e-7), 1e-7, 1e-13);
+  EXPECT_NEAR(FastLog1p(-3e-5), log1p(-3e-5), 3e-11);
+}
+
+} // namespace f2m
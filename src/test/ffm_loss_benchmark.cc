@@ -0,0 +1,154 @@
+/*
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or (at
+your option) any later version.
+
+This program is distributed in the hope that it will be useful, but
+WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+02110-1301, USA.
+*/
+
+/*
+Copyright (c) 2016 by contributors.
+Author: Chao Ma (mctt90@gmail.com)
+
+Micro-benchmark for FFMLoss (ffm_loss.h).
+We first measure the time of one call of the SIMD kernels (Dot and
+Axpy of size k) of every level supported by the CPU. Then we generate 
+some random rows in libffm format, and compare the rows/sec of 
+Predict() and CalcGrad() with the kernels of every level against the 
+scalar kernels, for both the default layout and the aligned layout 
+of Model.
+
+Usage: ffm_loss_benchmark [num_rows] [num_features_per_row] [k]
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/time.h>
+
+#include <vector>
+
+#include "src/common/common.h"
+#include "src/common/data_structure.h"
+#include "src/common/simd.h"
+#include "src/loss/ffm_loss.h"
+
+using f2m::DataMatrix;
+using f2m::FFMLoss;
+using f2m::Model;
+using f2m::SIMDLevel;
+using f2m::SparseGrad;
+using f2m::real_t;
+
+namespace {
+
+const f2m::index_t kNumFeatures = 100000;
+const int kNumFields = 20;
+
+double GetTime() {
+  struct timeval tv;
+  gettimeofday(&tv, NULL);
+  return tv.tv_sec + tv.tv_usec * 1e-6;
+}
+
+/* Print the nanoseconds of one call of Dot() and Axpy(). */
+
+void BenchmarkKernels(int k) {
+  const int num_vectors = 4096;
+  const int repeat = 1000;
+  std::vector<real_t> a(num_vectors * k, 0.5), b(num_vectors * k, 0.25);
+  printf("SIMD kernels (k = %d):\n", k);
+  for (int level = f2m::kScalar; level <= f2m::DetectSIMDLevel(); 
+       ++level) {
+    const f2m::SIMDKernels& kernels = 
+        f2m::GetSIMDKernels(SIMDLevel(level));
+    real_t sum = 0;
+    double start = GetTime();
+    for (int r = 0; r < repeat; ++r) {
+      for (int i = 0; i < num_vectors; ++i) {
+        sum += kernels.Dot(&a[i * k], &b[(i * 7 % num_vectors) * k], k);
+      }
+    }
+    double dot = (GetTime() - start) / repeat / num_vectors * 1e9;
+    start = GetTime();
+    for (int r = 0; r < repeat; ++r) {
+      for (int i = 0; i < num_vectors; ++i) {
+        kernels.Axpy(1e-6, &a[i * k], &b[(i * 7 % num_vectors) * k], k);
+      }
+    }
+    double axpy = (GetTime() - start) / repeat / num_vectors * 1e9;
+    printf("  %-8s Dot %.2f ns, Axpy %.2f ns (%g)\n", 
+           kernels.name, dot, axpy, sum);
+  }
+}
+
+/* Generate num_rows random rows. */
+
+void GenerateData(int num_rows, int num_features, DataMatrix* matrix) {
+  srand(0);
+  matrix->Clear();
+  for (int i = 0; i < num_rows; ++i) {
+    for (int n = 0; n < num_features; ++n) {
+      matrix->AddNode(rand() % kNumFeatures, 1.0, n % kNumFields);
+    }
+    matrix->EndRow(rand() % 2);
+  }
+}
+
+/* Return the rows/sec of Predict() + CalcGrad(). */
+
+double Benchmark(SIMDLevel level, const DataMatrix& matrix, 
+                 const Model& model, int repeat) {
+  FFMLoss loss(level);
+  std::vector<real_t> pred;
+  SparseGrad grad;
+  // warm up
+  loss.CalcGrad(matrix, model, &grad);
+  double start = GetTime();
+  for (int i = 0; i < repeat; ++i) {
+    loss.Predict(matrix, model, &pred);
+    loss.CalcGrad(matrix, model, &grad);
+  }
+  return matrix.size() * repeat / (GetTime() - start);
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+  int num_rows = argc > 1 ? atoi(argv[1]) : 2000;
+  int num_features = argc > 2 ? atoi(argv[2]) : 40;
+  int k = argc > 3 ? atoi(argv[3]) : 16;
+  const int repeat = 3;
+
+  BenchmarkKernels(k);
+
+  DataMatrix matrix(num_rows);
+  GenerateData(num_rows, num_features, &matrix);
+
+  for (int aligned = 0; aligned < 2; ++aligned) {
+    Model model(0.1, f2m::FFM, kNumFeatures, k, kNumFields, 
+                false, aligned);
+    double scalar = Benchmark(f2m::kScalar, matrix, model, repeat);
+    printf("FFMLoss (%d rows x %d features, k = %d, %s layout):\n"
+           "  %-8s %.0f rows/sec\n", num_rows, num_features, k,
+           aligned ? "aligned" : "default", 
+           f2m::GetSIMDKernels(f2m::kScalar).name, scalar);
+    for (int level = f2m::kSSE; level <= f2m::DetectSIMDLevel(); 
+         ++level) {
+      double speed = Benchmark(SIMDLevel(level), matrix, model, repeat);
+      printf("  %-8s %.0f rows/sec, speedup %.2fx\n", 
+             f2m::GetSIMDKernels(SIMDLevel(level)).name, 
+             speed, speed / scalar);
+    }
+  }
+
+  return 0;
+}
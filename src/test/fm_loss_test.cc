@@ -0,0 +1,177 @@
+/*
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or (at
+your option) any later version.
+
+This program is distributed in the hope that it will be useful, but
+WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+02110-1301, USA.
+*/
+
+/*
+Copyright (c) 2016 by contributors.
+Author: Chao Ma (mctt90@gmail.com)
+
+Unit Test for FMLoss (fm_loss.h and fm_loss.cc)
+We check the prediction with a naive O(n^2 * k) implementation, and check 
+the gradients with the finite difference of the loss.
+*/
+
+#include "gtest/gtest.h"
+
+#include "src/loss/fm_loss.h"
+#include "src/common/common.h"
+#include "src/common/data_structure.h"
+#include "src/common/simd.h"
+
+#include <stdlib.h>
+#include <cmath>
+#include <vector>
+
+namespace f2m {
+
+const index_t feature_num = 50;
+const int k = 5;
+const int num_rows = 10;
+
+real_t Random() {
+  return rand() / static_cast<real_t>(RAND_MAX) - 0.5;
+}
+
+void InitModel(Model* model) {
+  srand(1);
+  for (index_t i = 0; i < feature_num; ++i) {
+    *model->MutableW(i) = Random();
+    real_t* v = model->MutableV(i);
+    for (int j = 0; j < k; ++j) {
+      v[j] = Random();
+    }
+  }
+}
+
+void InitMatrix(DataMatrix* matrix) {
+  srand(2);
+  matrix->Clear();
+  for (int r = 0; r < num_rows; ++r) {
+    for (int n = 0; n < 2 + r % 5; ++n) {
+      matrix->AddNode(rand() % feature_num, Random() + 1);
+    }
+    matrix->EndRow(r % 2);
+  }
+}
+
+/* The naive prediction of one row, in double. */
+
+double NaivePredict(const SparseRow& row, const Model& model) {
+  double pred = 0;
+  for (uint32 i = 0; i < row.size; ++i) {
+    pred += *model.W(row.position[i]) * row.x[i];
+    for (uint32 j = i + 1; j < row.size; ++j) {
+      const real_t* v_i = model.V(row.position[i]);
+      const real_t* v_j = model.V(row.position[j]);
+      for (int d = 0; d < k; ++d) {
+        pred += v_i[d] * v_j[d] * row.x[i] * row.x[j];
+      }
+    }
+  }
+  return pred;
+}
+
+double Loss(const DataMatrix& matrix, const Model& model) {
+  double loss = 0;
+  for (size_t r = 0; r < matrix.size(); ++r) {
+    double y = matrix[r].y > 0 ? 1 : -1;
+    loss += log(1 + exp(-y * NaivePredict(matrix[r], model)));
+  }
+  return loss;
+}
+
+void CheckPredict(bool aligned, SIMDLevel level) {
+  Model model(0, FM, feature_num, k, 0, false, aligned);
+  InitModel(&model);
+  DataMatrix matrix;
+  InitMatrix(&matrix);
+  FMLoss loss(level);
+  std::vector<real_t> pred;
+  loss.Predict(matrix, model, &pred);
+  ASSERT_EQ(pred.size(), num_rows);
+  for (int r = 0; r < num_rows; ++r) {
+    EXPECT_NEAR(pred[r], NaivePredict(matrix[r], model), 1e-5);
+  }
+}
+
+TEST(FMLossTest, Predict) {
+  for (int level = kScalar; level <= DetectSIMDLevel(); ++level) {
+    CheckPredict(false, SIMDLevel(level));
+    CheckPredict(true, SIMDLevel(level));
+  }
+}
+
+/* The sum of all the gradients of a parameter (a parameter can
+   appear many times in SparseGrad) is the derivative of the loss. */
+
+void CheckGrad(bool aligned, SIMDLevel level) {
+  Model model(0, FM, feature_num, k, 0, false, aligned);
+  InitModel(&model);
+  DataMatrix matrix;
+  InitMatrix(&matrix);
+  FMLoss loss(level);
+  SparseGrad grad;
+  loss.CalcGrad(matrix, model, &grad);
+  EXPECT_EQ(grad.size_k, model.GetPaddedK());
+  const double eps = 1e-3;
+  // Check w of the first features.
+  for (index_t i = 0; i < 10; ++i) {
+    double sum = 0;
+    for (size_t n = 0; n < grad.size_w(); ++n) {
+      if (grad.position_w[n] == i) {
+        sum += grad.grad_w[n];
+      }
+    }
+    real_t* w = model.MutableW(i);
+    real_t old = *w;
+    *w = old + eps;
+    double loss_plus = Loss(matrix, model);
+    *w = old - eps;
+    double loss_minus = Loss(matrix, model);
+    *w = old;
+    EXPECT_NEAR(sum, (loss_plus - loss_minus) / (2 * eps), 1e-2);
+  }
+  // Check v of the first features.
+  for (index_t i = 0; i < 10; ++i) {
+    double sum = 0;
+    for (size_t n = 0; n < grad.size_v(); ++n) {
+      if (grad.position_v[n] == i) {
+        sum += grad.GradV(n)[1];
+        // The gradient of the padding is zero.
+        for (int d = k; d < grad.size_k; ++d) {
+          EXPECT_EQ(grad.GradV(n)[d], 0);
+        }
+      }
+    }
+    real_t* v = model.MutableV(i) + 1;
+    real_t old = *v;
+    *v = old + eps;
+    double loss_plus = Loss(matrix, model);
+    *v = old - eps;
+    double loss_minus = Loss(matrix, model);
+    *v = old;
+    EXPECT_NEAR(sum, (loss_plus - loss_minus) / (2 * eps), 1e-2);
+  }
+}
+
+TEST(FMLossTest, CalcGrad) {
+  for (int level = kScalar; level <= DetectSIMDLevel(); ++level) {
+    CheckGrad(false, SIMDLevel(level));
+    CheckGrad(true, SIMDLevel(level));
+  }
+}
+
+} // namespace f2m
@@ -0,0 +1,244 @@
+/*
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or (at
+your option) any later version.
+
+This program is distributed in the hope that it will be useful, but
+WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+02110-1301, USA.
+*/
+
+/*
+Copyright (c) 2016 by contributors.
+Author: Chao Ma (mctt90@gmail.com)
+
+Micro-benchmark for the hash functions (common.h).
+We hash a vocabulary of feature strings with the 32-bit hash functions
+and with XXHash64, then compare the tokens/sec of every function and
+the number of collisions in the full range of the hash and in 2^20 and
+2^24 buckets, as HashFFMParser does with hash_bits = 20 and 24.
+
+The vocabulary is read from a file of one feature per line, e.g., the
+features of a real training log, which can be made by
+
+  tr '\t ' '\n\n' < train.txt | cut -d: -f2 | sort -u > vocabulary.txt
+
+Otherwise we generate the features in the style of Criteo logs, i.e.,
+13 numerical fields (I1=12) and 26 categorical fields (C1=68fd1e64).
+
+Usage: hash_benchmark [vocabulary_file]
+*/
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/time.h>
+
+#include <algorithm>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "src/common/common.h"
+
+namespace {
+
+double GetTime() {
+  struct timeval tv;
+  gettimeofday(&tv, NULL);
+  return tv.tv_sec + tv.tv_usec * 1e-6;
+}
+
+/* Read the distinct non-empty lines of a file. */
+
+void ReadVocabulary(const std::string& filename,
+                    std::vector<std::string>* vocabulary) {
+  std::ifstream file(filename.c_str());
+  CHECK(file.is_open());
+  std::string line;
+  while (std::getline(file, line)) {
+    if (!line.empty() && line[line.size() - 1] == '\r') {
+      line.resize(line.size() - 1);
+    }
+    if (!line.empty()) {
+      vocabulary->push_back(line);
+    }
+  }
+  std::sort(vocabulary->begin(), vocabulary->end());
+  vocabulary->erase(std::unique(vocabulary->begin(), vocabulary->end()),
+                    vocabulary->end());
+}
+
+/* Generate about num_features distinct features like Criteo. */
+
+void GenerateVocabulary(int num_features,
+                        std::vector<std::string>* vocabulary) {
+  srand(0);
+  for (int i = 0; i < num_features; ++i) {
+    int field = i % 39;
+    if (field < 13) {
+      // The counters have a long tail of small values.
+      int value = static_cast<int>(exp(rand() / (RAND_MAX + 1.0) * 12));
+      vocabulary->push_back(StringPrintf("I%d=%d", field + 1, value));
+    } else {
+      vocabulary->push_back(StringPrintf("C%d=%08x", field - 12,
+                                         rand() ^ (rand() << 16)));
+    }
+  }
+  std::sort(vocabulary->begin(), vocabulary->end());
+  vocabulary->erase(std::unique(vocabulary->begin(), vocabulary->end()),
+                    vocabulary->end());
+}
+
+/* The number of colliding features, i.e., features minus the distinct
+   hashes, of the hashes masked to num_bits bits (64 for no mask). */
+
+uint64 CountCollisions(const std::vector<uint64>& hashes, int num_bits) {
+  uint64 mask = num_bits >= 64 ? ~0ULL : (1ULL << num_bits) - 1;
+  std::vector<uint64> masked(hashes.size());
+  for (size_t i = 0; i < hashes.size(); ++i) {
+    masked[i] = hashes[i] & mask;
+  }
+  std::sort(masked.begin(), masked.end());
+  return masked.end() - std::unique(masked.begin(), masked.end());
+}
+
+/* The expected number of colliding features of a random hash,
+   which is n minus the expected number of non-empty buckets. */
+
+double ExpectedCollisions(uint64 n, int num_bits) {
+  double m = pow(2.0, num_bits);
+  return n - m * -expm1(n * log1p(-1.0 / m));
+}
+
+struct Result {
+  std::string name;
+  int num_bits;                 /* width of the hash */
+  double tokens_per_sec;
+  std::vector<uint64> hashes;
+};
+
+/* Hash the vocabulary by a 32-bit HashFunction of std::string. */
+
+void RunHashFunction(const std::string& name, HashFunction hash,
+                     const std::vector<std::string>& vocabulary,
+                     int repeat, Result* result) {
+  result->name = name;
+  result->num_bits = 32;
+  result->hashes.resize(vocabulary.size());
+  double start = GetTime();
+  for (int r = 0; r < repeat; ++r) {
+    for (size_t i = 0; i < vocabulary.size(); ++i) {
+      result->hashes[i] = hash(vocabulary[i]);
+    }
+  }
+  result->tokens_per_sec = vocabulary.size() * repeat / (GetTime() - start);
+}
+
+void RunBKDRHashOfPointer(const std::vector<StringPiece>& tokens,
+                          int repeat, Result* result) {
+  result->name = "BKDRHash(ptr,len)";
+  result->num_bits = 32;
+  result->hashes.resize(tokens.size());
+  double start = GetTime();
+  for (int r = 0; r < repeat; ++r) {
+    for (size_t i = 0; i < tokens.size(); ++i) {
+      result->hashes[i] = BKDRHash(tokens[i].data(), tokens[i].size());
+    }
+  }
+  result->tokens_per_sec = tokens.size() * repeat / (GetTime() - start);
+}
+
+void RunXXHash64(const std::vector<StringPiece>& tokens,
+                 int repeat, Result* result) {
+  result->name = "XXHash64";
+  result->num_bits = 64;
+  result->hashes.resize(tokens.size());
+  double start = GetTime();
+  for (int r = 0; r < repeat; ++r) {
+    for (size_t i = 0; i < tokens.size(); ++i) {
+      result->hashes[i] = XXHash64(tokens[i].data(), tokens[i].size());
+    }
+  }
+  result->tokens_per_sec = tokens.size() * repeat / (GetTime() - start);
+}
+
+void RunXXHash64Batch(const std::vector<StringPiece>& tokens,
+                      int repeat, Result* result) {
+  result->name = "XXHash64Batch";
+  result->num_bits = 64;
+  result->hashes.resize(tokens.size());
+  double start = GetTime();
+  for (int r = 0; r < repeat; ++r) {
+    XXHash64Batch(tokens.data(), tokens.size(), 0, result->hashes.data());
+  }
+  result->tokens_per_sec = tokens.size() * repeat / (GetTime() - start);
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+  std::vector<std::string> vocabulary;
+  if (argc > 1) {
+    ReadVocabulary(argv[1], &vocabulary);
+  } else {
+    GenerateVocabulary(2000000, &vocabulary);
+  }
+  CHECK(!vocabulary.empty());
+  uint64 num_bytes = 0;
+  std::vector<StringPiece> tokens;
+  for (size_t i = 0; i < vocabulary.size(); ++i) {
+    num_bytes += vocabulary[i].size();
+    tokens.push_back(StringPiece(vocabulary[i]));
+  }
+  const uint64 n = vocabulary.size();
+  // Hash about 20M tokens with every function.
+  const int repeat = std::max(1, static_cast<int>(20000000 / n));
+  printf("%llu distinct features, %.1f bytes on average\n",
+         static_cast<unsigned long long>(n),
+         static_cast<double>(num_bytes) / n);
+
+  const char* names[] = { "RSHash", "JSHash", "PJWHash", "ELFHash",
+                          "BKDRHash", "SDBMHash", "DJBHash", "DEKHash",
+                          "BPHash", "FNVHash", "APHash" };
+  const HashFunction functions[] = { RSHash, JSHash, PJWHash, ELFHash,
+                                     BKDRHash, SDBMHash, DJBHash, DEKHash,
+                                     BPHash, FNVHash, APHash };
+  const int num_functions = sizeof(functions) / sizeof(functions[0]);
+  std::vector<Result> results(num_functions + 3);
+  for (int i = 0; i < num_functions; ++i) {
+    RunHashFunction(names[i], functions[i], vocabulary, repeat, 
+                    &results[i]);
+  }
+  RunBKDRHashOfPointer(tokens, repeat, &results[num_functions]);
+  RunXXHash64(tokens, repeat, &results[num_functions + 1]);
+  RunXXHash64Batch(tokens, repeat, &results[num_functions + 2]);
+
+  printf("%-18s %12s %10s %12s %12s %12s\n", "hash", "Mtokens/sec", 
+         "MB/sec", "collisions", "in 2^24", "in 2^20");
+  for (size_t i = 0; i < results.size(); ++i) {
+    const Result& result = results[i];
+    printf("%-18s %12.1f %10.1f %12llu %12llu %12llu\n",
+           result.name.c_str(), result.tokens_per_sec * 1e-6,
+           result.tokens_per_sec * num_bytes / n * 1e-6,
+           static_cast<unsigned long long>(
+               CountCollisions(result.hashes, result.num_bits)),
+           static_cast<unsigned long long>(
+               CountCollisions(result.hashes, 24)),
+           static_cast<unsigned long long>(
+               CountCollisions(result.hashes, 20)));
+  }
+  printf("%-18s %12s %10s %12.0f %12.0f %12.0f\n", "random 32-bit",
+         "", "", ExpectedCollisions(n, 32), ExpectedCollisions(n, 24),
+         ExpectedCollisions(n, 20));
+  printf("%-18s %12s %10s %12.0f\n", "random 64-bit", "", "", 
+         ExpectedCollisions(n, 64));
+  return 0;
+}
@@ -0,0 +1,102 @@
+/*
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or (at
+your option) any later version.
+
+This program is distributed in the hope that it will be useful, but
+WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+02110-1301, USA.
+*/
+
+/*
+Copyright (c) 2016 by contributors.
+Author: Chao Ma (mctt90@gmail.com)
+
+Unit Test for the hash functions (common.h and common.cc)
+We check XXHash64 with the values of the reference implementation, 
+and that the batch and the pointer versions give the same hashes.
+*/
+
+#include "gtest/gtest.h"
+
+#include "src/common/common.h"
+
+#include <string.h>
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+// Hashes of the reference implementation (xxhsum).
+TEST(HashTest, XXHash64ReferenceValues) {
+  EXPECT_EQ(XXHash64("", 0), 0xEF46DB3751D8E999ULL);
+  EXPECT_EQ(XXHash64("a", 1), 0xD24EC4F1A98C6E5BULL);
+  EXPECT_EQ(XXHash64("abc", 3), 0x44BC2CF5AD770999ULL);
+  const char* long_str = "Nobody inspects the spammish repetition";
+  EXPECT_EQ(XXHash64(long_str, strlen(long_str)), 0xFBCEA83C8A378BF1ULL);
+  // 42 bytes: four lanes of 32 bytes, one word and a tail of 2 bytes.
+  const char* lanes = "0123456789abcdef0123456789abcdef0123456789";
+  EXPECT_EQ(XXHash64(lanes, strlen(lanes)), 0xA76190C3ACF08A1CULL);
+  EXPECT_EQ(XXHash64("abc", 3, 2016), 0x1ED3F2767579E32DULL);
+}
+
+// The hash depends on the bytes, not on their alignment.
+TEST(HashTest, XXHash64Unaligned) {
+  std::string data(200, '\0');
+  for (int i = 0; i < data.size(); ++i) {
+    data[i] = static_cast<char>(i * 37 + 11);
+  }
+  for (int length = 0; length < 100; ++length) {
+    uint64 hash = XXHash64(data.data(), length);
+    for (int offset = 1; offset < 8; ++offset) {
+      std::string copy = std::string(offset, 'x') + data.substr(0, length);
+      EXPECT_EQ(XXHash64(copy.data() + offset, length), hash);
+    }
+  }
+}
+
+// Every length and seed gives a different hash.
+TEST(HashTest, XXHash64Seed) {
+  std::string data(100, 'a');
+  std::vector<uint64> hashes;
+  for (int length = 0; length < data.size(); ++length) {
+    for (uint64 seed = 0; seed < 10; ++seed) {
+      hashes.push_back(XXHash64(data.data(), length, seed));
+    }
+  }
+  std::sort(hashes.begin(), hashes.end());
+  EXPECT_TRUE(std::adjacent_find(hashes.begin(), hashes.end()) ==
+              hashes.end());
+}
+
+TEST(HashTest, XXHash64Batch) {
+  std::string data;
+  std::vector<StringPiece> tokens;
+  for (int i = 0; i < 1000; ++i) {
+    data += StringPrintf("%d:feature_%d", i % 26, i * i);
+  }
+  for (size_t begin = 0; begin < data.size(); begin += 7) {
+    tokens.push_back(StringPiece(data.data() + begin,
+                                 std::min(data.size() - begin, 
+                                          begin % 50)));
+  }
+  std::vector<uint64> hashes(tokens.size());
+  XXHash64Batch(tokens.data(), tokens.size(), 7, hashes.data());
+  for (int i = 0; i < tokens.size(); ++i) {
+    EXPECT_EQ(hashes[i], XXHash64(tokens[i].data(), tokens[i].size(), 7));
+  }
+  XXHash64Batch(NULL, 0, 7, NULL);
+}
+
+TEST(HashTest, BKDRHashOfPointer) {
+  const std::string str = "user=1234\xff\x80";
+  EXPECT_EQ(BKDRHash(str.data(), str.size()), BKDRHash(str));
+  EXPECT_NE(BKDRHash(str.data(), str.size(), 1), BKDRHash(str));
+}
@@ -0,0 +1,242 @@
+/*
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or (at
+your option) any later version.
+
+This program is distributed in the hope that it will be useful, but
+WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+02110-1301, USA.
+*/
+
+/*
+Copyright (c) 2016 by contributors.
+Author: Chao Ma (mctt90@gmail.com)
+
+Unit Test for HogwildTrainer (hogwild.h and hogwild.cc)
+We train FM and FFM models on a small separable data set with 
+different numbers of threads, and check the loss.
+*/
+
+#include "gtest/gtest.h"
+
+#include "src/train/hogwild.h"
+#include "src/updater/adagrad_updater.h"
+#include "src/updater/ftrl_updater.h"
+#include "src/updater/sgd_updater.h"
+#include "src/updater/updater.h"
+#include "src/common/common.h"
+#include "src/common/data_structure.h"
+
+#include <sched.h>
+#include <stdlib.h>
+#include <cmath>
+#include <string>
+#include <fstream>
+
+using f2m::FFM;
+using f2m::FM;
+using f2m::HogwildOptions;
+using f2m::HogwildTrainer;
+using f2m::Model;
+using f2m::ModelType;
+using f2m::real_t;
+using f2m::SGDUpdater;
+using f2m::AdaGradUpdater;
+using f2m::FTRLUpdater;
+using f2m::Updater;
+
+const std::string fm_file = "/tmp/hogwild-test.txt";
+const std::string ffm_file = "/tmp/hogwild-test-ffm.txt";
+
+const int num_line = 1000;
+const int field_num = 3;
+const int feature_num = 10 * field_num;
+const int k = 4;
+const int num_epochs = 20;
+
+class HogwildTest : public ::testing::Test {
+ protected:
+  virtual void SetUp() { // Write the data to temp files.
+    std::ofstream fm(fm_file.c_str());
+    std::ofstream ffm(ffm_file.c_str());
+    srand(1);
+    // Each field has 10 features, and the label is 1 iff 
+    // the feature of field 0 is even.
+    for (int i = 0; i < num_line; ++i) {
+      int label = 0;
+      for (int f = 0; f < field_num; ++f) {
+        int index = f * 10 + rand() % 10;
+        if (f == 0) {
+          label = index % 2 == 0;
+        }
+        fm << index << ":1 ";
+        ffm << f << ":" << index << ":1 ";
+      }
+      fm << label << "\n";
+      ffm << label << "\n";
+    }
+  }
+
+  void CheckTrain(ModelType type, int num_threads, bool in_memory) {
+    SGDUpdater updater(0.5);
+    CheckTrain(type, num_threads, in_memory, &updater);
+  }
+
+  void CheckTrain(ModelType type, int num_threads, bool in_memory,
+                  Updater* updater) {
+    const std::string& filename = type == FFM ? ffm_file : fm_file;
+    Model model(0, type, feature_num, k, type == FFM ? field_num : 0,
+                false, false, updater->num_state(), 
+                updater->need_step());
+    model.RandomizeV(0.1, 2016);
+    HogwildOptions options;
+    options.num_threads = num_threads;
+    options.batch_size = 10;
+    options.num_epochs = num_epochs;
+    options.in_memory = in_memory;
+    HogwildTrainer trainer(filename, &model, updater, options);
+    real_t initial_loss = trainer.Evaluate(filename);
+    EXPECT_NEAR(initial_loss, log(2.0), 0.05);
+    trainer.Train();
+    EXPECT_EQ(trainer.num_samples(), num_line * num_epochs);
+    EXPECT_GT(trainer.seconds(), 0);
+    EXPECT_LT(trainer.Evaluate(filename), 0.3);
+  }
+};
+
+TEST_F(HogwildTest, FM) {
+  for (int num_threads = 1; num_threads <= 4; ++num_threads) {
+    CheckTrain(FM, num_threads, false);
+    CheckTrain(FM, num_threads, true);
+  }
+}
+
+TEST_F(HogwildTest, FFM) {
+  for (int num_threads = 1; num_threads <= 4; ++num_threads) {
+    CheckTrain(FFM, num_threads, false);
+    CheckTrain(FFM, num_threads, true);
+  }
+}
+
+TEST_F(HogwildTest, Updaters) {
+  // A new updater for every new model.
+  for (int num_threads = 1; num_threads <= 4; num_threads *= 2) {
+    for (int type = 0; type < 2; ++type) {
+      ModelType model_type = type == 0 ? FM : FFM;
+      AdaGradUpdater adagrad(0.5);
+      CheckTrain(model_type, num_threads, false, &adagrad);
+      FTRLUpdater ftrl(0.5, 1.0, 0.01, 0);
+      CheckTrain(model_type, num_threads, false, &ftrl);
+    }
+  }
+}
+
+// The raw string features are hashed into 2^10 features.
+TEST(HogwildHashTest, StringFeatures) {
+  const std::string hash_file = "/tmp/hogwild-test-hash.txt";
+  std::ofstream file(hash_file.c_str());
+  srand(1);
+  for (int i = 0; i < num_line; ++i) {
+    int value = rand() % 10;
+    file << "0:city=" << (value % 2 ? "odd" : "even") << value << ":1 "
+         << "1:user=" << rand() % 10 << ":1 " << (value % 2 == 0) << "\n";
+  }
+  file.close();
+  const int hash_bits = 10;
+  SGDUpdater updater(0.5);
+  Model model(0, FFM, 1 << hash_bits, k, 2);
+  model.RandomizeV(0.1, 2016);
+  HogwildOptions options;
+  options.num_epochs = num_epochs;
+  options.hash_bits = hash_bits;
+  HogwildTrainer trainer(hash_file, &model, &updater, options);
+  EXPECT_NEAR(trainer.Evaluate(hash_file), log(2.0), 0.05);
+  trainer.Train();
+  EXPECT_LT(trainer.Evaluate(hash_file), 0.3);
+}
+
+/* An SGDUpdater which gives up the CPU in CatchUp(), so the other
+   threads touch the same feature in the middle of the catch-up. */
+
+class YieldingSGDUpdater : public SGDUpdater {
+ public:
+  YieldingSGDUpdater(real_t learning_rate, real_t l2)
+    : SGDUpdater(learning_rate, l2) {}
+
+ protected:
+  void CatchUp(f2m::index_t index, uint32 num_steps, Model* model) {
+    sched_yield();
+    SGDUpdater::CatchUp(index, num_steps, model);
+  }
+};
+
+// The features have x = 0, so the lazy L2 decay is the only update,
+// and after Flush() every parameter has decayed in every step, once.
+// Many threads touch the same features at the same time, and must not
+// apply the decay of a step twice.
+TEST(HogwildLazyL2Test, ManyThreads) {
+  const std::string zero_file = "/tmp/hogwild-test-zero.txt";
+  std::ofstream file(zero_file.c_str());
+  for (int i = 0; i < num_line; ++i) {
+    file << "0:0 1:0 2:0 " << i % 7 << ":0 " << (i % 2) << "\n";
+  }
+  file.close();
+  const real_t learning_rate = 0.1;
+  const real_t l2 = 0.01;
+  const int num_features = 7;
+  for (int num_threads = 1; num_threads <= 4; num_threads *= 4) {
+    YieldingSGDUpdater updater(learning_rate, l2);
+    Model model(0, FM, num_features, k, 0, false, false,
+                updater.num_state(), updater.need_step());
+    for (int i = 0; i < num_features; ++i) {
+      *model.MutableW(i) = 1.0;
+      for (int j = 0; j < k; ++j) {
+        model.MutableV(i, 0)[j] = 0.5;
+      }
+    }
+    HogwildOptions options;
+    options.num_threads = num_threads;
+    options.batch_size = 2;
+    options.num_epochs = 5;
+    HogwildTrainer trainer(zero_file, &model, &updater, options);
+    trainer.Train();
+    // The same decay per step as the single-threaded lazy path.
+    double decay = pow(1 - learning_rate * l2, 
+                       static_cast<double>(updater.step()));
+    for (int i = 0; i < num_features; ++i) {
+      EXPECT_EQ(model.LastStep(i), updater.step());
+      EXPECT_NEAR(*model.MutableW(i), decay, decay * 1e-3) 
+          << num_threads << " threads, feature " << i;
+      for (int j = 0; j < k; ++j) {
+        EXPECT_NEAR(model.MutableV(i, 0)[j], 0.5 * decay, decay * 1e-3);
+      }
+    }
+  }
+}
+
+// More threads than lines: the workers of the empty shards idle.
+TEST(HogwildShardTest, MoreThreadsThanLines) {
+  const std::string small_file = "/tmp/hogwild-test-small.txt";
+  std::ofstream file(small_file.c_str());
+  file << "1:1 2:1 1\n3:1 0\n";
+  file.close();
+  for (int in_memory = 0; in_memory < 2; ++in_memory) {
+    SGDUpdater updater(0.1);
+    Model model(0, FM, 4, k, 0);
+    HogwildOptions options;
+    options.num_threads = 8;
+    options.batch_size = 10;
+    options.num_epochs = 3;
+    options.in_memory = in_memory;
+    HogwildTrainer trainer(small_file, &model, &updater, options);
+    trainer.Train();
+    EXPECT_EQ(trainer.num_samples(), 2 * 3);
+  }
+}
@@ -0,0 +1,142 @@
+/*
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or (at
+your option) any later version.
+
+This program is distributed in the hope that it will be useful, but
+WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+02110-1301, USA.
+*/
+
+/*
+Copyright (c) 2016 by contributors.
+Author: Chao Ma (mctt90@gmail.com)
+
+Micro-benchmark for SparseMatrixDenseVectorTimes (linear_algebra.h).
+We generate a CSR matrix of random rows (1M rows x 40 values by 
+default) and a dense vector, and compare the rows/sec of the 
+SparseDot() kernel of every level supported by the CPU against the
+scalar kernel, and then the rows/sec of the parallel version (with
+the default scalar kernel) with 1, 2, 4, ... threads up to the 
+number of CPUs.
+
+Usage: linear_algebra_benchmark [num_rows] [nnz_per_row] [dense_size]
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+#include <vector>
+
+#include "src/common/common.h"
+#include "src/common/data_structure.h"
+#include "src/common/linear_algebra.h"
+#include "src/common/simd.h"
+#include "src/common/thread_pool.h"
+
+using f2m::DataMatrix;
+using f2m::SIMDLevel;
+using f2m::ThreadPool;
+using f2m::real_t;
+
+namespace {
+
+double GetTime() {
+  struct timeval tv;
+  gettimeofday(&tv, NULL);
+  return tv.tv_sec + tv.tv_usec * 1e-6;
+}
+
+/* Generate num_rows random rows of nnz values. */
+
+void GenerateData(int num_rows, int nnz, int dense_size, 
+                  DataMatrix* matrix) {
+  srand(0);
+  matrix->Clear();
+  for (int i = 0; i < num_rows; ++i) {
+    for (int n = 0; n < nnz; ++n) {
+      matrix->AddNode(rand() % dense_size, 1.0);
+    }
+    matrix->EndRow(rand() % 2);
+  }
+}
+
+/* Return the rows/sec of the kernel of the level. */
+
+double BenchmarkKernel(SIMDLevel level, const DataMatrix& matrix,
+                       const std::vector<real_t>& dense, int repeat) {
+  const f2m::SIMDKernels& kernels = f2m::GetSIMDKernels(level);
+  std::vector<real_t> result(matrix.size());
+  double start = GetTime();
+  for (int i = 0; i < repeat; ++i) {
+    kernels.SparseDot(matrix.x.data(), matrix.position.data(),
+                      matrix.row_offset.data(), matrix.size(), 
+                      dense.data(), result.data());
+  }
+  return matrix.size() * repeat / (GetTime() - start);
+}
+
+/* Return the rows/sec of the parallel version. */
+
+double BenchmarkParallel(int num_threads, const DataMatrix& matrix,
+                         const std::vector<real_t>& dense, int repeat) {
+  ThreadPool pool(num_threads);
+  std::vector<real_t> result(matrix.size());
+  double start = GetTime();
+  for (int i = 0; i < repeat; ++i) {
+    f2m::SparseMatrixDenseVectorTimes(matrix, dense.data(), 
+                                      &result, &pool);
+  }
+  return matrix.size() * repeat / (GetTime() - start);
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+  int num_rows = argc > 1 ? atoi(argv[1]) : 1000000;
+  int nnz = argc > 2 ? atoi(argv[2]) : 40;
+  int dense_size = argc > 3 ? atoi(argv[3]) : 10000000;
+  const int repeat = 5;
+
+  DataMatrix matrix(num_rows);
+  GenerateData(num_rows, nnz, dense_size, &matrix);
+  std::vector<real_t> dense(dense_size, 0.5);
+
+  printf("SparseDot (%d rows x %d values, dense size %d):\n",
+         num_rows, nnz, dense_size);
+  // warm up
+  BenchmarkKernel(f2m::kScalar, matrix, dense, 1);
+  double scalar = BenchmarkKernel(f2m::kScalar, matrix, dense, repeat);
+  printf("  %-8s %.0f rows/sec\n", 
+         f2m::GetSIMDKernels(f2m::kScalar).name, scalar);
+  for (int level = f2m::kSSE; level <= f2m::DetectSIMDLevel(); ++level) {
+    double speed = BenchmarkKernel(SIMDLevel(level), matrix, dense, repeat);
+    printf("  %-8s %.0f rows/sec, speedup %.2fx\n", 
+           f2m::GetSIMDKernels(SIMDLevel(level)).name, 
+           speed, speed / scalar);
+  }
+
+  int num_cpus = sysconf(_SC_NPROCESSORS_ONLN);
+  printf("Parallel SparseMatrixDenseVectorTimes (%s):\n",
+         f2m::GetSIMDKernels(f2m::kScalar).name);
+  double single = 0;
+  for (int num_threads = 1; num_threads <= num_cpus; num_threads *= 2) {
+    double speed = BenchmarkParallel(num_threads, matrix, dense, repeat);
+    if (num_threads == 1) {
+      single = speed;
+    }
+    printf("  %2d threads %.0f rows/sec, speedup %.2fx\n", 
+           num_threads, speed, speed / single);
+  }
+
+  return 0;
+}
@@ -27,6 +27,9 @@ Unit Test for linear algebra operations (linear_algebra.h)
 #include "src/common/data_structure.h"
 #include "src/common/linear_algebra.h"
 #include "src/common/common.h"
+#include "src/common/thread_pool.h"
+
+#include <vector>
 
 namespace f2m {
 
@@ -60,14 +63,13 @@ TEST(LinearAlgebraTest, SparseVectorDenseVectorTimes) {
 TEST(LinearAlgebraTest, SparseMatrixDenseVectorTimes) {
   DataMatrix matrix(matrix_row_size);
   for (int i = 0; i < matrix_row_size; ++i) {
-    matrix[i].x.reset(new real_t[sparse_vector_size]);
-    matrix[i].position.reset(new index_t[sparse_vector_size]);
     for (int n = 0; n < sparse_vector_size; ++n) {
-      *(matrix[i].x.get() + n) = 2.0;
-      *(matrix[i].position.get() + n) = n;
+      matrix.AddNode(n, 2.0);
     }
-    matrix[i].size = sparse_vector_size;
+    matrix.EndRow(1.0);
   }
+  EXPECT_EQ(matrix.size(), matrix_row_size);
+  EXPECT_EQ(matrix.nnz(), matrix_row_size * sparse_vector_size);
 
   real_t* dense_vector = new real_t[dense_vector_size];
   for (int i = 0; i < dense_vector_size; ++i) {
@@ -84,4 +86,31 @@ TEST(LinearAlgebraTest, SparseMatrixDenseVectorTimes) {
   }
 }
 
+TEST(LinearAlgebraTest, ParallelSparseMatrixDenseVectorTimes) {
+  // Rows of different sizes, more than one block of rows.
+  const int num_rows = kRowsPerBlock * 3 + 17;
+  DataMatrix matrix(num_rows);
+  for (int i = 0; i < num_rows; ++i) {
+    for (int n = 0; n < i % 50; ++n) {
+      matrix.AddNode((i * 7 + n * 13) % dense_vector_size, 0.5 * n);
+    }
+    matrix.EndRow(1.0);
+  }
+  std::vector<real_t> dense_vector(dense_vector_size);
+  for (int i = 0; i < dense_vector_size; ++i) {
+    dense_vector[i] = (real_t)i;
+  }
+  std::vector<real_t> expected(num_rows);
+  SparseMatrixDenseVectorTimes(matrix, dense_vector.data(), &expected);
+  for (int num_threads = 1; num_threads <= 4; ++num_threads) {
+    ThreadPool pool(num_threads);
+    std::vector<real_t> result(num_rows);
+    SparseMatrixDenseVectorTimes(matrix, dense_vector.data(), 
+                                 &result, &pool);
+    for (int i = 0; i < num_rows; ++i) {
+      EXPECT_EQ(result[i], expected[i]);
+    }
+  }
+}
+
 } // namespace f2m
\ No newline at end of file
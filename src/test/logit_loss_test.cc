@@ -0,0 +1,167 @@
+/*
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or (at
+your option) any later version.
+
+This program is distributed in the hope that it will be useful, but
+WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+02110-1301, USA.
+*/
+
+/*
+Copyright (c) 2016 by contributors.
+Author: Chao Ma (mctt90@gmail.com)
+
+Unit Test for LogitLoss (logit_loss.h and logit_loss.cc)
+We check the prediction with a naive implementation, and check 
+the gradients with the finite difference of the loss.
+*/
+
+#include "gtest/gtest.h"
+
+#include "src/loss/logit_loss.h"
+#include "src/common/common.h"
+#include "src/common/data_structure.h"
+#include "src/common/linear_algebra.h"
+#include "src/common/thread_pool.h"
+
+#include <stdlib.h>
+#include <cmath>
+#include <vector>
+
+namespace f2m {
+
+const index_t feature_num = 50;
+const int num_rows = 10;
+
+real_t Random() {
+  return rand() / static_cast<real_t>(RAND_MAX) - 0.5;
+}
+
+void InitModel(Model* model) {
+  srand(1);
+  for (index_t i = 0; i < feature_num; ++i) {
+    *model->MutableW(i) = Random();
+  }
+}
+
+void InitMatrix(DataMatrix* matrix) {
+  srand(2);
+  matrix->Clear();
+  for (int r = 0; r < num_rows; ++r) {
+    for (int n = 0; n < 2 + r % 5; ++n) {
+      matrix->AddNode(rand() % feature_num, Random() + 1);
+    }
+    matrix->EndRow(r % 2);
+  }
+}
+
+double NaivePredict(const SparseRow& row, const Model& model) {
+  double pred = 0;
+  for (uint32 i = 0; i < row.size; ++i) {
+    pred += *model.W(row.position[i]) * row.x[i];
+  }
+  return pred;
+}
+
+double Loss(const DataMatrix& matrix, const Model& model) {
+  double loss = 0;
+  for (size_t r = 0; r < matrix.size(); ++r) {
+    double y = matrix[r].y > 0 ? 1 : -1;
+    loss += log(1 + exp(-y * NaivePredict(matrix[r], model)));
+  }
+  return loss;
+}
+
+/* The dense w (flat), the aligned blocks, and the sparse table. */
+
+void CheckLayout(bool sparse, bool aligned) {
+  Model model(0, LR, feature_num, 0, 0, sparse, aligned);
+  EXPECT_EQ(model.DenseW() != NULL, !sparse && !aligned);
+  InitModel(&model);
+  DataMatrix matrix;
+  InitMatrix(&matrix);
+  LogitLoss loss;
+  // Predict
+  std::vector<real_t> pred;
+  loss.Predict(matrix, model, &pred);
+  ASSERT_EQ(pred.size(), num_rows);
+  for (int r = 0; r < num_rows; ++r) {
+    EXPECT_NEAR(pred[r], NaivePredict(matrix[r], model), 1e-5);
+  }
+  // CalcGrad
+  SparseGrad grad;
+  loss.CalcGrad(matrix, model, &grad);
+  EXPECT_EQ(grad.size_v(), 0);
+  const double eps = 1e-3;
+  for (index_t i = 0; i < feature_num; ++i) {
+    double sum = 0;
+    for (size_t n = 0; n < grad.size_w(); ++n) {
+      if (grad.position_w[n] == i) {
+        sum += grad.grad_w[n];
+      }
+    }
+    real_t* w = model.MutableW(i);
+    real_t old = *w;
+    *w = old + eps;
+    double loss_plus = Loss(matrix, model);
+    *w = old - eps;
+    double loss_minus = Loss(matrix, model);
+    *w = old;
+    EXPECT_NEAR(sum, (loss_plus - loss_minus) / (2 * eps), 1e-2);
+  }
+}
+
+TEST(LogitLossTest, PredictAndCalcGrad) {
+  CheckLayout(false, false);
+  CheckLayout(false, true);
+  CheckLayout(true, false);
+}
+
+TEST(LogitLossTest, PredictWithThreadPool) {
+  // More than one block of rows for the pool.
+  Model model(0, LR, feature_num, 0, 0);
+  InitModel(&model);
+  DataMatrix matrix;
+  for (int r = 0; r < kRowsPerBlock * 3 + 5; ++r) {
+    for (int n = 0; n < 1 + r % 7; ++n) {
+      matrix.AddNode((r * 3 + n * 11) % feature_num, 0.5 + n);
+    }
+    matrix.EndRow(r % 2);
+  }
+  LogitLoss loss;
+  std::vector<real_t> expected;
+  loss.Predict(matrix, model, &expected);
+  ThreadPool pool(3);
+  LogitLoss parallel(false, &pool);
+  std::vector<real_t> pred;
+  parallel.Predict(matrix, model, &pred);
+  EXPECT_EQ(pred, expected);
+}
+
+TEST(LogitLossTest, FastEvaluate) {
+  std::vector<real_t> pred, label;
+  for (int i = -400; i <= 400; ++i) {
+    pred.push_back(i * 0.1);
+    label.push_back(i % 2);
+  }
+  LogitLoss exact;
+  LogitLoss fast(true);
+  real_t exact_loss = exact.Evaluate(pred, label);
+  EXPECT_NEAR(fast.Evaluate(pred, label), exact_loss, 1e-5 * exact_loss);
+  // A large margin does not overflow.
+  pred.assign(1, 1000);
+  label.assign(1, 0);
+  EXPECT_NEAR(fast.Evaluate(pred, label), 1000, 1e-3);
+  label.assign(1, 1);
+  EXPECT_NEAR(fast.Evaluate(pred, label), 0, 1e-6);
+}
+
+} // namespace f2m
@@ -27,6 +27,10 @@ Unit Test for Model class (data_structure.h)
 #include "src/common/data_structure.h"
 #include "src/common/common.h"
 
+#include <pthread.h>
+
+#include <algorithm>
+
 namespace f2m {
 
 const real_t init_value = 0.0;
@@ -67,4 +71,204 @@ TEST(ModelTest, GetV_FFM) {
   }
 }
 
+TEST(ModelTest, SizeOfLargeFFM) {
+  // 4e9 * (1 + 8 * 100) overflows 32 bits.
+  Model model(init_value, FFM, 4000000000U, 8, 100, true);
+  EXPECT_EQ(model.GetSizeParameters(), 0);
+  real_t* w = model.MutableW(3999999999U);
+  real_t* v = model.MutableV(3999999999U, 99);
+  EXPECT_EQ(*w, init_value);
+  EXPECT_EQ(v[7], init_value);
+  EXPECT_EQ(model.GetSizeParameters(), 1 + 8 * 100);
+}
+
+TEST(ModelTest, SparseModel) {
+  const real_t value = 0.5;
+  Model model(value, FFM, feature_num, k, field_num, true);
+  EXPECT_TRUE(model.IsSparse());
+  // Reading a new feature does not allocate it.
+  const Model& const_model = model;
+  EXPECT_EQ(const_model.W(12345)[0], value);
+  EXPECT_EQ(const_model.V(12345, field_num - 1)[k - 1], value);
+  EXPECT_EQ(model.GetSizeParameters(), 0);
+  // Update some features, then read them back.
+  for (index_t i = 0; i < 10000; ++i) {
+    index_t index = i * 997;
+    *model.MutableW(index) = index;
+    model.MutableV(index, i % field_num)[i % k] = -1.0 * index;
+  }
+  EXPECT_EQ(model.GetSizeParameters(), 
+            10000 * (1 + k * field_num));
+  for (index_t i = 0; i < 10000; ++i) {
+    index_t index = i * 997;
+    EXPECT_EQ(const_model.W(index)[0], index);
+    EXPECT_EQ(const_model.V(index, i % field_num)[i % k], -1.0 * index);
+    EXPECT_EQ(const_model.V(index, (i + 1) % field_num)[i % k], value);
+  }
+  real_t* pointer = NULL;
+  EXPECT_EQ(model.GetV(&pointer, 997, 1), k);
+  EXPECT_EQ(pointer, model.MutableV(997, 1));
+}
+
+// In the aligned mode, each feature is a block aligned to the
+// cache line, and the latent vectors are padded with zeros.
+void CheckAlignedModel(ModelType type, int num_field, bool sparse) {
+  const int small_k = 5;
+  const index_t num_feature = 1000;
+  Model model(0.5, type, num_feature, small_k, num_field, sparse, true);
+  EXPECT_TRUE(model.IsAligned());
+  EXPECT_EQ(model.GetPaddedK(), kSIMDWidth);
+  int num_v = (type == FM) ? 1 : num_field;
+  for (index_t i = 0; i < num_feature; ++i) {
+    real_t* w = model.MutableW(i);
+    real_t* v0 = model.MutableV(i, 0);
+    EXPECT_EQ(reinterpret_cast<uintptr_t>(v0) % kCacheLineSize, 0);
+    // w is right after the latent vectors of the feature.
+    EXPECT_EQ(w, v0 + num_v * kSIMDWidth);
+    EXPECT_EQ(*w, 0.5);
+    for (int f = 0; f < num_v; ++f) {
+      const real_t* v = model.V(i, f);
+      EXPECT_EQ(reinterpret_cast<uintptr_t>(v) % (kSIMDWidth * sizeof(real_t)), 0);
+      for (int j = 0; j < kSIMDWidth; ++j) {
+        EXPECT_EQ(v[j], j < small_k ? 0.5 : 0.0);
+      }
+    }
+    *w = i;
+    model.MutableV(i, num_v - 1)[small_k - 1] = -1.0 * i;
+  }
+  // The blocks do not overlap.
+  for (index_t i = 0; i < num_feature; ++i) {
+    EXPECT_EQ(*model.W(i), i);
+    EXPECT_EQ(model.V(i, num_v - 1)[small_k - 1], -1.0 * i);
+    EXPECT_EQ(model.V(i, 0)[0], 0.5);
+  }
+}
+
+TEST(ModelTest, AlignedModel) {
+  CheckAlignedModel(FM, 0, false);
+  CheckAlignedModel(FFM, 3, false);
+  CheckAlignedModel(FM, 0, true);
+  CheckAlignedModel(FFM, 3, true);
+}
+
+// The state of every parameter is in the block of its feature,
+// and does not overlap with the parameters.
+void CheckModelState(bool sparse, bool aligned) {
+  const int num_state = 2;
+  Model model(init_value, FFM, 100, 3, 4, sparse, aligned, num_state);
+  EXPECT_EQ(model.GetNumState(), num_state);
+  for (index_t i = 0; i < 100; ++i) {
+    real_t* w = model.MutableW(i);
+    real_t* v = model.MutableV(i);
+    real_t* state_w = model.MutableStateW(i, 0);
+    EXPECT_EQ(model.MutableStateW(i, 1), state_w + 1);
+    for (int s = 0; s < num_state; ++s) {
+      EXPECT_EQ(model.MutableStateW(i, s)[0], 0);
+      model.MutableStateW(i, s)[0] = 1;
+      for (int f = 0; f < 4; ++f) {
+        real_t* state_v = model.MutableStateV(i, f, s);
+        if (aligned) {
+          EXPECT_EQ(reinterpret_cast<uint64>(state_v) % 32, 0);
+        }
+        for (int j = 0; j < model.GetPaddedK(); ++j) {
+          EXPECT_EQ(state_v[j], 0);
+          state_v[j] = 1;
+        }
+      }
+    }
+    // All the parameters are still zero.
+    EXPECT_EQ(*w, 0);
+    for (int j = 0; j < 4 * model.GetPaddedK(); ++j) {
+      EXPECT_EQ(v[j], 0);
+    }
+    // All in one block of the feature.
+    uint64 size_block = model.GetSizeParameters() / 100;
+    if (!sparse) {
+      EXPECT_LT(model.MutableStateV(i, 3, 1) - std::min(w, v), 
+                size_block);
+    }
+  }
+}
+
+TEST(ModelTest, ModelState) {
+  CheckModelState(false, false);
+  CheckModelState(false, true);
+  CheckModelState(true, false);
+  CheckModelState(true, true);
+}
+
+TEST(ModelTest, RandomizeV) {
+  Model model(init_value, FFM, 100, 3, 4, false, true);
+  model.RandomizeV(0.1, 1);
+  for (index_t i = 0; i < 100; ++i) {
+    EXPECT_EQ(*model.W(i), init_value);
+    for (int f = 0; f < 4; ++f) {
+      const real_t* v = model.V(i, f);
+      for (int j = 0; j < 3; ++j) {
+        EXPECT_GE(v[j], -0.1);
+        EXPECT_LT(v[j], 0.1);
+        EXPECT_NE(v[j], 0);
+      }
+      // The padding stays zero.
+      for (int j = 3; j < model.GetPaddedK(); ++j) {
+        EXPECT_EQ(v[j], 0);
+      }
+    }
+  }
+}
+
+TEST(ModelTest, RandomizeV_Sparse) {
+  Model dense(init_value, FFM, 100, 3, 4, false, true);
+  Model sparse(init_value, FFM, 100, 3, 4, true, true);
+  // A feature allocated before and features allocated after.
+  sparse.MutableW(7);
+  dense.RandomizeV(0.1, 1);
+  sparse.RandomizeV(0.1, 1);
+  for (index_t i = 0; i < 100; i += 7) {
+    for (int f = 0; f < 4; ++f) {
+      const real_t* v = sparse.MutableV(i, f);
+      const real_t* expected = dense.V(i, f);
+      for (int j = 0; j < sparse.GetPaddedK(); ++j) {
+        EXPECT_EQ(v[j], expected[j]);
+      }
+    }
+    EXPECT_EQ(*sparse.W(i), init_value);
+  }
+  // The latent vectors of two features are different.
+  EXPECT_NE(sparse.V(7, 0)[0], sparse.V(14, 0)[0]);
+}
+
+// Many threads insert the same features, every feature
+// gets exactly one block.
+static void* InsertFeatures(void* arg) {
+  SparseTable* table = reinterpret_cast<SparseTable*>(arg);
+  for (index_t i = 0; i < 100000; ++i) {
+    real_t* block = table->FindOrInsert(i);
+    EXPECT_EQ(block, table->Find(i));
+  }
+  return NULL;
+}
+
+TEST(SparseTableTest, ConcurrentInsert) {
+  SparseTable table(std::vector<real_t>(3, 1.0));
+  const int num_threads = 4;
+  pthread_t threads[num_threads];
+  for (int i = 0; i < num_threads; ++i) {
+    pthread_create(&threads[i], NULL, InsertFeatures, &table);
+  }
+  for (int i = 0; i < num_threads; ++i) {
+    pthread_join(threads[i], NULL);
+  }
+  EXPECT_EQ(table.size(), 100000);
+  EXPECT_TRUE(table.Find(100000) == NULL);
+  // The blocks do not overlap.
+  for (index_t i = 0; i < 100000; ++i) {
+    table.Find(i)[0] = i;
+  }
+  for (index_t i = 0; i < 100000; ++i) {
+    EXPECT_EQ(table.Find(i)[0], i);
+    EXPECT_EQ(table.Find(i)[2], 1.0);
+  }
+}
+
 } // namespace f2m
\ No newline at end of file
@@ -0,0 +1,166 @@
+/*
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or (at
+your option) any later version.
+
+This program is distributed in the hope that it will be useful, but
+WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+02110-1301, USA.
+*/
+
+/*
+Copyright (c) 2016 by contributors.
+Author: Chao Ma (mctt90@gmail.com)
+
+Micro-benchmark for Parser and FFMParser (parser.h).
+We generate some random lines in libsvm and libffm format, then compare 
+the rows/sec of the single-pass tokenizer with the old implementation, 
+which splits every line by SplitStringUsing() and parses the items 
+by atoi() and atof().
+
+Usage: parser_benchmark [num_rows] [num_features_per_row]
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/time.h>
+
+#include <string>
+#include <vector>
+
+#include "src/common/common.h"
+#include "src/common/data_structure.h"
+#include "src/reader/parser.h"
+
+using f2m::DataMatrix;
+using f2m::FFMParser;
+using f2m::Parser;
+using f2m::StringList;
+
+namespace {
+
+double GetTime() {
+  struct timeval tv;
+  gettimeofday(&tv, NULL);
+  return tv.tv_sec + tv.tv_usec * 1e-6;
+}
+
+/* The old implementation of Parser::Parse (libsvm format). */
+
+void OldParse(const StringList* list, DataMatrix* matrix) {
+  matrix->Clear();
+  for (int i = 0; i < list->size(); ++i) {
+    StringList items;
+    SplitStringUsing((*list)[i], "\t", &items);
+    int item_size = items.size();
+    for (int n = 0; n < item_size - 1; ++n) {
+      char* ch_ptr = const_cast<char*>(items[n].c_str());
+      int pos = 0;
+      while (ch_ptr[pos] != ':') { ++pos; }
+      ch_ptr[pos] = '\0';
+      matrix->AddNode(atoi(ch_ptr), atof(ch_ptr + pos + 1));
+    }
+    matrix->EndRow(atof(items[item_size - 1].c_str()));
+  }
+}
+
+/* The old implementation of FFMParser::Parse (libffm format). */
+
+void OldFFMParse(const StringList* list, DataMatrix* matrix) {
+  matrix->Clear();
+  for (int i = 0; i < list->size(); ++i) {
+    StringList items;
+    SplitStringUsing((*list)[i], "\t", &items);
+    int item_size = items.size();
+    for (int n = 0; n < item_size - 1; ++n) {
+      char* ch_ptr = const_cast<char*>(items[n].c_str());
+      int pos = 0;
+      while (ch_ptr[pos] != ':') { ++pos; }
+      int pos_1 = pos++;
+      while (ch_ptr[pos] != ':') { ++pos; }
+      int pos_2 = pos;
+      ch_ptr[pos_1] = '\0';
+      ch_ptr[pos_2] = '\0';
+      matrix->AddNode(atoi(ch_ptr + pos_1 + 1), 
+                      atof(ch_ptr + pos_2 + 1), 
+                      atoi(ch_ptr));
+    }
+    matrix->EndRow(atof(items[item_size - 1].c_str()));
+  }
+}
+
+/* Generate num_rows random lines. */
+
+void GenerateData(int num_rows, int num_features, bool ffm, 
+                  StringList* list) {
+  srand(0);
+  list->resize(num_rows);
+  for (int i = 0; i < num_rows; ++i) {
+    std::string& line = (*list)[i];
+    line.clear();
+    for (int n = 0; n < num_features; ++n) {
+      if (ffm) {
+        StringAppendF(&line, "%d:", n % 20);
+      }
+      StringAppendF(&line, "%d:%.6g\t", rand() % 10000000,
+                    rand() / static_cast<double>(RAND_MAX));
+    }
+    line.append(rand() % 2 ? "1" : "0");
+  }
+}
+
+template <typename ParseFunction>
+double Benchmark(ParseFunction parse, const StringList& list, 
+                 DataMatrix* matrix, int repeat) {
+  // The old implementation changes the strings in place.
+  std::vector<StringList> copies(repeat, list);
+  double start = GetTime();
+  for (int i = 0; i < repeat; ++i) {
+    parse(&copies[i], matrix);
+  }
+  return list.size() * repeat / (GetTime() - start);
+}
+
+void ParseLR(const StringList* list, DataMatrix* matrix) {
+  static Parser parser;
+  parser.Parse(list, matrix);
+}
+
+void ParseFFM(const StringList* list, DataMatrix* matrix) {
+  static FFMParser parser;
+  parser.Parse(list, matrix);
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+  int num_rows = argc > 1 ? atoi(argv[1]) : 100000;
+  int num_features = argc > 2 ? atoi(argv[2]) : 40;
+  const int repeat = 5;
+
+  StringList list;
+  DataMatrix matrix(num_rows);
+
+  GenerateData(num_rows, num_features, false, &list);
+  double old_lr = Benchmark(OldParse, list, &matrix, repeat);
+  double new_lr = Benchmark(ParseLR, list, &matrix, repeat);
+  printf("Parser    (%d rows x %d features): old %.0f rows/sec, "
+         "new %.0f rows/sec, speedup %.2fx\n", num_rows, num_features,
+         old_lr, new_lr, new_lr / old_lr);
+
+  GenerateData(num_rows, num_features, true, &list);
+  double old_ffm = Benchmark(OldFFMParse, list, &matrix, repeat);
+  double new_ffm = Benchmark(ParseFFM, list, &matrix, repeat);
+  printf("FFMParser (%d rows x %d features): old %.0f rows/sec, "
+         "new %.0f rows/sec, speedup %.2fx\n", num_rows, num_features,
+         old_ffm, new_ffm, new_ffm / old_ffm);
+
+  return 0;
+}
@@ -32,11 +32,13 @@ We write some data to a file, then check the parser's result.
 
 #include <string>
 #include <fstream>
+#include <set>
 
 using f2m::Reader;
 using f2m::StringList;
 using f2m::Parser;
 using f2m::FFMParser;
+using f2m::HashFFMParser;
 using f2m::DataMatrix;
 
 const std::string filename_1 = "/tmp/reader-test-1.txt";
@@ -139,4 +141,199 @@ TEST_F(ParserTest, FFM) {
       }
     }
   }
-}
\ No newline at end of file
+}
+
+TEST_F(ParserTest, FFM_from_views) {
+  f2m::StringPieceList *views = NULL;
+  Reader reader(filename_2, num_line, true); // in-memory mode.
+  DataMatrix matrix(num_line);
+  FFMParser parser;
+  views = reader.SampleViews();
+  parser.Parse(views, &matrix);
+  for (int n = 0; n < num_line; ++n) {
+    EXPECT_EQ(matrix[n].size, 6);
+    EXPECT_EQ(matrix[n].y, 1.0);
+    for (int k = 0; k < num_data; ++k) {
+      EXPECT_EQ(matrix[n].position[k], k);
+      EXPECT_EQ(matrix[n].x[k], (float)atof(testdata[k].c_str()));
+      EXPECT_EQ(matrix[n].field[k], 1);
+    }
+  }
+}
+TEST_F(ParserTest, ReuseMatrix) {
+  Reader reader(filename_1, num_line);
+  DataMatrix matrix;
+  Parser parser;
+  parser.Parse(reader.Samples(), &matrix);
+  EXPECT_EQ(matrix.size(), num_line);
+  EXPECT_EQ(matrix.nnz(), num_line * num_data);
+  EXPECT_TRUE(matrix[0].field == NULL);
+  const f2m::real_t* x = matrix.x.data();
+  // The second batch reuses the memory of the first one.
+  parser.Parse(reader.Samples(), &matrix);
+  EXPECT_EQ(matrix.size(), num_line);
+  EXPECT_EQ(matrix.nnz(), num_line * num_data);
+  EXPECT_EQ(matrix.x.data(), x);
+}
+
+TEST(ParserFormatTest, SpaceSeparatorAndNumbers) {
+  StringList list;
+  list.push_back("3:1.5e2 7:-0.25  11:4\t1");
+  list.push_back(" 2:.5\t8:1E-3 -1");
+  list.push_back("0");
+  DataMatrix matrix;
+  Parser parser;
+  parser.Parse(&list, &matrix);
+  EXPECT_EQ(matrix.size(), 3);
+  EXPECT_EQ(matrix[0].size, 3);
+  EXPECT_EQ(matrix[0].position[0], 3);
+  EXPECT_EQ(matrix[0].x[0], 150.0);
+  EXPECT_EQ(matrix[0].position[1], 7);
+  EXPECT_EQ(matrix[0].x[1], -0.25);
+  EXPECT_EQ(matrix[0].position[2], 11);
+  EXPECT_EQ(matrix[0].x[2], 4.0);
+  EXPECT_EQ(matrix[0].y, 1.0);
+  EXPECT_EQ(matrix[1].size, 2);
+  EXPECT_EQ(matrix[1].x[0], 0.5);
+  EXPECT_EQ(matrix[1].x[1], (float)1e-3);
+  EXPECT_EQ(matrix[1].y, -1.0);
+  EXPECT_EQ(matrix[2].size, 0);
+  EXPECT_EQ(matrix[2].y, 0.0);
+}
+
+TEST(ParserFormatTest, ParseRealSameAsStrtod) {
+  const char* numbers[] = { "0.1", "123.456", "-7.125", "3.14159265",
+                            "1e-30", "2.5E+10", "0.000001", "99999999",
+                            "1.23456789012345678901", "6.02e23" };
+  for (int i = 0; i < sizeof(numbers) / sizeof(numbers[0]); ++i) {
+    const char* end = numbers[i] + strlen(numbers[i]);
+    f2m::real_t value = 0;
+    EXPECT_EQ(Parser::ParseReal(numbers[i], end, &value), end);
+    EXPECT_EQ(value, (float)strtod(numbers[i], NULL));
+  }
+  srand(0);
+  for (int i = 0; i < 10000; ++i) {
+    std::string str = StringPrintf("%.7g", rand() / (double)RAND_MAX);
+    f2m::real_t value = 0;
+    Parser::ParseReal(str.data(), str.data() + str.size(), &value);
+    EXPECT_EQ(value, (float)atof(str.c_str()));
+  }
+}
+
+TEST(ParserFormatTest, ParseRealSlowPathIsBounded) {
+  f2m::real_t value = 0;
+  // strtod() would skip the space of "1: 0.5".
+  const char* spaced = " 0.5";
+  EXPECT_TRUE(Parser::ParseReal(spaced, spaced + 4, &value) == NULL);
+  const char* tab = "\t1e400";
+  EXPECT_TRUE(Parser::ParseReal(tab, tab + 6, &value) == NULL);
+  // A long mantissa takes the slow path, which stops at end.
+  const char* digits = "1234567890123456789999";
+  const char* end = digits + 18;
+  EXPECT_EQ(Parser::ParseReal(digits, end, &value), end);
+  EXPECT_EQ(value, (float)strtod("123456789012345678", NULL));
+  // And at a separator.
+  const char* items = "0.12345678901234567 5";
+  EXPECT_EQ(Parser::ParseReal(items, items + 21, &value), items + 19);
+  EXPECT_EQ(value, (float)strtod("0.12345678901234567", NULL));
+  // A token longer than the stack buffer of the slow path.
+  std::string long_number = "0." + std::string(100, '3');
+  const char* long_end = long_number.data() + long_number.size();
+  EXPECT_EQ(Parser::ParseReal(long_number.data(), long_end, &value), 
+            long_end);
+  EXPECT_EQ(value, (float)strtod(long_number.c_str(), NULL));
+}
+
+TEST(HashFFMParserTest, StringFeatures) {
+  StringList list;
+  list.push_back("0:user=1234:1 1:ad=ab12cd:1\t2:city=\xe5\x8c\x97:0.5 1");
+  list.push_back("  3:x:-2.5e1   0 ");
+  list.push_back("-1");
+  DataMatrix matrix;
+  HashFFMParser parser(20);
+  parser.Parse(&list, &matrix);
+  EXPECT_EQ(matrix.size(), 3);
+  EXPECT_EQ(matrix[0].size, 3);
+  EXPECT_EQ(matrix[0].position[0], parser.Hash(0, "user=1234", 9));
+  EXPECT_EQ(matrix[0].position[1], parser.Hash(1, "ad=ab12cd", 9));
+  EXPECT_EQ(matrix[0].position[2], parser.Hash(2, "city=\xe5\x8c\x97", 8));
+  EXPECT_EQ(matrix[0].field[0], 0);
+  EXPECT_EQ(matrix[0].field[1], 1);
+  EXPECT_EQ(matrix[0].field[2], 2);
+  EXPECT_EQ(matrix[0].x[0], 1.0);
+  EXPECT_EQ(matrix[0].x[2], 0.5);
+  EXPECT_EQ(matrix[0].y, 1.0);
+  EXPECT_EQ(matrix[1].size, 1);
+  EXPECT_EQ(matrix[1].position[0], parser.Hash(3, "x", 1));
+  EXPECT_EQ(matrix[1].field[0], 3);
+  EXPECT_EQ(matrix[1].x[0], -25.0);
+  EXPECT_EQ(matrix[1].y, 0.0);
+  EXPECT_EQ(matrix[2].size, 0);
+  EXPECT_EQ(matrix[2].y, -1.0);
+}
+
+TEST(HashFFMParserTest, IndexSpace) {
+  // Without the field, it is XXHash64 of the string.
+  HashFFMParser parser(8, false);
+  const std::string feature = "a-long-feature-string/" + std::string(1000, 'z');
+  EXPECT_EQ(parser.Hash(7, feature.data(), feature.size()),
+            XXHash64(feature.data(), feature.size()) & 255);
+  EXPECT_EQ(parser.Hash(7, "abc", 3), parser.Hash(8, "abc", 3));
+  // All the indices are in [0, 2^hash_bits).
+  for (int hash_bits = 1; hash_bits <= 31; hash_bits += 5) {
+    HashFFMParser bits_parser(hash_bits);
+    for (int i = 0; i < 1000; ++i) {
+      std::string str = StringPrintf("%d", i);
+      EXPECT_LT(static_cast<uint64>(
+                    bits_parser.Hash(i % 7, str.data(), str.size())),
+                1ULL << hash_bits);
+    }
+  }
+}
+
+// The same string in different fields gets different indices.
+TEST(HashFFMParserTest, FieldNamespace) {
+  HashFFMParser parser(24);
+  for (int i = 0; i < 100; ++i) {
+    std::string str = StringPrintf("%d", i);
+    std::set<f2m::index_t> indices;
+    for (uint32 field = 0; field < 50; ++field) {
+      indices.insert(parser.Hash(field, str.data(), str.size()));
+    }
+    EXPECT_EQ(indices.size(), 50);
+  }
+}
+
+// About n^2 / 2^(hash_bits+1) pairs of n strings collide.
+TEST(HashFFMParserTest, Collisions) {
+  const int hash_bits = 24;
+  const int n = 100000;
+  HashFFMParser parser(hash_bits);
+  std::set<f2m::index_t> indices;
+  for (int i = 0; i < n; ++i) {
+    std::string str = StringPrintf("user=%d", i * 7919);
+    indices.insert(parser.Hash(1, str.data(), str.size()));
+  }
+  double expected = static_cast<double>(n) * n / (2 << hash_bits);
+  EXPECT_LT(n - static_cast<int>(indices.size()), 2 * expected);
+}
+
+TEST(HashFFMParserDeathTest, FormatError) {
+  const char* lines[] = {
+    "1::0.5 1",        // empty feature
+    "1:abc 1",         // no value
+    "1:abc: 1",        // empty value
+    "1:a:b:0.5 1",     // ':' in the feature
+    "1:abc:0.5x 1",    // bad value
+    "1:abc:0.5",       // no y
+    ""                 // empty line
+  };
+  for (int i = 0; i < sizeof(lines) / sizeof(lines[0]); ++i) {
+    StringList list(1, lines[i]);
+    DataMatrix matrix;
+    HashFFMParser parser(10);
+    EXPECT_DEATH(parser.Parse(&list, &matrix), "format error") << lines[i];
+  }
+  EXPECT_DEATH(HashFFMParser(0), "");
+  EXPECT_DEATH(HashFFMParser(32), "");
+}
@@ -0,0 +1,123 @@
+/*
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or (at
+your option) any later version.
+
+This program is distributed in the hope that it will be useful, but
+WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+02110-1301, USA.
+*/
+
+/*
+Copyright (c) 2016 by contributors.
+Author: Chao Ma (mctt90@gmail.com)
+
+Unit Test for Pipeline (pipeline.h and pipeline.cc)
+We write some data to a file, then check the parsed batches of 
+every epoch.
+*/
+
+#include "gtest/gtest.h"
+
+#include "src/reader/pipeline.h"
+#include "src/reader/reader.h"
+#include "src/reader/parser.h"
+#include "src/common/common.h"
+#include "src/common/data_structure.h"
+
+#include <zlib.h>
+
+#include <string>
+#include <vector>
+#include <fstream>
+
+using f2m::DataMatrix;
+using f2m::Parser;
+using f2m::Pipeline;
+using f2m::Reader;
+
+const std::string filename = "/tmp/pipeline-test.txt";
+const std::string gzip_filename = "/tmp/pipeline-test.txt.gz";
+
+const int num_line = 100;
+const int num_samples = 7;
+const int num_epochs = 3;
+
+class PipelineTest : public ::testing::Test {
+ protected:
+  virtual void SetUp() { // Write some data to a temp file.
+    std::ofstream file;
+    file.open(filename.c_str());
+    // the index of every line is its line number.
+    for (int i = 0; i < num_line; ++i) {
+      file << i << ":1\t" << (i % 2) << "\n";
+    }
+    // the same lines in a gzip file.
+    gzFile gzip_file = gzopen(gzip_filename.c_str(), "wb");
+    for (int i = 0; i < num_line; ++i) {
+      gzprintf(gzip_file, "%d:1\t%d\n", i, i % 2);
+    }
+    gzclose(gzip_file);
+  }
+
+  void CheckEpochs(bool in_memory, int num_threads, 
+                   const std::string& input = filename) {
+    Reader reader(input, 1, in_memory);
+    Parser parser;
+    Pipeline pipeline(&reader, &parser, num_samples, 
+                      num_threads, num_epochs, 2);
+    for (int epoch = 0; epoch < num_epochs; ++epoch) {
+      EXPECT_FALSE(pipeline.Done());
+      EXPECT_EQ(pipeline.epoch(), epoch);
+      std::vector<int> count(num_line, 0);
+      DataMatrix* matrix = NULL;
+      while ((matrix = pipeline.NextBatch()) != NULL) {
+        EXPECT_LE(matrix->size(), num_samples);
+        for (int i = 0; i < matrix->size(); ++i) {
+          int index = (*matrix)[i].position[0];
+          EXPECT_EQ((*matrix)[i].y, index % 2);
+          count[index]++;
+        }
+        pipeline.Recycle(matrix);
+      }
+      // Every line appears exactly once in an epoch.
+      for (int i = 0; i < num_line; ++i) {
+        EXPECT_EQ(count[i], 1);
+      }
+    }
+    EXPECT_TRUE(pipeline.Done());
+    EXPECT_TRUE(pipeline.NextBatch() == NULL);
+  }
+};
+
+TEST_F(PipelineTest, FromDisk) {
+  CheckEpochs(false, 1);
+  CheckEpochs(false, 4);
+}
+
+TEST_F(PipelineTest, FromMemory) {
+  CheckEpochs(true, 1);
+  CheckEpochs(true, 4);
+}
+
+TEST_F(PipelineTest, FromGzip) {
+  CheckEpochs(false, 1, gzip_filename);
+  CheckEpochs(false, 4, gzip_filename);
+  CheckEpochs(true, 4, gzip_filename);
+}
+
+TEST_F(PipelineTest, DestroyBeforeDone) {
+  Reader reader(filename, 1);
+  Parser parser;
+  Pipeline pipeline(&reader, &parser, num_samples, 4, num_epochs, 2);
+  DataMatrix* matrix = pipeline.NextBatch();
+  EXPECT_TRUE(matrix != NULL);
+  // The destructor stops all the blocked threads.
+}
@@ -27,7 +27,13 @@ We write some data to a file, then check the sample result.
 
 #include "src/reader/reader.h"
 
+#include <pthread.h>
+#include <stdlib.h>
+#include <zlib.h>
+
 #include <string>
+#include <vector>
+#include <algorithm>
 #include <fstream>
 
 using f2m::Reader;
@@ -68,3 +74,496 @@ TEST_F(ReaderTest, SampleFromMemory) {
     EXPECT_EQ((*samples)[0], testdata[i]);
   }
 }
+
+TEST_F(ReaderTest, SampleViewsFromMemory) {
+  f2m::StringPieceList *views = NULL;
+  Reader reader(filename, 2, true);
+  for (int i = 0; i < num_data; i += 2) {
+    views = reader.SampleViews();
+    EXPECT_EQ((*views)[0].ToString(), testdata[i]);
+    EXPECT_EQ((*views)[1].ToString(), testdata[i+1]);
+  }
+}
+
+TEST_F(ReaderTest, SampleViewsFromDisk) {
+  f2m::StringPieceList *views = NULL;
+  Reader reader(filename, 1);
+  for (int i = 0; i < num_data; ++i) {
+    views = reader.SampleViews();
+    EXPECT_EQ((*views)[0].ToString(), testdata[i]);
+  }
+}
+
+// The last batch of an epoch is short, and never
+// takes lines from the next epoch.
+TEST_F(ReaderTest, ShortBatchAndEpoch) {
+  for (int in_memory = 0; in_memory < 2; ++in_memory) {
+    Reader reader(filename, 4, in_memory);
+    for (int epoch = 0; epoch < 3; ++epoch) {
+      EXPECT_EQ(reader.epoch(), epoch);
+      StringList* samples = reader.Samples();
+      ASSERT_EQ(samples->size(), 4);
+      EXPECT_EQ((*samples)[0], testdata[0]);
+      EXPECT_EQ(reader.epoch(), epoch);
+      f2m::StringPieceList* views = reader.SampleViews();
+      ASSERT_EQ(views->size(), num_data - 4);
+      EXPECT_EQ((*views)[0].ToString(), testdata[4]);
+      EXPECT_EQ((*views)[1].ToString(), testdata[5]);
+      EXPECT_EQ(reader.epoch(), epoch + 1);
+    }
+  }
+}
+
+// An epoch ends with the batch which reads the last line,
+// so there is no empty batch if N divides the file.
+TEST_F(ReaderTest, EpochEndsWithFullBatch) {
+  for (int in_memory = 0; in_memory < 2; ++in_memory) {
+    Reader reader(filename, num_data / 2, in_memory);
+    for (int i = 0; i < 6; ++i) {
+      StringList* samples = reader.Samples();
+      ASSERT_EQ(samples->size(), num_data / 2);
+      EXPECT_EQ((*samples)[0], testdata[(i % 2) * num_data / 2]);
+      EXPECT_EQ(reader.epoch(), (i + 1) / 2);
+    }
+  }
+}
+
+const std::string shuffle_file = "/tmp/reader-test-shuffle.txt";
+
+// Read one epoch of shuffled lines and return the line numbers,
+// the lines are the same as the file written by ReaderShuffleTest.
+std::vector<int> ReadShuffledEpoch(Reader* reader, int num_lines) {
+  std::vector<int> lines;
+  int epoch = reader->epoch();
+  while (reader->epoch() == epoch) {
+    f2m::StringPieceList* views = reader->SampleViews();
+    for (size_t i = 0; i < views->size(); ++i) {
+      lines.push_back(atoi((*views)[i].data()));
+    }
+  }
+  // Every line appears exactly once in an epoch.
+  std::vector<int> count(num_lines, 0);
+  for (size_t i = 0; i < lines.size(); ++i) {
+    count[lines[i]]++;
+  }
+  for (int i = 0; i < num_lines; ++i) {
+    EXPECT_EQ(count[i], 1);
+  }
+  return lines;
+}
+
+class ReaderShuffleTest : public ::testing::Test {
+ protected:
+  static const int num_lines = 1000;
+
+  virtual void SetUp() {
+    std::ofstream file(shuffle_file.c_str());
+    for (int i = 0; i < num_lines; ++i) {
+      file << i << "\r\n";
+    }
+  }
+};
+
+TEST_F(ReaderShuffleTest, ShuffleLines) {
+  Reader reader(shuffle_file, 64, true);
+  reader.EnableShuffle();
+  std::vector<int> first = ReadShuffledEpoch(&reader, num_lines);
+  std::vector<int> second = ReadShuffledEpoch(&reader, num_lines);
+  EXPECT_EQ(reader.epoch(), 2);
+  // A new order in each epoch, and not the order of the file.
+  EXPECT_NE(first, second);
+  std::vector<int> sorted(first);
+  std::sort(sorted.begin(), sorted.end());
+  EXPECT_NE(first, sorted);
+}
+
+TEST_F(ReaderShuffleTest, ShuffleBlocks) {
+  const int block_size = 10;
+  Reader reader(shuffle_file, 64, true);
+  reader.EnableShuffle(block_size, 1);
+  std::vector<int> lines = ReadShuffledEpoch(&reader, num_lines);
+  // The lines of one block are returned together.
+  for (int i = 0; i < num_lines; ++i) {
+    EXPECT_EQ(lines[i] / block_size, lines[i / block_size * block_size] 
+                                     / block_size);
+  }
+  EXPECT_NE(lines[0] / block_size, 0);
+}
+
+// Each Reader has its own position, in both modes.
+TEST_F(ReaderTest, IndependentReaders) {
+  for (int in_memory = 0; in_memory < 2; ++in_memory) {
+    Reader first(filename, 1, in_memory);
+    Reader second(filename, 1, in_memory);
+    // Move the first reader forward by two lines.
+    first.Samples();
+    first.Samples();
+    for (int i = 0; i < num_data; ++i) {
+      EXPECT_EQ((*second.Samples())[0], testdata[i]);
+      EXPECT_EQ((*first.Samples())[0], testdata[(i + 2) % num_data]);
+    }
+  }
+}
+
+static void* ReadAllLines(void* arg) {
+  Reader* reader = reinterpret_cast<Reader*>(arg);
+  for (int k = 0; k < 100; ++k) {
+    StringPiece line;
+    for (int i = 0; i < num_data; ++i) {
+      EXPECT_TRUE(reader->ReadLine(&line));
+      EXPECT_EQ(line.ToString(), testdata[i]);
+    }
+    EXPECT_FALSE(reader->ReadLine(&line));
+  }
+  return NULL;
+}
+
+TEST_F(ReaderTest, ConcurrentReaders) {
+  const int num_threads = 4;
+  std::vector<Reader*> readers;
+  std::vector<pthread_t> threads(num_threads);
+  for (int i = 0; i < num_threads; ++i) {
+    readers.push_back(new Reader(filename, 1, i % 2 == 0));
+    pthread_create(&threads[i], NULL, ReadAllLines, readers[i]);
+  }
+  for (int i = 0; i < num_threads; ++i) {
+    pthread_join(threads[i], NULL);
+    delete readers[i];
+  }
+}
+
+// Every line is read by exactly one shard.
+TEST(ReaderShardTest, ShardsCoverAllLines) {
+  const std::string shard_file = "/tmp/reader-test-shard.txt";
+  const int num_lines = 50;
+  std::ofstream file(shard_file.c_str());
+  for (int i = 0; i < num_lines; ++i) {
+    // lines of different length
+    file << i << std::string(i % 7, 'x') << "\n";
+  }
+  file.close();
+  for (int in_memory = 0; in_memory < 2; ++in_memory) {
+    for (int num_shards = 1; num_shards <= 8; ++num_shards) {
+      std::vector<int> count(num_lines, 0);
+      for (int shard = 0; shard < num_shards; ++shard) {
+        Reader reader(shard_file, 1, in_memory, shard, num_shards);
+        // Read the shard twice, the lines are the same.
+        std::vector<std::string> lines[2];
+        for (int k = 0; k < 2; ++k) {
+          StringPiece line;
+          while (reader.ReadLine(&line)) {
+            lines[k].push_back(line.ToString());
+          }
+        }
+        EXPECT_EQ(lines[0], lines[1]);
+        EXPECT_FALSE(lines[0].empty());
+        for (size_t i = 0; i < lines[0].size(); ++i) {
+          int index = atoi(lines[0][i].c_str());
+          EXPECT_EQ(lines[0][i], 
+                    StringPrintf("%d", index) + std::string(index % 7, 'x'));
+          count[index]++;
+        }
+      }
+      for (int i = 0; i < num_lines; ++i) {
+        EXPECT_EQ(count[i], 1);
+      }
+    }
+  }
+}
+
+// More shards than lines: the empty shards return empty epochs.
+TEST(ReaderShardTest, EmptyShards) {
+  const std::string shard_file = "/tmp/reader-test-shard.txt";
+  const int num_lines = 3;
+  const int num_shards = 8;
+  std::ofstream file(shard_file.c_str());
+  for (int i = 0; i < num_lines; ++i) {
+    file << i << "\n";
+  }
+  file.close();
+  for (int in_memory = 0; in_memory < 2; ++in_memory) {
+    int total = 0;
+    for (int shard = 0; shard < num_shards; ++shard) {
+      Reader reader(shard_file, 10, in_memory, shard, num_shards);
+      for (int epoch = 0; epoch < 3; ++epoch) {
+        EXPECT_EQ(reader.epoch(), epoch);
+        int size = reader.SampleViews()->size();
+        EXPECT_EQ(reader.epoch(), epoch + 1);
+        if (epoch == 0) {
+          total += size;
+        }
+      }
+    }
+    EXPECT_EQ(total, num_lines);
+  }
+}
+
+// Lines longer than the initial buffer (100 KB) of the disk 
+// mode, and the last line does not end with '\n'.
+TEST(ReaderFormatTest, LongLines) {
+  const std::string long_file = "/tmp/reader-test-long.txt";
+  const int kBuffer = 100 * 1024;
+  const int lengths[] = { 3, kBuffer - 2, kBuffer - 1, kBuffer, 
+                          kBuffer + 1, 5 * kBuffer, 7, 3 * kBuffer };
+  const int num_lines = sizeof(lengths) / sizeof(lengths[0]);
+  std::ofstream file(long_file.c_str());
+  for (int i = 0; i < num_lines; ++i) {
+    file << std::string(lengths[i], 'a' + i);
+    if (i != num_lines - 1) {
+      file << (i % 2 ? "\r\n" : "\n");
+    }
+  }
+  file.close();
+  for (int in_memory = 0; in_memory < 2; ++in_memory) {
+    Reader reader(long_file, 1, in_memory);
+    for (int k = 0; k < 2; ++k) {
+      for (int i = 0; i < num_lines; ++i) {
+        StringList* samples = reader.Samples();
+        ASSERT_EQ(samples->size(), 1);
+        EXPECT_EQ((*samples)[0], std::string(lengths[i], 'a' + i));
+      }
+      EXPECT_EQ(reader.epoch(), k + 1);
+    }
+    EXPECT_EQ(reader.max_line_length(), 5 * kBuffer);
+  }
+}
+
+TEST(ReaderFormatTest, WindowsFormatWithoutLastNewline) {
+  const std::string windows_file = "/tmp/reader-test-windows.txt";
+  std::ofstream file(windows_file.c_str());
+  file << "apple\r\nbanana\r\ncat";
+  file.close();
+  Reader reader(windows_file, 3, true);
+  f2m::StringPieceList *views = reader.SampleViews();
+  EXPECT_EQ((*views)[0].ToString(), std::string("apple"));
+  EXPECT_EQ((*views)[1].ToString(), std::string("banana"));
+  EXPECT_EQ((*views)[2].ToString(), std::string("cat"));
+  // the byte after the last view is always readable.
+  EXPECT_EQ((*views)[2].data()[3], '\0');
+  // return to the head of the file.
+  views = reader.SampleViews();
+  EXPECT_EQ((*views)[0].ToString(), std::string("apple"));
+}
+
+// Write the lines to a gzip file, which is read by the background
+// thread of Reader in blocks of 4 MB.
+void WriteGzipLines(const std::string& name, 
+                    const std::vector<std::string>& lines) {
+  gzFile file = gzopen(name.c_str(), "wb1");
+  ASSERT_TRUE(file != NULL);
+  for (size_t i = 0; i < lines.size(); ++i) {
+    gzwrite(file, lines[i].data(), lines[i].size());
+    if (i != lines.size() - 1) {
+      gzwrite(file, (i % 3 ? "\n" : "\r\n"), (i % 3 ? 1 : 2));
+    }
+  }
+  gzclose(file);
+}
+
+// Many lines cross the blocks, one line is longer than a block,
+// and the last line does not end with '\n'.
+TEST(ReaderCompressedTest, GzipLinesAcrossBlocks) {
+  const std::string gzip_file = "/tmp/reader-test.txt.gz";
+  std::vector<std::string> lines;
+  uint64 total = 0;
+  for (int i = 0; total < 12 * 1024 * 1024; ++i) {
+    int length = (i == 100) ? 5 * 1024 * 1024 : (i * 7919) % 2000;
+    lines.push_back(StringPrintf("%d:", i) + std::string(length, 'a' + i % 26));
+    total += lines.back().size() + 1;
+  }
+  WriteGzipLines(gzip_file, lines);
+  for (int in_memory = 0; in_memory < 2; ++in_memory) {
+    Reader reader(gzip_file, 1000, in_memory);
+    for (int epoch = 0; epoch < 2; ++epoch) {
+      std::vector<std::string> result;
+      while (reader.epoch() == epoch) {
+        StringList* samples = reader.Samples();
+        result.insert(result.end(), samples->begin(), samples->end());
+      }
+      EXPECT_TRUE(result == lines);
+    }
+    EXPECT_EQ(reader.max_line_length(), lines[100].size());
+  }
+}
+
+// A compressed file is not split, and shard 0 reads all of it.
+TEST(ReaderCompressedTest, GzipShards) {
+  const std::string gzip_file = "/tmp/reader-test-shard.txt.gz";
+  std::vector<std::string> lines(testdata, testdata + num_data);
+  WriteGzipLines(gzip_file, lines);
+  for (int in_memory = 0; in_memory < 2; ++in_memory) {
+    for (int shard = 0; shard < 3; ++shard) {
+      Reader reader(gzip_file, 10, in_memory, shard, 3);
+      for (int epoch = 0; epoch < 2; ++epoch) {
+        f2m::StringPieceList* views = reader.SampleViews();
+        EXPECT_EQ(reader.epoch(), epoch + 1);
+        ASSERT_EQ(views->size(), shard == 0 ? num_data : 0);
+        for (size_t i = 0; i < views->size(); ++i) {
+          EXPECT_EQ((*views)[i].ToString(), testdata[i]);
+        }
+      }
+    }
+  }
+}
+
+// Append lines to data until it reaches the end, and the last line
+// ends with the terminator at the end.
+void AppendLinesUntil(uint64 end, const std::string& terminator, 
+                      std::string* data, std::vector<std::string>* lines) {
+  while (data->size() + 2000 < end) {
+    int length = (lines->size() * 7919) % 1000;
+    lines->push_back(StringPrintf("%d:", static_cast<int>(lines->size())) + 
+                     std::string(length, 'x'));
+    *data += lines->back() + "\n";
+  }
+  lines->push_back(std::string(end - data->size() - terminator.size(), 'y'));
+  *data += lines->back() + terminator;
+}
+
+// The disk mode reads blocks of 16 MB. The first block ends right
+// after a '\n', the second block ends between '\r' and '\n', and
+// the last line at the end of the file has no '\n'.
+TEST(ReaderFormatTest, DiskBlockBoundaries) {
+  const std::string block_file = "/tmp/reader-test-block.txt";
+  const uint64 kBlock = 16 * 1024 * 1024;
+  std::string data;
+  std::vector<std::string> lines;
+  AppendLinesUntil(kBlock, "\n", &data, &lines);
+  AppendLinesUntil(2 * kBlock + 1, "\r\n", &data, &lines);
+  AppendLinesUntil(2 * kBlock + 5000, "", &data, &lines);
+  ASSERT_EQ(data[kBlock - 1], '\n');
+  ASSERT_EQ(data[2 * kBlock - 1], '\r');
+  std::ofstream file(block_file.c_str(), std::ios::binary);
+  file << data;
+  file.close();
+  for (int in_memory = 0; in_memory < 2; ++in_memory) {
+    Reader reader(block_file, 1000, in_memory);
+    for (int epoch = 0; epoch < 2; ++epoch) {
+      std::vector<std::string> result;
+      while (reader.epoch() == epoch) {
+        StringList* samples = reader.Samples();
+        result.insert(result.end(), samples->begin(), samples->end());
+      }
+      EXPECT_TRUE(result == lines);
+    }
+  }
+  // Two shards split the file at the start of a line.
+  std::vector<std::string> result;
+  for (int shard = 0; shard < 2; ++shard) {
+    Reader reader(block_file, 1000, false, shard, 2);
+    StringPiece line;
+    while (reader.ReadLine(&line)) {
+      result.push_back(line.ToString());
+    }
+  }
+  EXPECT_TRUE(result == lines);
+}
+
+const std::string files_dir = "/tmp/reader-test-files";
+
+// Write num_files files to files_dir, and return the lines of each.
+// File 1 is empty, file 2 is gzip, and file 3 has no last '\n'.
+std::vector<std::vector<std::string> > WriteFiles(int num_files) {
+  EXPECT_EQ(system(("rm -rf " + files_dir + " && mkdir -p " + files_dir + 
+                   "/subdir").c_str()), 0);
+  std::ofstream hidden((files_dir + "/.hidden").c_str());
+  hidden << "hidden\n";
+  hidden.close();
+  std::vector<std::vector<std::string> > lines(num_files);
+  for (int i = 0; i < num_files; ++i) {
+    int num_lines = (i == 1) ? 0 : 10 + i * 7;
+    for (int n = 0; n < num_lines; ++n) {
+      lines[i].push_back(StringPrintf("%d-%d", i, n));
+    }
+    std::string name = StringPrintf("%s/part-%02d", files_dir.c_str(), i);
+    if (i == 2) {
+      WriteGzipLines(name, lines[i]);
+      continue;
+    }
+    std::ofstream file(name.c_str());
+    for (int n = 0; n < num_lines; ++n) {
+      file << lines[i][n] << ((i == 3 && n == num_lines - 1) ? "" : "\n");
+    }
+  }
+  return lines;
+}
+
+TEST(ReaderFilesTest, ListFiles) {
+  WriteFiles(12);
+  StringList files;
+  // A directory: the hidden file and the sub-directory are skipped.
+  f2m::ListFiles(files_dir, &files);
+  ASSERT_EQ(files.size(), 12);
+  for (int i = 0; i < 12; ++i) {
+    EXPECT_EQ(files[i], StringPrintf("%s/part-%02d", files_dir.c_str(), i));
+  }
+  // A pattern, and a list of items.
+  f2m::ListFiles(files_dir + "/part-1*", &files);
+  ASSERT_EQ(files.size(), 2);
+  EXPECT_EQ(files[1], files_dir + "/part-11");
+  f2m::ListFiles(files_dir + "/part-03," + files_dir + "/part-0[12]", &files);
+  ASSERT_EQ(files.size(), 3);
+  EXPECT_EQ(files[0], files_dir + "/part-03");
+  EXPECT_EQ(files[1], files_dir + "/part-01");
+  EXPECT_EQ(files[2], files_dir + "/part-02");
+  // A file is not checked here.
+  f2m::ListFiles("/tmp/no-such-file", &files);
+  ASSERT_EQ(files.size(), 1);
+  EXPECT_DEATH(f2m::ListFiles(files_dir + "/no-such-*", &files), 
+               "No file matches");
+  EXPECT_DEATH(f2m::ListFiles(files_dir + "/subdir", &files), 
+               "No file in directory");
+}
+
+// The files are read as one stream, and the lines of two files 
+// are never joined.
+TEST(ReaderFilesTest, OneStream) {
+  std::vector<std::vector<std::string> > lines = WriteFiles(5);
+  std::vector<std::string> expected;
+  for (size_t i = 0; i < lines.size(); ++i) {
+    expected.insert(expected.end(), lines[i].begin(), lines[i].end());
+  }
+  for (int in_memory = 0; in_memory < 2; ++in_memory) {
+    Reader reader(files_dir, 7, in_memory);
+    for (int epoch = 0; epoch < 3; ++epoch) {
+      std::vector<std::string> result;
+      while (reader.epoch() == epoch) {
+        StringList* samples = reader.Samples();
+        result.insert(result.end(), samples->begin(), samples->end());
+      }
+      EXPECT_TRUE(result == expected);
+    }
+  }
+}
+
+// Every file is read by exactly one shard as a whole.
+TEST(ReaderFilesTest, ShardsReadWholeFiles) {
+  const int num_files = 6;
+  std::vector<std::vector<std::string> > lines = WriteFiles(num_files);
+  for (int in_memory = 0; in_memory < 2; ++in_memory) {
+    for (int num_shards = 1; num_shards <= 8; ++num_shards) {
+      std::vector<int> shard_of_file(num_files, -1);
+      std::vector<int> count(num_files, 0);
+      for (int shard = 0; shard < num_shards; ++shard) {
+        Reader reader(files_dir + "/part-*", 1, in_memory, shard, num_shards);
+        StringPiece line;
+        while (reader.ReadLine(&line)) {
+          int file = atoi(line.data());
+          EXPECT_TRUE(shard_of_file[file] == -1 || 
+                      shard_of_file[file] == shard);
+          shard_of_file[file] = shard;
+          count[file]++;
+        }
+      }
+      for (int i = 0; i < num_files; ++i) {
+        EXPECT_EQ(count[i], lines[i].size());
+      }
+      // The 5 non-empty files are spread over the shards.
+      std::vector<int> shards(shard_of_file);
+      std::sort(shards.begin(), shards.end());
+      int num_used = std::unique(shards.begin(), shards.end()) - 
+                     shards.begin() - 1;  // -1 for the empty file
+      EXPECT_EQ(num_used, std::min(num_shards, num_files - 1));
+    }
+  }
+}
@@ -0,0 +1,86 @@
+/*
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or (at
+your option) any later version.
+
+This program is distributed in the hope that it will be useful, but
+WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+02110-1301, USA.
+*/
+
+/*
+Copyright (c) 2016 by contributors.
+Author: Chao Ma (mctt90@gmail.com)
+
+Unit Test for SignalQueue (signal_queue.h)
+*/
+
+#include "gtest/gtest.h"
+
+#include <pthread.h>
+
+#include "src/reader/signal_queue.h"
+
+using f2m::SignalQueue;
+
+const int num_items = 10000;
+const int num_producers = 4;
+
+TEST(SignalQueueTest, FIFO) {
+  SignalQueue<int> queue(3);
+  EXPECT_TRUE(queue.Push(1));
+  EXPECT_TRUE(queue.Push(2));
+  EXPECT_TRUE(queue.Push(3));
+  EXPECT_EQ(queue.Size(), 3);
+  int item = 0;
+  for (int i = 1; i <= 3; ++i) {
+    EXPECT_TRUE(queue.Pop(&item));
+    EXPECT_EQ(item, i);
+  }
+  EXPECT_EQ(queue.Size(), 0);
+}
+
+TEST(SignalQueueTest, Close) {
+  SignalQueue<int> queue(3);
+  queue.Push(1);
+  queue.Close();
+  EXPECT_FALSE(queue.Push(2));
+  int item = 0;
+  EXPECT_TRUE(queue.Pop(&item));  // remaining item
+  EXPECT_EQ(item, 1);
+  EXPECT_FALSE(queue.Pop(&item));
+}
+
+void* Produce(void* queue) {
+  SignalQueue<int>* q = reinterpret_cast<SignalQueue<int>*>(queue);
+  for (int i = 0; i < num_items; ++i) {
+    q->Push(1);
+  }
+  return NULL;
+}
+
+TEST(SignalQueueTest, MultiThread) {
+  // A small queue blocks the producers frequently.
+  SignalQueue<int> queue(2);
+  pthread_t threads[num_producers];
+  for (int i = 0; i < num_producers; ++i) {
+    pthread_create(&threads[i], NULL, Produce, &queue);
+  }
+  int sum = 0, item = 0;
+  for (int i = 0; i < num_items * num_producers; ++i) {
+    EXPECT_TRUE(queue.Pop(&item));
+    sum += item;
+  }
+  for (int i = 0; i < num_producers; ++i) {
+    pthread_join(threads[i], NULL);
+  }
+  EXPECT_EQ(sum, num_items * num_producers);
+  EXPECT_EQ(queue.Size(), 0);
+}
@@ -0,0 +1,152 @@
+/*
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or (at
+your option) any later version.
+
+This program is distributed in the hope that it will be useful, but
+WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+02110-1301, USA.
+*/
+
+/*
+Copyright (c) 2016 by contributors.
+Author: Chao Ma (mctt90@gmail.com)
+
+Unit Test for SIMD kernels (simd.h and simd.cc)
+We check the kernels of every level supported by the CPU against
+the scalar kernels, for all sizes around the SIMD widths.
+*/
+
+#include "gtest/gtest.h"
+
+#include "src/common/simd.h"
+#include "src/common/common.h"
+#include "src/common/data_structure.h"
+
+#include <stdlib.h>
+#include <cmath>
+#include <vector>
+
+namespace f2m {
+
+const int max_size = 70;
+
+TEST(SIMDTest, DetectLevel) {
+  SIMDLevel best = DetectSIMDLevel();
+  EXPECT_EQ(GetSIMDKernels().level, best);
+  EXPECT_EQ(GetSIMDKernels(kScalar).level, kScalar);
+  // An unsupported level falls back to the best one.
+  EXPECT_LE(GetSIMDKernels(kAVX512).level, best);
+  printf("SIMD level: %s\n", GetSIMDKernels().name);
+}
+
+TEST(SIMDTest, SameAsScalar) {
+  srand(0);
+  std::vector<real_t> a(max_size + 1), b(max_size + 1), y(max_size + 1);
+  for (int i = 0; i <= max_size; ++i) {
+    a[i] = rand() / static_cast<real_t>(RAND_MAX) - 0.5;
+    b[i] = rand() / static_cast<real_t>(RAND_MAX) - 0.5;
+  }
+  const SIMDKernels& scalar = GetSIMDKernels(kScalar);
+  for (int level = kSSE; level <= DetectSIMDLevel(); ++level) {
+    const SIMDKernels& kernels = GetSIMDKernels(SIMDLevel(level));
+    for (int size = 0; size <= max_size; ++size) {
+      // Start at a[1] to check the unaligned loads.
+      EXPECT_NEAR(kernels.Dot(&a[1], &b[1], size), 
+                  scalar.Dot(&a[1], &b[1], size), 1e-5) << kernels.name;
+      std::vector<real_t> expected(y);
+      scalar.Axpy(0.3, &a[1], &expected[1], size);
+      std::vector<real_t> actual(y);
+      kernels.Axpy(0.3, &a[1], &actual[1], size);
+      for (int i = 0; i <= max_size; ++i) {
+        // The values after size are not changed.
+        EXPECT_NEAR(actual[i], expected[i], 1e-6) << kernels.name;
+      }
+    }
+  }
+}
+
+TEST(SIMDTest, SparseDotSameAsScalar) {
+  srand(1);
+  const int dense_size = 1000;
+  std::vector<real_t> dense(dense_size);
+  for (int i = 0; i < dense_size; ++i) {
+    dense[i] = rand() / static_cast<real_t>(RAND_MAX) - 0.5;
+  }
+  // One row of every size from 0 to max_size.
+  std::vector<real_t> x;
+  std::vector<index_t> position;
+  std::vector<uint64> row_offset(1, 0);
+  for (int size = 0; size <= max_size; ++size) {
+    for (int i = 0; i < size; ++i) {
+      x.push_back(rand() / static_cast<real_t>(RAND_MAX) - 0.5);
+      position.push_back(rand() % dense_size);
+    }
+    row_offset.push_back(x.size());
+  }
+  const int num_rows = row_offset.size() - 1;
+  std::vector<real_t> expected(num_rows);
+  GetSIMDKernels(kScalar).SparseDot(x.data(), position.data(), 
+                                    row_offset.data(), num_rows,
+                                    dense.data(), expected.data());
+  for (int level = kSSE; level <= DetectSIMDLevel(); ++level) {
+    const SIMDKernels& kernels = GetSIMDKernels(SIMDLevel(level));
+    std::vector<real_t> actual(num_rows);
+    kernels.SparseDot(x.data(), position.data(), row_offset.data(), 
+                      num_rows, dense.data(), actual.data());
+    for (int r = 0; r < num_rows; ++r) {
+      EXPECT_NEAR(actual[r], expected[r], 1e-5) << kernels.name;
+    }
+    // A block of rows from the middle.
+    std::vector<real_t> block(num_rows, 7.0);
+    kernels.SparseDot(x.data(), position.data(), row_offset.data() + 10, 
+                      20, dense.data(), block.data() + 10);
+    for (int r = 0; r < num_rows; ++r) {
+      if (r >= 10 && r < 30) {
+        EXPECT_NEAR(block[r], expected[r], 1e-5) << kernels.name;
+      } else {
+        EXPECT_EQ(block[r], 7.0);
+      }
+    }
+  }
+}
+
+// The positions are unsigned: a position of 2^31 or more is not 
+// a negative offset. We point dense 2^31 values before a small 
+// array, so the large positions read the array.
+TEST(SIMDTest, SparseDotLargePositions) {
+  if (sizeof(void*) < 8) {
+    return;
+  }
+  const index_t base = 1U << 31;
+  std::vector<real_t> values(64);
+  std::vector<real_t> x(40);
+  std::vector<index_t> position(40);
+  for (int i = 0; i < 64; ++i) {
+    values[i] = i * 0.25;
+  }
+  real_t expected = 0;
+  for (int i = 0; i < 40; ++i) {
+    x[i] = 1 + i % 3;
+    position[i] = base + (i * 7) % 64;
+    expected += x[i] * values[(i * 7) % 64];
+  }
+  uint64 row_offset[2] = { 0, 40 };
+  const real_t* dense = values.data() - base;
+  for (int level = kScalar; level <= DetectSIMDLevel(); ++level) {
+    const SIMDKernels& kernels = GetSIMDKernels(SIMDLevel(level));
+    real_t result = 0;
+    kernels.SparseDot(x.data(), position.data(), row_offset, 1, 
+                      dense, &result);
+    EXPECT_NEAR(result, expected, 1e-3) << kernels.name;
+  }
+}
+
+} // namespace f2m
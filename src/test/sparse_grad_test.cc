@@ -0,0 +1,103 @@
+/*
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or (at
+your option) any later version.
+
+This program is distributed in the hope that it will be useful, but
+WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+02110-1301, USA.
+*/
+
+/*
+Copyright (c) 2016 by contributors.
+Author: Chao Ma (mctt90@gmail.com)
+
+Unit Test for SparseGrad and GradIndex (data_structure.h)
+*/
+
+#include "gtest/gtest.h"
+
+#include "src/common/data_structure.h"
+#include "src/common/common.h"
+
+#include <map>
+#include <utility>
+
+namespace f2m {
+
+TEST(GradIndexTest, FindOrInsert) {
+  GradIndex index;
+  for (uint32 i = 0; i < 10000; ++i) {
+    EXPECT_EQ(index.FindOrInsert(i * 7919ULL, i), i);
+  }
+  EXPECT_EQ(index.size(), 10000);
+  // The keys are kept after the table grows.
+  for (uint32 i = 0; i < 10000; ++i) {
+    EXPECT_EQ(index.FindOrInsert(i * 7919ULL, 0), i);
+  }
+  EXPECT_EQ(index.size(), 10000);
+  index.Clear();
+  EXPECT_EQ(index.size(), 0);
+  EXPECT_EQ(index.FindOrInsert(7919, 5), 5);
+  EXPECT_EQ(index.FindOrInsert(7919, 6), 5);
+}
+
+TEST(SparseGradTest, MergeDuplicates) {
+  const int k = 4;
+  SparseGrad grad;
+  grad.Clear(k);
+  for (int i = 0; i < 100; ++i) {
+    grad.AddW(i % 10, 1.0);
+    real_t* v = grad.GradV(grad.AddV(i % 10, i % 3));
+    for (int j = 0; j < k; ++j) {
+      v[j] += j;
+    }
+  }
+  ASSERT_EQ(grad.size_w(), 10);
+  ASSERT_EQ(grad.size_v(), 30);
+  for (size_t n = 0; n < grad.size_w(); ++n) {
+    EXPECT_EQ(grad.position_w[n], n);
+    EXPECT_EQ(grad.grad_w[n], 10.0);
+  }
+  // Check the sum of every (position, field) against a map.
+  std::map<std::pair<index_t, int>, int> count;
+  for (int i = 0; i < 100; ++i) {
+    count[std::make_pair(i % 10, i % 3)]++;
+  }
+  for (size_t n = 0; n < grad.size_v(); ++n) {
+    int c = count[std::make_pair(grad.position_v[n], grad.field_v[n])];
+    for (int j = 0; j < k; ++j) {
+      EXPECT_EQ(grad.GradV(n)[j], c * j);
+    }
+  }
+}
+
+TEST(SparseGradTest, ReuseAfterClear) {
+  SparseGrad grad;
+  for (int batch = 0; batch < 5; ++batch) {
+    grad.Clear(2);
+    EXPECT_EQ(grad.size_w(), 0);
+    EXPECT_EQ(grad.size_v(), 0);
+    for (int i = 0; i < 5000; ++i) {
+      grad.AddW(batch * 10000 + i, 1.0);
+      grad.AddW(batch * 10000 + i, 1.0);
+      size_t n = grad.AddV(batch * 10000 + i);
+      EXPECT_EQ(n, i);
+      // A new gradient is zero.
+      EXPECT_EQ(grad.GradV(n)[0], 0);
+      EXPECT_EQ(grad.GradV(n)[1], 0);
+    }
+    EXPECT_EQ(grad.size_w(), 5000);
+    EXPECT_EQ(grad.size_v(), 5000);
+    EXPECT_EQ(grad.grad_w[4999], 2.0);
+  }
+}
+
+} // namespace f2m
@@ -0,0 +1,67 @@
+/*
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or (at
+your option) any later version.
+
+This program is distributed in the hope that it will be useful, but
+WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+02110-1301, USA.
+*/
+
+/*
+Copyright (c) 2016 by contributors.
+Author: Chao Ma (mctt90@gmail.com)
+
+Unit Test for ThreadPool (thread_pool.h)
+*/
+
+#include "gtest/gtest.h"
+
+#include "src/common/thread_pool.h"
+#include "src/common/common.h"
+
+#include <vector>
+
+namespace f2m {
+
+static void AddOne(void* arg, int begin, int end) {
+  int* count = reinterpret_cast<int*>(arg);
+  for (int i = begin; i < end; ++i) {
+    ++count[i];
+  }
+}
+
+TEST(ThreadPoolTest, EveryItemOnce) {
+  const int size = 10007;
+  for (int num_threads = 1; num_threads <= 4; ++num_threads) {
+    ThreadPool pool(num_threads);
+    EXPECT_EQ(pool.num_threads(), num_threads);
+    std::vector<int> count(size, 0);
+    // Many loops on the same threads, with different grains.
+    for (int grain = 1; grain <= 2048; grain *= 2) {
+      pool.ParallelFor(0, size, grain, AddOne, count.data());
+    }
+    for (int i = 0; i < size; ++i) {
+      EXPECT_EQ(count[i], 12);
+    }
+  }
+}
+
+TEST(ThreadPoolTest, SubRange) {
+  ThreadPool pool(3);
+  std::vector<int> count(100, 0);
+  pool.ParallelFor(10, 90, 7, AddOne, count.data());
+  pool.ParallelFor(50, 50, 7, AddOne, count.data());
+  for (int i = 0; i < 100; ++i) {
+    EXPECT_EQ(count[i], (i >= 10 && i < 90) ? 1 : 0);
+  }
+}
+
+} // namespace f2m
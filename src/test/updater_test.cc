@@ -0,0 +1,300 @@
+/*
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or (at
+your option) any later version.
+
+This program is distributed in the hope that it will be useful, but
+WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+02110-1301, USA.
+*/
+
+/*
+Copyright (c) 2016 by contributors.
+Author: Chao Ma (mctt90@gmail.com)
+
+Unit Test for the updaters (sgd_updater.h, adagrad_updater.h, and
+ftrl_updater.h). We apply the gradients to small models in all the
+layouts, and check the results with the formulas.
+*/
+
+#include "gtest/gtest.h"
+
+#include "src/updater/adagrad_updater.h"
+#include "src/updater/ftrl_updater.h"
+#include "src/updater/sgd_updater.h"
+#include "src/common/common.h"
+#include "src/common/data_structure.h"
+
+#include <stdlib.h>
+#include <cmath>
+#include <vector>
+
+namespace f2m {
+
+const index_t feature_num = 10;
+const int field_num = 3;
+const int k = 3;
+const real_t init_v = 0.5;
+
+/* The gradient of w of feature 1 and 3 (twice), and v of 
+   feature 1 (field 2). The batch has two samples. */
+
+void InitGrad(SparseGrad* grad, int size_k) {
+  grad->Clear(size_k);
+  grad->AddW(1, 0.4);
+  grad->AddW(3, -0.2);
+  grad->AddW(3, -0.2);
+  real_t* g = grad->GradV(grad->AddV(1, 2));
+  for (int j = 0; j < k; ++j) {
+    g[j] = 0.2 * (j + 1);
+  }
+}
+
+/* Check the model after one update. new_w(w, g) and new_v(v, g)
+   are the expected values of a parameter, where g is the average
+   gradient. */
+
+template <typename Formula>
+void CheckUpdate(Updater* updater, const Formula& formula) {
+  for (int layout = 0; layout < 3; ++layout) {
+    bool sparse = layout == 1;
+    bool aligned = layout == 2;
+    Model model(0, FFM, feature_num, k, field_num, sparse, aligned,
+                updater->num_state());
+    for (int f = 0; f < field_num; ++f) {
+      for (int j = 0; j < k; ++j) {
+        model.MutableV(1, f)[j] = init_v;
+      }
+    }
+    SparseGrad grad;
+    InitGrad(&grad, model.GetPaddedK());
+    updater->Update(grad, 2, &model);
+    EXPECT_FLOAT_EQ(*model.W(1), formula.NewW(0, 0.2));
+    EXPECT_FLOAT_EQ(*model.W(3), formula.NewW(0, -0.2));
+    EXPECT_EQ(*model.W(2), 0);
+    const real_t* v = model.V(1, 2);
+    for (int j = 0; j < k; ++j) {
+      EXPECT_FLOAT_EQ(v[j], formula.NewV(init_v, 0.1 * (j + 1)));
+    }
+    // The padding stays zero, and the other fields do not change.
+    for (int j = k; j < model.GetPaddedK(); ++j) {
+      EXPECT_EQ(v[j], 0);
+    }
+    EXPECT_EQ(model.V(1, 0)[0], init_v);
+    EXPECT_EQ(model.V(1, 1)[0], init_v);
+  }
+}
+
+struct SGDFormula {
+  real_t NewW(real_t w, real_t g) const { return w - 0.1 * g; }
+  real_t NewV(real_t v, real_t g) const { return v - 0.1 * g; }
+};
+
+TEST(UpdaterTest, SGD) {
+  SGDUpdater updater(0.1);
+  EXPECT_EQ(updater.num_state(), 0);
+  CheckUpdate(&updater, SGDFormula());
+}
+
+struct AdaGradFormula {
+  real_t NewW(real_t w, real_t g) const { 
+    return w - 0.1 * g / sqrt(1 + g * g); 
+  }
+  real_t NewV(real_t v, real_t g) const { return NewW(v, g); }
+};
+
+TEST(UpdaterTest, AdaGrad) {
+  AdaGradUpdater updater(0.1);
+  EXPECT_EQ(updater.num_state(), 1);
+  CheckUpdate(&updater, AdaGradFormula());
+}
+
+/* FTRL from z = 0 and n = 0 (or the z of the initial v). */
+
+struct FTRLFormula {
+  real_t alpha, beta, l1, l2;
+  real_t Step(real_t w, real_t g, real_t l1_) const {
+    real_t z = 0;
+    if (w != 0) {
+      z = -w * (beta / alpha + l2) - (w > 0 ? 1 : -1) * l1_;
+    }
+    real_t sigma = fabs(g) / alpha;
+    z += g - sigma * w;
+    if (fabs(z) <= l1_) {
+      return 0;
+    }
+    return -(z - (z > 0 ? 1 : -1) * l1_) / ((beta + fabs(g)) / alpha + l2);
+  }
+  real_t NewW(real_t w, real_t g) const { return Step(w, g, l1); }
+  real_t NewV(real_t v, real_t g) const { return Step(v, g, 0); }
+};
+
+TEST(UpdaterTest, FTRL) {
+  FTRLUpdater updater(0.1, 1.0, 0.5, 0.2);
+  EXPECT_EQ(updater.num_state(), 2);
+  FTRLFormula formula = { 0.1, 1.0, 0.5, 0.2 };
+  CheckUpdate(&updater, formula);
+  // Without L1, w does not become zero.
+  FTRLUpdater no_l1(0.1, 1.0, 0, 0.2);
+  FTRLFormula formula_no_l1 = { 0.1, 1.0, 0, 0.2 };
+  EXPECT_NE(formula_no_l1.NewW(0, 0.2), 0);
+  CheckUpdate(&no_l1, formula_no_l1);
+}
+
+TEST(UpdaterTest, FTRLSparsity) {
+  // The gradients of w are less than l1, so w stays zero, 
+  // while the latent vector moves.
+  FTRLUpdater updater(0.1, 1.0, 1.0, 0);
+  Model model(0, FFM, feature_num, k, field_num, false, false, 
+              updater.num_state());
+  for (int j = 0; j < k; ++j) {
+    model.MutableV(1, 2)[j] = init_v;
+  }
+  SparseGrad grad;
+  for (int step = 0; step < 3; ++step) {
+    InitGrad(&grad, model.GetPaddedK());
+    updater.Update(grad, 2, &model);
+  }
+  EXPECT_EQ(*model.W(1), 0);
+  EXPECT_EQ(*model.W(3), 0);
+  EXPECT_NE(model.V(1, 2)[0], 0);
+  EXPECT_LT(model.V(1, 2)[0], init_v);
+}
+
+TEST(UpdaterTest, FTRLZeroGradient) {
+  // A zero gradient on a new parameter (n = 0) keeps w finite, 
+  // with beta > 0, or with beta = 0 and l2 > 0.
+  FTRLUpdater with_beta(0.1, 1.0, 0, 0);
+  FTRLUpdater with_l2(0.1, 0, 0, 0.5);
+  Updater* updaters[] = { &with_beta, &with_l2 };
+  for (int u = 0; u < 2; ++u) {
+    Model model(0.3, FM, feature_num, k, 0, false, false, 2);
+    SparseGrad grad;
+    grad.Clear(model.GetPaddedK());
+    grad.AddW(1, 0);
+    grad.AddW(2, 0);
+    real_t* g = grad.GradV(grad.AddV(1));
+    for (int j = 0; j < k; ++j) {
+      g[j] = 0;
+    }
+    updaters[u]->Update(grad, 1, &model);
+    EXPECT_NEAR(*model.W(1), 0.3, 1e-6);
+    EXPECT_NEAR(*model.W(2), 0.3, 1e-6);
+    for (int j = 0; j < k; ++j) {
+      EXPECT_NEAR(model.V(1)[j], 0.3, 1e-6);
+    }
+  }
+  // beta = 0 and l2 = 0 would divide by zero.
+  EXPECT_DEATH(FTRLUpdater(0.1, 0, 0, 0), "");
+}
+
+/* A random batch, which touches a few features. */
+
+void RandomGrad(SparseGrad* grad, int size_k) {
+  grad->Clear(size_k);
+  for (int n = 0; n < 3; ++n) {
+    index_t pos = rand() % feature_num;
+    grad->AddW(pos, rand() / static_cast<real_t>(RAND_MAX) - 0.5);
+    real_t* g = grad->GradV(grad->AddV(pos, rand() % field_num));
+    for (int j = 0; j < k; ++j) {
+      g[j] = rand() / static_cast<real_t>(RAND_MAX) - 0.5;
+    }
+  }
+}
+
+/* The naive L2: decay all the parameters in every step, where
+   rate(p) is the learning rate of the parameter p. */
+
+template <typename Rate>
+void NaiveDecay(Model* model, real_t l2, const Rate& rate) {
+  for (index_t i = 0; i < feature_num; ++i) {
+    real_t* w = model->MutableW(i);
+    *w *= 1 - rate(model, i, -1, 0) * l2;
+    for (int f = 0; f < field_num; ++f) {
+      real_t* v = model->MutableV(i, f);
+      for (int j = 0; j < k; ++j) {
+        v[j] *= 1 - rate(model, i, f, j) * l2;
+      }
+    }
+  }
+}
+
+struct SGDRate {
+  real_t operator()(Model* model, index_t i, int f, int j) const {
+    return 0.1;
+  }
+};
+
+struct AdaGradRate {
+  real_t operator()(Model* model, index_t i, int f, int j) const {
+    real_t n = f < 0 ? *model->MutableStateW(i, 0) 
+                     : model->MutableStateV(i, f, 0)[j];
+    return 0.1 / sqrt(1 + n);
+  }
+};
+
+/* The lazy updater (l2 > 0) gives the same model as the decay of
+   all the parameters in every step followed by the updater without
+   L2, after Flush(). */
+
+template <typename Rate>
+void CheckLazyL2(Updater* lazy, Updater* plain, const Rate& rate,
+                 bool sparse, bool aligned) {
+  const real_t l2 = 0.5;
+  Model lazy_model(0, FFM, feature_num, k, field_num, sparse, aligned,
+                   lazy->num_state(), lazy->need_step());
+  Model naive_model(0, FFM, feature_num, k, field_num, false, aligned,
+                    plain->num_state(), plain->need_step());
+  EXPECT_TRUE(lazy->need_step());
+  EXPECT_FALSE(plain->need_step());
+  for (index_t i = 0; i < feature_num; ++i) {
+    *lazy_model.MutableW(i) = *naive_model.MutableW(i) = init_v;
+    for (int f = 0; f < field_num; ++f) {
+      for (int j = 0; j < k; ++j) {
+        lazy_model.MutableV(i, f)[j] = init_v;
+        naive_model.MutableV(i, f)[j] = init_v;
+      }
+    }
+  }
+  SparseGrad grad;
+  srand(1);
+  for (int step = 0; step < 50; ++step) {
+    RandomGrad(&grad, lazy_model.GetPaddedK());
+    lazy->Update(grad, 1, &lazy_model);
+    NaiveDecay(&naive_model, l2, rate);
+    plain->Update(grad, 1, &naive_model);
+  }
+  lazy->Flush(&lazy_model);
+  for (index_t i = 0; i < feature_num; ++i) {
+    EXPECT_EQ(lazy_model.LastStep(i), 50);
+    EXPECT_NEAR(*lazy_model.W(i), *naive_model.W(i), 1e-5);
+    for (int f = 0; f < field_num; ++f) {
+      for (int j = 0; j < k; ++j) {
+        EXPECT_NEAR(lazy_model.V(i, f)[j], naive_model.V(i, f)[j], 1e-5);
+      }
+    }
+  }
+}
+
+TEST(UpdaterTest, LazyL2) {
+  for (int layout = 0; layout < 3; ++layout) {
+    bool sparse = layout == 1;
+    bool aligned = layout == 2;
+    SGDUpdater lazy_sgd(0.1, 0.5);
+    SGDUpdater plain_sgd(0.1);
+    CheckLazyL2(&lazy_sgd, &plain_sgd, SGDRate(), sparse, aligned);
+    AdaGradUpdater lazy_adagrad(0.1, 1.0, 0.5);
+    AdaGradUpdater plain_adagrad(0.1);
+    CheckLazyL2(&lazy_adagrad, &plain_adagrad, AdaGradRate(), 
+                sparse, aligned);
+  }
+}
+
+} // namespace f2m
@@ -0,0 +1,157 @@
+/*
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or (at
+your option) any later version.
+
+This program is distributed in the hope that it will be useful, but
+WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+02110-1301, USA.
+*/
+
+/* 
+Copyright (c) 2016 by contributors.
+Author: Chao Ma (mctt90@gmail.com)
+
+This file is the implementation of hogwild.h
+*/
+
+#include "src/train/hogwild.h"
+
+#include <sys/time.h>
+
+#include "src/loss/ffm_loss.h"
+#include "src/loss/fm_loss.h"
+#include "src/loss/logit_loss.h"
+#include "src/reader/reader.h"
+
+namespace f2m {
+
+static double GetTime() {
+  struct timeval tv;
+  gettimeofday(&tv, NULL);
+  return tv.tv_sec + tv.tv_usec * 1e-6;
+}
+
+HogwildTrainer::HogwildTrainer(const std::string& filename,
+                               Model* model,
+                               Updater* updater,
+                               const HogwildOptions& options)
+  : filename_(filename),
+    model_(model),
+    updater_(updater),
+    options_(options),
+    num_samples_(0),
+    seconds_(0) {
+  CHECK_NOTNULL(model_);
+  CHECK_NOTNULL(updater_);
+  CHECK_GE(model_->GetNumState(), updater_->num_state());
+  if (updater_->need_step()) {
+    CHECK(model_->HasStep());
+  }
+  CHECK_GT(options_.num_threads, 0);
+  CHECK_GT(options_.batch_size, 0);
+  CHECK_GT(options_.num_epochs, 0);
+  if (options_.hash_bits > 0) {
+    CHECK_LE(options_.hash_bits, 31);
+    CHECK_GE(model_->GetFeatureNum(), 1U << options_.hash_bits);
+  }
+  // Check the type now, instead of in the threads.
+  scoped_ptr<Loss> loss(NewLoss());
+}
+
+void HogwildTrainer::Train() {
+  std::vector<Worker> workers(options_.num_threads);
+  std::vector<pthread_t> threads(options_.num_threads);
+  double start = GetTime();
+  for (int i = 0; i < options_.num_threads; ++i) {
+    workers[i].trainer = this;
+    workers[i].shard_id = i;
+    workers[i].num_samples = 0;
+    if (pthread_create(&threads[i], NULL, WorkerThread, &workers[i]) != 0) {
+      LOG(FATAL) << "Cannot create training thread.";
+    }
+  }
+  num_samples_ = 0;
+  for (int i = 0; i < options_.num_threads; ++i) {
+    pthread_join(threads[i], NULL);
+    num_samples_ += workers[i].num_samples;
+  }
+  // Apply the lazy updates, e.g., the L2 decay.
+  updater_->Flush(model_);
+  seconds_ = GetTime() - start;
+}
+
+void* HogwildTrainer::WorkerThread(void* worker) {
+  Worker* w = reinterpret_cast<Worker*>(worker);
+  w->trainer->WorkerLoop(w);
+  return NULL;
+}
+
+void HogwildTrainer::WorkerLoop(Worker* worker) {
+  Reader reader(filename_, options_.batch_size, options_.in_memory,
+                worker->shard_id, options_.num_threads);
+  scoped_ptr<Parser> parser(NewParser());
+  scoped_ptr<Loss> loss(NewLoss());
+  DataMatrix matrix(options_.batch_size);
+  SparseGrad grad;
+  while (reader.epoch() < options_.num_epochs) {
+    parser->Parse(reader.SampleViews(), &matrix);
+    if (matrix.size() == 0) {
+      // an empty shard
+      continue;
+    }
+    loss->CalcGrad(matrix, *model_, &grad);
+    // Hogwild: no lock around the update
+    updater_->Update(grad, matrix.size(), model_);
+    worker->num_samples += matrix.size();
+  }
+}
+
+real_t HogwildTrainer::Evaluate(const std::string& filename) {
+  Reader reader(filename, options_.batch_size, options_.in_memory);
+  scoped_ptr<Parser> parser(NewParser());
+  ThreadPool pool(options_.num_threads);
+  scoped_ptr<Loss> loss(NewLoss(&pool));
+  DataMatrix matrix(options_.batch_size);
+  std::vector<real_t> pred;
+  double sum = 0;
+  uint64 count = 0;
+  while (reader.epoch() < 1) {
+    parser->Parse(reader.SampleViews(), &matrix);
+    loss->Predict(matrix, *model_, &pred);
+    sum += loss->Evaluate(pred, matrix.y);
+    count += matrix.size();
+  }
+  return count > 0 ? sum / count : 0;
+}
+
+Parser* HogwildTrainer::NewParser() const {
+  if (options_.hash_bits > 0) {
+    return new HashFFMParser(options_.hash_bits);
+  }
+  return model_->GetType() == FFM ? new FFMParser : new Parser;
+}
+
+Loss* HogwildTrainer::NewLoss(ThreadPool* pool) const {
+  switch (model_->GetType()) {
+    case LR:
+      return new LogitLoss(false, pool);
+    case FM:
+      return new FMLoss;
+    case FFM:
+      return new FFMLoss;
+    default:
+      LOG(FATAL) << "HogwildTrainer does not support the model type: " 
+                 << model_->GetType();
+  }
+  return NULL;
+}
+
+} // namespace f2m
@@ -0,0 +1,150 @@
+/*
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or (at
+your option) any later version.
+
+This program is distributed in the hope that it will be useful, but
+WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+02110-1301, USA.
+*/
+
+/* 
+Copyright (c) 2016 by contributors.
+Author: Chao Ma (mctt90@gmail.com)
+
+This file defines HogwildTrainer, which trains a model with
+lock-free parallel SGD.
+*/
+
+#ifndef F2M_TRAIN_HOGWILD_H_
+#define F2M_TRAIN_HOGWILD_H_
+
+#include <pthread.h>
+
+#include <string>
+#include <vector>
+
+#include "src/common/common.h"
+#include "src/common/data_structure.h"
+#include "src/common/thread_pool.h"
+#include "src/loss/loss.h"
+#include "src/reader/parser.h"
+#include "src/updater/updater.h"
+
+namespace f2m {
+
+/* -----------------------------------------------------------------------------
+ * HogwildTrainer trains a model with N threads, and all the threads update     *
+ * the shared Model without any lock (Hogwild!). Each thread has its own        *
+ * Reader for one shard of the training file, its own Parser and Loss, and      *
+ * runs mini-batch SGD (or AdaGrad, FTRL, ... by the Updater) on its shard:     *
+ *                                                                              *
+ *   Loop num_epochs times over the shard {                                     *
+ *     matrix = Parse(reader.SampleViews());                                    *
+ *     loss.CalcGrad(matrix, model, &grad);                                     *
+ *     updater.Update(grad, matrix.size(), &model);                             *
+ *   }                                                                          *
+ *                                                                              *
+ * The features of CTR data are sparse, so two threads seldom update the same   *
+ * parameter at the same time, and a lost update only adds a little noise to    *
+ * SGD. In exchange, the threads never wait for each other, and the training    *
+ * scales with the number of cores. We can use HogwildTrainer like this:        *
+ *                                                                              *
+ *   AdaGradUpdater updater(learning_rate = 0.1);                               *
+ *   Model model(0, FFM, feature_num, k, field_num, false, false,               *
+ *               updater.num_state(), updater.need_step());                     *
+ *   model.RandomizeV(0.1, seed);                                               *
+ *                                                                              *
+ *   HogwildOptions options;                                                    *
+ *   options.num_threads = 16;                                                  *
+ *   HogwildTrainer trainer("/tmp/testdata", &model, &updater, options);        *
+ *   trainer.Train();                                                           *
+ *                                                                              *
+ *   LOG(INFO) << trainer.num_samples() / trainer.seconds() << " samples/s";    *
+ *   LOG(INFO) << "log loss: " << trainer.Evaluate("/tmp/testdata");            *
+ *                                                                              *
+ * The parser and the loss are chosen by the type of the model (the libsvm      *
+ * format for LR and FM, and the libffm format for FFM). The Updater is shared  *
+ * by all the threads, and keeps its state in the Model.                        *
+ *                                                                              *
+ * If options.hash_bits is set, the file has raw string features in the format  *
+ * of field:feature:value for every type of model, which are hashed by the      *
+ * HashFFMParser, and the model needs 2^hash_bits features.                     *
+ * -----------------------------------------------------------------------------
+ */
+
+struct HogwildOptions {
+  HogwildOptions()
+    : num_threads(1),
+      batch_size(100),
+      num_epochs(1),
+      in_memory(false),
+      hash_bits(0) {}
+
+  int num_threads;        /* number of training threads */
+  int batch_size;         /* number of samples in a mini-batch */
+  int num_epochs;         /* number of passes over the file */
+  bool in_memory;         /* map the file into memory */
+  int hash_bits;          /* hash the string features into 2^hash_bits
+                             indices, or 0 for the integer features */
+};
+
+class HogwildTrainer {
+ public:
+  HogwildTrainer(const std::string& filename, 
+                 Model* model,
+                 Updater* updater,
+                 const HogwildOptions& options);
+
+  ~HogwildTrainer() {}
+
+  /* Train the model with num_threads threads, and return after
+     all the threads finish num_epochs epochs of their shards and
+     the lazy updates are flushed to the model. */
+
+  void Train();
+
+  /* Return the average log loss of the model on a file. The
+     predictions of LR use num_threads threads. */
+
+  real_t Evaluate(const std::string& filename);
+
+  /* The number of samples trained by all the threads, and the
+     wall time of the last Train(). */
+
+  uint64 num_samples() const { return num_samples_; }
+  double seconds() const { return seconds_; }
+
+ private:
+  struct Worker {
+    HogwildTrainer* trainer;
+    int shard_id;
+    uint64 num_samples;
+  };
+
+  std::string filename_;
+  Model* model_;
+  Updater* updater_;
+  HogwildOptions options_;
+  uint64 num_samples_;
+  double seconds_;
+
+  static void* WorkerThread(void* worker);
+  void WorkerLoop(Worker* worker);
+
+  Parser* NewParser() const;
+  Loss* NewLoss(ThreadPool* pool = NULL) const;
+
+  DISALLOW_COPY_AND_ASSIGN(HogwildTrainer);
+};
+
+} // namespace f2m
+
+#endif // F2M_TRAIN_HOGWILD_H_
@@ -0,0 +1,266 @@
+/*
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or (at
+your option) any later version.
+
+This program is distributed in the hope that it will be useful, but
+WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+02110-1301, USA.
+*/
+
+/* 
+Copyright (c) 2016 by contributors.
+Author: Chao Ma (mctt90@gmail.com)
+
+This is the main program of the F2M trainer, which trains an LR,
+FM, or FFM model with HogwildTrainer. Usage:
+
+  f2m_train train_file [options]
+
+The train_file (and the FILE of --test) can also be a list of files
+separated by ',', a directory, or a glob pattern in quotes, and the
+threads read different files. The gzip and zstd files are read as 
+the plain files.
+
+  --model lr|fm|ffm  the type of the model (default fm).
+  --feature N        the number of features (default 1000000).
+  --field N          the number of fields, only for FFM (default 0).
+  --hash_bits N      the features are raw strings (field:feature:value),
+                     hash them into 2^N features (overrides --feature).
+  --k N              the size of the latent vectors (default 8).
+  --threads N        the number of training threads (default 1).
+  --batch N          the number of samples in a mini-batch (default 100).
+  --epoch N          the number of epochs (default 10).
+  --updater NAME     sgd, adagrad or ftrl (default sgd).
+  --lr X             the learning rate, or alpha of FTRL (default 0.1).
+  --beta X           beta of FTRL (default 1).
+  --l1 X             the L1 regularization of FTRL (default 0).
+  --l2 X             the L2 regularization (default 0).
+  --aligned          use the cache-line-aligned model layout.
+  --in_memory        map the training file into memory.
+  --test FILE        report the log loss on FILE (default train_file).
+  --scaling          train with 1, 2, 4, ..., N threads, and report
+                     the throughput and the speedup of each run.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <string>
+
+#include "src/common/common.h"
+#include "src/common/data_structure.h"
+#include "src/train/hogwild.h"
+#include "src/updater/adagrad_updater.h"
+#include "src/updater/ftrl_updater.h"
+#include "src/updater/sgd_updater.h"
+#include "src/updater/updater.h"
+
+using namespace f2m;
+
+const uint64 kRandomSeed = 2016;
+const real_t kInitScale = 0.1;
+
+/* The options of the updater. */
+
+struct UpdaterOptions {
+  std::string name;
+  real_t learning_rate;
+  real_t beta;
+  real_t l1;
+  real_t l2;
+};
+
+/* Return a new updater, or NULL if the name is unknown. */
+
+Updater* NewUpdater(const UpdaterOptions& options) {
+  if (options.name == "sgd") {
+    return new SGDUpdater(options.learning_rate, options.l2);
+  } else if (options.name == "adagrad") {
+    return new AdaGradUpdater(options.learning_rate, 1.0, options.l2);
+  } else if (options.name == "ftrl") {
+    return new FTRLUpdater(options.learning_rate, options.beta, 
+                           options.l1, options.l2);
+  }
+  return NULL;
+}
+
+/* Train a new model with num_threads threads, and print one line 
+   of the report. The speedup is relative to the throughput base 
+   of one thread (if it is known). Return the throughput (samples 
+   per second). Each run has its own updater, since the step of 
+   the lazy updates belongs to the model trained by the updater. */
+
+double Run(const std::string& train_file, const std::string& test_file,
+           ModelType type, index_t feature_num, int field_num, int k,
+           bool aligned, const UpdaterOptions& updater_options, 
+           HogwildOptions options, int num_threads, double base) {
+  scoped_ptr<Updater> updater(NewUpdater(updater_options));
+  CHECK_NOTNULL(updater.get());
+  Model model(0, type, feature_num, k, field_num, false, aligned,
+              updater->num_state(), updater->need_step());
+  model.RandomizeV(kInitScale, kRandomSeed);
+  options.num_threads = num_threads;
+  HogwildTrainer trainer(train_file, &model, updater.get(), options);
+  trainer.Train();
+  double throughput = trainer.num_samples() / trainer.seconds();
+  real_t loss = trainer.Evaluate(test_file);
+  if (base <= 0 && num_threads == 1) {
+    base = throughput;
+  }
+  if (base <= 0) {
+    // no run with one thread to compare with
+    printf("%8d %10.2f %14.0f %9s %10s %10.6f\n", num_threads, 
+           trainer.seconds(), throughput, "-", "-", loss);
+  } else {
+    printf("%8d %10.2f %14.0f %8.2fx %9.1f%% %10.6f\n",
+           num_threads, trainer.seconds(), throughput, throughput / base,
+           100.0 * throughput / base / num_threads, loss);
+  }
+  fflush(stdout);
+  return throughput;
+}
+
+int main(int argc, char* argv[]) {
+  if (argc < 2 || argv[1][0] == '-') {
+    fprintf(stderr, "Usage: %s train_file [--model lr|fm|ffm] [--feature N] "
+                    "[--field N] [--hash_bits N] [--k N] [--threads N] "
+                    "[--batch N] [--epoch N] [--updater sgd|adagrad|ftrl] "
+                    "[--lr X] [--beta X] [--l1 X] [--l2 X] [--aligned] "
+                    "[--in_memory] [--test FILE] [--scaling]\n", argv[0]);
+    return 1;
+  }
+  std::string train_file = argv[1];
+  std::string test_file = train_file;
+  ModelType type = FM;
+  index_t feature_num = 1000000;
+  int field_num = 0;
+  int k = 8;
+  bool aligned = false;
+  bool scaling = false;
+  UpdaterOptions updater_options;
+  updater_options.name = "sgd";
+  updater_options.learning_rate = 0.1;
+  updater_options.beta = 1.0;
+  updater_options.l1 = 0;
+  updater_options.l2 = 0;
+  HogwildOptions options;
+  options.num_epochs = 10;
+  for (int i = 2; i < argc; ++i) {
+    std::string option = argv[i];
+    if (option == "--aligned") {
+      aligned = true;
+      continue;
+    } else if (option == "--in_memory") {
+      options.in_memory = true;
+      continue;
+    } else if (option == "--scaling") {
+      scaling = true;
+      continue;
+    }
+    if (i + 1 >= argc) {
+      fprintf(stderr, "Missing the value of option: %s\n", argv[i]);
+      return 1;
+    }
+    const char* value = argv[++i];
+    if (option == "--model") {
+      if (strcmp(value, "lr") == 0) {
+        type = LR;
+      } else if (strcmp(value, "fm") == 0) {
+        type = FM;
+      } else if (strcmp(value, "ffm") == 0) {
+        type = FFM;
+      } else {
+        fprintf(stderr, "Unknown model: %s\n", value);
+        return 1;
+      }
+    } else if (option == "--feature") {
+      feature_num = strtoul(value, NULL, 10);
+    } else if (option == "--field") {
+      field_num = atoi(value);
+    } else if (option == "--hash_bits") {
+      options.hash_bits = atoi(value);
+    } else if (option == "--k") {
+      k = atoi(value);
+    } else if (option == "--threads") {
+      options.num_threads = atoi(value);
+    } else if (option == "--batch") {
+      options.batch_size = atoi(value);
+    } else if (option == "--epoch") {
+      options.num_epochs = atoi(value);
+    } else if (option == "--updater") {
+      updater_options.name = value;
+    } else if (option == "--lr") {
+      updater_options.learning_rate = atof(value);
+    } else if (option == "--beta") {
+      updater_options.beta = atof(value);
+    } else if (option == "--l1") {
+      updater_options.l1 = atof(value);
+    } else if (option == "--l2") {
+      updater_options.l2 = atof(value);
+    } else if (option == "--test") {
+      test_file = value;
+    } else {
+      fprintf(stderr, "Unknown option: %s\n", option.c_str());
+      return 1;
+    }
+  }
+  if (type == LR) {
+    // LR has no latent vector
+    k = 0;
+    field_num = 0;
+  }
+  if (type == FFM && field_num <= 0) {
+    fprintf(stderr, "--field must be set for FFM\n");
+    return 1;
+  }
+  if (options.hash_bits < 0 || options.hash_bits > 31) {
+    fprintf(stderr, "--hash_bits must be in [0, 31]\n");
+    return 1;
+  }
+  if (options.hash_bits > 0) {
+    feature_num = 1U << options.hash_bits;
+  }
+  if (options.num_threads <= 0) {
+    fprintf(stderr, "--threads must be positive\n");
+    return 1;
+  }
+  // Check the name now, every run creates its own updater.
+  if (scoped_ptr<Updater>(NewUpdater(updater_options)).get() == NULL) {
+    fprintf(stderr, "Unknown updater: %s\n", updater_options.name.c_str());
+    return 1;
+  }
+
+  printf("%8s %10s %14s %9s %10s %10s\n", "threads", "seconds", 
+         "samples/sec", "speedup", "efficiency", "log loss");
+  if (!scaling) {
+    Run(train_file, test_file, type, feature_num, field_num, k, aligned,
+        updater_options, options, options.num_threads, 0);
+    return 0;
+  }
+  // The speedup is relative to the run with one thread.
+  double base = 0;
+  for (int n = 1; ; n *= 2) {
+    if (n > options.num_threads) {
+      n = options.num_threads;
+    }
+    double throughput = Run(train_file, test_file, type, feature_num, 
+                            field_num, k, aligned, updater_options, 
+                            options, n, base);
+    if (n == 1) {
+      base = throughput;
+    }
+    if (n == options.num_threads) {
+      break;
+    }
+  }
+  return 0;
+}
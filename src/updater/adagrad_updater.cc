@@ -0,0 +1,100 @@
+/*
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or (at
+your option) any later version.
+
+This program is distributed in the hope that it will be useful, but
+WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+02110-1301, USA.
+*/
+
+/* 
+Copyright (c) 2016 by contributors.
+Author: Chao Ma (mctt90@gmail.com)
+
+This file is the implementation of adagrad_updater.h
+*/
+
+#include "src/updater/adagrad_updater.h"
+
+#include <cmath>
+
+namespace f2m {
+
+AdaGradUpdater::AdaGradUpdater(real_t learning_rate,
+                               real_t initial_accumulator,
+                               real_t l2)
+  : learning_rate_(learning_rate),
+    initial_accumulator_(initial_accumulator),
+    l2_(l2) {
+  CHECK_GT(learning_rate_, 0);
+  CHECK_GT(initial_accumulator_, 0);
+  CHECK_GE(l2_, 0);
+  // Or the decay changes the sign of the parameters.
+  CHECK_LT(learning_rate_ * l2_, sqrt(initial_accumulator_));
+}
+
+void AdaGradUpdater::Update(const SparseGrad& grad, 
+                            int batch_size, 
+                            Model* model) {
+  CHECK_NOTNULL(model);
+  CHECK_GT(batch_size, 0);
+  CHECK_GE(model->GetNumState(), num_state());
+  bool lazy = need_step();
+  if (lazy) {
+    CHECK(model->HasStep());
+  }
+  uint32 step = NextStep();
+  real_t scale = 1.0 / batch_size;
+  for (size_t i = 0; i < grad.size_w(); ++i) {
+    index_t pos = grad.position_w[i];
+    if (lazy) {
+      Touch(pos, step, model);
+    }
+    real_t g = grad.grad_w[i] * scale;
+    real_t* n = model->MutableStateW(pos, 0);
+    *n += g * g;
+    *model->MutableW(pos) -= learning_rate_ * g / 
+                             sqrt(initial_accumulator_ + *n);
+  }
+  const int k = model->GetK();
+  for (size_t i = 0; i < grad.size_v(); ++i) {
+    index_t pos = grad.position_v[i];
+    int field = grad.field_v[i];
+    real_t* v = model->MutableV(pos, field);
+    real_t* n = model->MutableStateV(pos, field, 0);
+    const real_t* g = grad.GradV(i);
+    for (int j = 0; j < k; ++j) {
+      real_t g_j = g[j] * scale;
+      n[j] += g_j * g_j;
+      v[j] -= learning_rate_ * g_j / sqrt(initial_accumulator_ + n[j]);
+    }
+  }
+}
+
+void AdaGradUpdater::CatchUp(index_t index, uint32 num_steps, 
+                             Model* model) {
+  double n = num_steps;
+  real_t* w = model->MutableW(index);
+  real_t rate = learning_rate_ / sqrt(initial_accumulator_ + 
+                                      *model->MutableStateW(index, 0));
+  *w *= pow(1 - rate * l2_, n);
+  const int k = model->GetK();
+  for (int f = 0; f < model->GetNumV(); ++f) {
+    real_t* v = model->MutableV(index, f);
+    const real_t* sum = model->MutableStateV(index, f, 0);
+    for (int j = 0; j < k; ++j) {
+      rate = learning_rate_ / sqrt(initial_accumulator_ + sum[j]);
+      v[j] *= pow(1 - rate * l2_, n);
+    }
+  }
+}
+
+} // namespace f2m
@@ -0,0 +1,78 @@
+/*
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or (at
+your option) any later version.
+
+This program is distributed in the hope that it will be useful, but
+WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+02110-1301, USA.
+*/
+
+/* 
+Copyright (c) 2016 by contributors.
+Author: Chao Ma (mctt90@gmail.com)
+
+This file defines the AdaGrad updater.
+*/
+
+#ifndef F2M_UPDATER_ADAGRAD_UPDATER_H_
+#define F2M_UPDATER_ADAGRAD_UPDATER_H_
+
+#include "src/common/common.h"
+#include "src/common/data_structure.h"
+
+#include "src/updater/updater.h"
+
+namespace f2m {
+
+/* -----------------------------------------------------------------------------
+ * AdaGrad, Math:                                                               *
+ *                                                                              *
+ *  [ r = learning_rate / sqrt(initial_accumulator + n) ]                       *
+ *  [ w = w * (1 - r * l2) ]                                                    *
+ *  [ n = n + g^2 ]                                                             *
+ *  [ w = w - learning_rate * g / sqrt(initial_accumulator + n) ]               *
+ *                                                                              *
+ * where g is the average gradient of the batch, and n (the sum of squared      *
+ * gradients) is the state of each parameter, which starts from 0. The          *
+ * frequent features get smaller steps than the rare ones. With                 *
+ * initial_accumulator = 1, it is the same rule as libffm.                      *
+ *                                                                              *
+ * The L2 decay is not added to n, so n does not change in the steps in which   *
+ * a feature does not appear, and the decay of these n steps is (1 - r * l2)^n  *
+ * for each parameter, which is applied lazily when the feature appears.        *
+ * -----------------------------------------------------------------------------
+ */
+
+class AdaGradUpdater : public Updater {
+ public:
+  explicit AdaGradUpdater(real_t learning_rate,
+                          real_t initial_accumulator = 1.0,
+                          real_t l2 = 0);
+  ~AdaGradUpdater() {}
+
+  int num_state() const { return 1; }
+  bool need_step() const { return l2_ > 0; }
+
+  void Update(const SparseGrad& grad, int batch_size, Model* model);
+
+ private:
+  real_t learning_rate_;
+  real_t initial_accumulator_;
+  real_t l2_;
+
+  void CatchUp(index_t index, uint32 num_steps, Model* model);
+
+  DISALLOW_COPY_AND_ASSIGN(AdaGradUpdater);
+};
+
+} // namespace f2m
+
+#endif // F2M_UPDATER_ADAGRAD_UPDATER_H_
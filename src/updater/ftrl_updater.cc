@@ -0,0 +1,94 @@
+/*
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or (at
+your option) any later version.
+
+This program is distributed in the hope that it will be useful, but
+WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+02110-1301, USA.
+*/
+
+/* 
+Copyright (c) 2016 by contributors.
+Author: Chao Ma (mctt90@gmail.com)
+
+This file is the implementation of ftrl_updater.h
+*/
+
+#include "src/updater/ftrl_updater.h"
+
+#include <cmath>
+
+namespace f2m {
+
+FTRLUpdater::FTRLUpdater(real_t alpha, real_t beta, real_t l1, real_t l2)
+  : alpha_(alpha),
+    beta_(beta),
+    l1_(l1),
+    l2_(l2) {
+  CHECK_GT(alpha_, 0);
+  CHECK_GE(beta_, 0);
+  CHECK_GE(l1_, 0);
+  CHECK_GE(l2_, 0);
+  // The denominator of w when n = 0.
+  CHECK_GT(beta_ / alpha_ + l2_, 0);
+}
+
+inline void FTRLUpdater::Step(real_t g, real_t l1, 
+                              real_t* w, real_t* z, real_t* n) const {
+  if (*n == 0 && *w != 0) {
+    // The first update of a parameter with a random initial 
+    // value (e.g., a latent vector), so start z from the value 
+    // which gives the same w, instead of resetting w to zero.
+    real_t sign = *w > 0 ? 1 : -1;
+    *z = -*w * (beta_ / alpha_ + l2_) - sign * l1;
+  }
+  real_t new_n = *n + g * g;
+  real_t sqrt_n = sqrt(new_n);
+  real_t sigma = (sqrt_n - sqrt(*n)) / alpha_;
+  *z += g - sigma * *w;
+  *n = new_n;
+  if (fabs(*z) <= l1) {
+    *w = 0;
+  } else {
+    real_t sign = *z > 0 ? 1 : -1;
+    *w = -(*z - sign * l1) / ((beta_ + sqrt_n) / alpha_ + l2_);
+  }
+}
+
+void FTRLUpdater::Update(const SparseGrad& grad, 
+                         int batch_size, 
+                         Model* model) {
+  CHECK_NOTNULL(model);
+  CHECK_GT(batch_size, 0);
+  CHECK_GE(model->GetNumState(), num_state());
+  real_t scale = 1.0 / batch_size;
+  for (size_t i = 0; i < grad.size_w(); ++i) {
+    index_t pos = grad.position_w[i];
+    real_t* state = model->MutableStateW(pos, 0);
+    // the two states of w are adjacent
+    Step(grad.grad_w[i] * scale, l1_, model->MutableW(pos), 
+         state, state + 1);
+  }
+  const int k = model->GetK();
+  for (size_t i = 0; i < grad.size_v(); ++i) {
+    index_t pos = grad.position_v[i];
+    int field = grad.field_v[i];
+    real_t* v = model->MutableV(pos, field);
+    real_t* z = model->MutableStateV(pos, field, 0);
+    real_t* n = model->MutableStateV(pos, field, 1);
+    const real_t* g = grad.GradV(i);
+    for (int j = 0; j < k; ++j) {
+      Step(g[j] * scale, 0, v + j, z + j, n + j);
+    }
+  }
+}
+
+} // namespace f2m
@@ -0,0 +1,87 @@
+/*
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or (at
+your option) any later version.
+
+This program is distributed in the hope that it will be useful, but
+WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+02110-1301, USA.
+*/
+
+/* 
+Copyright (c) 2016 by contributors.
+Author: Chao Ma (mctt90@gmail.com)
+
+This file defines the FTRL-Proximal updater.
+*/
+
+#ifndef F2M_UPDATER_FTRL_UPDATER_H_
+#define F2M_UPDATER_FTRL_UPDATER_H_
+
+#include "src/common/common.h"
+#include "src/common/data_structure.h"
+
+#include "src/updater/updater.h"
+
+namespace f2m {
+
+/* -----------------------------------------------------------------------------
+ * FTRL-Proximal (McMahan et al., Ad Click Prediction: a View from the          *
+ * Trenches), Math:                                                             *
+ *                                                                              *
+ *  [ sigma = (sqrt(n + g^2) - sqrt(n)) / alpha ]                               *
+ *  [ z = z + g - sigma * w ]                                                   *
+ *  [ n = n + g^2 ]                                                             *
+ *                                                                              *
+ *  [ w = 0                                            if |z| <= l1 ]           *
+ *  [ w = -(z - sign(z) * l1) / ((beta + sqrt(n)) / alpha + l2)  otherwise ]    *
+ *                                                                              *
+ * where g is the average gradient of the batch, and z and n are the state of   *
+ * each parameter, which start from 0. The L1 term sets the weights of the      *
+ * rare features to exactly zero, which makes the model for serving small.      *
+ *                                                                              *
+ * The L1 term is only applied to w. A latent vector of zeros gets zero         *
+ * gradients and never moves again, so the latent vectors use l1 = 0. On the    *
+ * first update of a parameter (n = 0), z is set to the value which gives its   *
+ * current w, so the random initial latent vectors are kept.                    *
+ *                                                                              *
+ * The denominator is at least beta / alpha + l2, which must be positive, or    *
+ * a zero gradient on a new parameter (n = 0) divides by zero.                  *
+ * -----------------------------------------------------------------------------
+ */
+
+class FTRLUpdater : public Updater {
+ public:
+  FTRLUpdater(real_t alpha, 
+              real_t beta = 1.0, 
+              real_t l1 = 0, 
+              real_t l2 = 0);
+  ~FTRLUpdater() {}
+
+  int num_state() const { return 2; }
+
+  void Update(const SparseGrad& grad, int batch_size, Model* model);
+
+ private:
+  real_t alpha_;
+  real_t beta_;
+  real_t l1_;
+  real_t l2_;
+
+  /* Update one parameter w with its state z and n. */
+
+  void Step(real_t g, real_t l1, real_t* w, real_t* z, real_t* n) const;
+
+  DISALLOW_COPY_AND_ASSIGN(FTRLUpdater);
+};
+
+} // namespace f2m
+
+#endif // F2M_UPDATER_FTRL_UPDATER_H_
@@ -0,0 +1,80 @@
+/*
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or (at
+your option) any later version.
+
+This program is distributed in the hope that it will be useful, but
+WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+02110-1301, USA.
+*/
+
+/* 
+Copyright (c) 2016 by contributors.
+Author: Chao Ma (mctt90@gmail.com)
+
+This file is the implementation of sgd_updater.h
+*/
+
+#include "src/updater/sgd_updater.h"
+
+#include <cmath>
+
+namespace f2m {
+
+SGDUpdater::SGDUpdater(real_t learning_rate, real_t l2)
+  : learning_rate_(learning_rate),
+    l2_(l2) {
+  CHECK_GT(learning_rate_, 0);
+  CHECK_GE(l2_, 0);
+  // Or the decay changes the sign of the parameters.
+  CHECK_LT(learning_rate_ * l2_, 1);
+}
+
+void SGDUpdater::Update(const SparseGrad& grad, 
+                        int batch_size, 
+                        Model* model) {
+  CHECK_NOTNULL(model);
+  CHECK_GT(batch_size, 0);
+  bool lazy = need_step();
+  if (lazy) {
+    CHECK(model->HasStep());
+  }
+  uint32 step = NextStep();
+  real_t scale = -learning_rate_ / batch_size;
+  for (size_t i = 0; i < grad.size_w(); ++i) {
+    if (lazy) {
+      Touch(grad.position_w[i], step, model);
+    }
+    *model->MutableW(grad.position_w[i]) += scale * grad.grad_w[i];
+  }
+  const int k = model->GetK();
+  for (size_t i = 0; i < grad.size_v(); ++i) {
+    real_t* v = model->MutableV(grad.position_v[i], grad.field_v[i]);
+    const real_t* g = grad.GradV(i);
+    for (int j = 0; j < k; ++j) {
+      v[j] += scale * g[j];
+    }
+  }
+}
+
+void SGDUpdater::CatchUp(index_t index, uint32 num_steps, Model* model) {
+  real_t decay = pow(1 - learning_rate_ * l2_, 
+                     static_cast<double>(num_steps));
+  *model->MutableW(index) *= decay;
+  const int k = model->GetK();
+  for (int f = 0; f < model->GetNumV(); ++f) {
+    real_t* v = model->MutableV(index, f);
+    for (int j = 0; j < k; ++j) {
+      v[j] *= decay;
+    }
+  }
+}
+
+} // namespace f2m
@@ -0,0 +1,68 @@
+/*
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or (at
+your option) any later version.
+
+This program is distributed in the hope that it will be useful, but
+WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+02110-1301, USA.
+*/
+
+/* 
+Copyright (c) 2016 by contributors.
+Author: Chao Ma (mctt90@gmail.com)
+
+This file defines the SGD updater.
+*/
+
+#ifndef F2M_UPDATER_SGD_UPDATER_H_
+#define F2M_UPDATER_SGD_UPDATER_H_
+
+#include "src/common/common.h"
+#include "src/common/data_structure.h"
+
+#include "src/updater/updater.h"
+
+namespace f2m {
+
+/* -----------------------------------------------------------------------------
+ * Stochastic Gradient Descent, Math:                                           *
+ *                                                                              *
+ *  [ w = w * (1 - learning_rate * l2) - learning_rate * g ]                    *
+ *                                                                              *
+ * where g is the average gradient of the batch. SGD has no state. The L2       *
+ * decay of every step is applied lazily: when a feature appears after n        *
+ * steps, its parameters are multiplied by (1 - learning_rate * l2)^n.          *
+ * -----------------------------------------------------------------------------
+ */
+
+class SGDUpdater : public Updater {
+ public:
+  explicit SGDUpdater(real_t learning_rate, real_t l2 = 0);
+  ~SGDUpdater() {}
+
+  int num_state() const { return 0; }
+  bool need_step() const { return l2_ > 0; }
+
+  void Update(const SparseGrad& grad, int batch_size, Model* model);
+
+ protected:
+  void CatchUp(index_t index, uint32 num_steps, Model* model);
+
+ private:
+  real_t learning_rate_;
+  real_t l2_;
+
+  DISALLOW_COPY_AND_ASSIGN(SGDUpdater);
+};
+
+} // namespace f2m
+
+#endif // F2M_UPDATER_SGD_UPDATER_H_
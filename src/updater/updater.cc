@@ -19,6 +19,26 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
 Copyright (c) 2016 by contributors.
 Author: Chao Ma (mctt90@gmail.com)
 
-This files defines Parser class, which parse the Reader's 
-output to a DMatrix.
-*/
\ No newline at end of file
+This file is the implementation of updater.h
+*/
+
+#include "src/updater/updater.h"
+
+#include <vector>
+
+namespace f2m {
+
+void Updater::Flush(Model* model) {
+  CHECK_NOTNULL(model);
+  if (!need_step()) {
+    return;
+  }
+  std::vector<index_t> features;
+  model->GetFeatures(&features);
+  uint32 current = step();
+  for (size_t i = 0; i < features.size(); ++i) {
+    Touch(features[i], current, model);
+  }
+}
+
+} // namespace f2m
@@ -0,0 +1,152 @@
+/*
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or (at
+your option) any later version.
+
+This program is distributed in the hope that it will be useful, but
+WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+02110-1301, USA.
+*/
+
+/* 
+Copyright (c) 2016 by contributors.
+Author: Chao Ma (mctt90@gmail.com)
+
+This file defines the base class Updater, which applies the 
+gradients to the model.
+*/
+
+#ifndef F2M_UPDATER_UPDATER_H_
+#define F2M_UPDATER_UPDATER_H_
+
+#include "src/common/common.h"
+#include "src/common/data_structure.h"
+
+namespace f2m {
+
+/* -----------------------------------------------------------------------------
+ * The basic class of updater.                                                  *
+ * Updater is an abstract class, which can be implemented by real update        *
+ * rules such as SGD (sgd_updater.h), AdaGrad (adagrad_updater.h), and          *
+ * FTRL-Proximal (ftrl_updater.h). We can use Updater like this:                *
+ *                                                                              *
+ *   AdaGradUpdater updater(learning_rate = 0.1);                               *
+ *   Model model(0, FFM, feature_num, k, field_num, sparse, aligned,            *
+ *               updater.num_state(), updater.need_step());                     *
+ *                                                                              *
+ *   Loop until converge {                                                      *
+ *     loss.CalcGrad(matrix, model, &grad);                                     *
+ *     updater.Update(grad, matrix.size(), &model);                             *
+ *   }                                                                          *
+ *                                                                              *
+ * Update() only touches the parameters in the SparseGrad. The per-parameter    *
+ * state of an updater (e.g., the sum of squared gradients of AdaGrad) is       *
+ * stored in the Model next to the parameters (see data_structure.h), so an     *
+ * Updater has no state of its own, and many threads can share one Updater      *
+ * (e.g., HogwildTrainer). Only the first k values of a latent vector are       *
+ * updated, so the padding of the aligned model stays zero.                     *
+ *                                                                              *
+ * Some updates change every parameter in every step, e.g., the L2 decay        *
+ * w = w * (1 - learning_rate * l2), which is too slow for millions of          *
+ * features. Such an updater returns need_step() = true, and the Model keeps    *
+ * the step of the last update of each feature (has_step). When a feature       *
+ * appears again, Touch() applies the updates of all the steps since its last   *
+ * update at once (CatchUp()), so the cost of a step is proportional to the     *
+ * features in the batch. Flush() brings all the features up to date, which     *
+ * should be called before the model is evaluated or saved:                     *
+ *                                                                              *
+ *   Model model(0, FFM, feature_num, k, field_num, sparse, aligned,            *
+ *               updater.num_state(), updater.need_step());                     *
+ *   ... train the model                                                        *
+ *   updater.Flush(&model);                                                     *
+ *                                                                              *
+ * The step counts the updates of the models trained by the Updater, and the    *
+ * last steps of the features are relative to it, so a new Model (e.g., each    *
+ * run of a benchmark) must be trained with a new Updater. Otherwise the first  *
+ * Touch() of each feature applies the lazy updates of all the previous runs.   *
+ *                                                                              *
+ * The lazy updates are applied to w and all the latent vectors of a feature    *
+ * when its w is updated, since the losses always compute the gradient of w     *
+ * for every feature in the batch.                                              *
+ * -----------------------------------------------------------------------------
+ */
+
+class Updater {
+ public:
+  Updater() : step_(0) {}
+  virtual ~Updater() {}
+
+  /* The number of state values of one parameter, which must be 
+     passed to the constructor of Model. */
+
+  virtual int num_state() const = 0;
+
+  /* Whether the Model must keep the last step of each feature
+     (has_step) for the lazy updates. */
+
+  virtual bool need_step() const { return false; }
+
+  /* Apply the gradients, which are the sum over batch_size 
+     samples, to the model. */
+
+  virtual void Update(const SparseGrad& grad, 
+                      int batch_size, 
+                      Model* model) = 0;
+
+  /* Apply the lazy updates to all the features of the model. */
+
+  void Flush(Model* model);
+
+  /* The number of Update() calls (steps) so far. */
+
+  uint32 step() const { return __atomic_load_n(&step_, __ATOMIC_RELAXED); }
+
+ protected:
+  /* Start a new step and return it. Many threads can call it. */
+
+  uint32 NextStep() { 
+    return __atomic_add_fetch(&step_, 1, __ATOMIC_RELAXED); 
+  }
+
+  /* Apply the lazy updates of the steps in (last step, step] to 
+     the feature, and set its last step to step. Many threads can
+     call it: a thread claims the steps by a compare-and-swap of the
+     last step before CatchUp(), so the updates of a step are applied
+     only once, and the last step never goes back. */
+
+  void Touch(index_t index, uint32 step, Model* model) {
+    uint32* slot = model->MutableLastStep(index);
+    uint32 last = __atomic_load_n(slot, __ATOMIC_RELAXED);
+    // Another thread may have claimed a later step. A failed
+    // compare-and-swap reloads last, and we try again.
+    while (step > last) {
+      if (__atomic_compare_exchange_n(slot, &last, step, true,
+                                      __ATOMIC_RELAXED, 
+                                      __ATOMIC_RELAXED)) {
+        CatchUp(index, step - last, model);
+        return;
+      }
+    }
+  }
+
+  /* Apply the lazy updates of num_steps steps to the parameters 
+     of a feature. Used by the updaters with need_step() = true. */
+
+  virtual void CatchUp(index_t index, uint32 num_steps, Model* model) {}
+
+ private:
+  uint32 step_;
+
+  DISALLOW_COPY_AND_ASSIGN(Updater);
+};
+
+} // namespace f2m
+
+#endif // F2M_UPDATER_UPDATER_H_